@@ -1,11 +1,20 @@
 #include "Animal.h"
+#include "FreeMaskGrid.h"
 
-Animal::Animal(char letter_id, Organism::OrganismType animal_type, int health, const std::tuple<int, int>& coords)
-        : Organism::Organism(letter_id, animal_type, health, coords) {}
+const int Animal::DIRECTION_OFFSETS[4][2] = {{-1, 0}, {1, 0}, {0, -1}, {0, 1}};
+
+Animal::Animal(char letter_id, Organism::OrganismType animal_type, int health, const std::tuple<int, int>& coords, int vision_radius)
+        : Organism::Organism(letter_id, animal_type, health, coords), m_vision_radius{vision_radius} {}
+
+// Setters & Getters:
+
+int Animal::getVisionRadius() const{
+    return m_vision_radius;
+}
 
 // Methods:
 
-void Animal::moveTo(const std::tuple<int, int>& new_location){
+void Animal::moveTo(const std::tuple<int, int>& new_location, WorldHash& world_hash){
     // Make sure only adjacent moves are happenening (no diagonal moves)
     int x_disp = std::get<0>(m_coords) - std::get<0>(new_location);
     int y_disp = std::get<1>(m_coords) - std::get<1>(new_location);
@@ -24,33 +33,34 @@ void Animal::moveTo(const std::tuple<int, int>& new_location){
     }
 
     // Update location
+    std::uint64_t old_hash_contribution = getHashContribution();
     std::get<0>(m_coords) = std::get<0>(new_location);
     std::get<1>(m_coords) = std::get<1>(new_location);
+    updateWorldHash(old_hash_contribution, world_hash);
 }
 
-void Animal::eat(Organism* org){
+void Animal::eat(Organism* org, WorldHash& world_hash){
     // Restore health
     if (org->getType() == Organism::PlantEnum){
         Plant* plant {dynamic_cast<Plant*>(org)};
-        this->addHealth(plant->getEnergyPoints());
+        this->addHealth(plant->getEnergyPoints(), world_hash);
     }
     else{
-        this->addHealth(org->getCurrentHealth());
+        this->addHealth(org->getCurrentHealth(), world_hash);
     }
 
     // Move to eaten organism's location
+    std::uint64_t old_hash_contribution = getHashContribution();
     std::tuple<int, int> org_coords = org->getCoords();
     std::get<0>(m_coords) = std::get<0>(org_coords);
     std::get<1>(m_coords) = std::get<1>(org_coords);
+    updateWorldHash(old_hash_contribution, world_hash);
 
     // Kill the eaten organism
-    org->die();
+    org->die(world_hash);
 }
 
 bool Animal::hungryEnoughToEat(Organism* const org){
-    // See how hungry this is
-    int hunger = this->getMaxHealth() - this->getCurrentHealth();
-
     // See how much food is the org
     int consume_size;
     if (org->getType() == Organism::PlantEnum){
@@ -59,6 +69,13 @@ bool Animal::hungryEnoughToEat(Organism* const org){
     }
     else
         consume_size = org->getCurrentHealth();
+
+    return hungryEnoughToEat(consume_size);
+}
+
+bool Animal::hungryEnoughToEat(int consume_size) const{
+    // See how hungry this is
+    int hunger = this->getMaxHealth() - this->getCurrentHealth();
     
     // See if this is hungry enough to eat the org
     if (hunger >= consume_size)
@@ -67,102 +84,113 @@ bool Animal::hungryEnoughToEat(Organism* const org){
     return false;
 }
 
-void Animal::update(const std::vector<Organism*>& organisms, const std::tuple<int, int>& map_dimensions){
-    // Find all adjacent organisms
-    bool eaten = false;
-    std::vector<Organism*> adjacent_organisms;
-    for(Organism* org : organisms){
-        // Skip over plants that are de-spawned
-        if (!org->isAlive())
-            continue;
-
-        // Skip over myself
-        if (org->getID() == this->getID())
-            continue;
+int Animal::getDirection(int x_disp, int y_disp){
+    for (int direction = 0; direction < 4; direction++){
+        if (DIRECTION_OFFSETS[direction][0] == x_disp && DIRECTION_OFFSETS[direction][1] == y_disp)
+            return direction;
+    }
+    return -1;
+}
 
-        // See if this is an adjacent organism
-        if (this->isNextTo(org)){
-            // See if it's edible
-            if(this->isPredatorTo(org)){
-                //See if animal is hungry enough to eat org
-                if (this->hungryEnoughToEat(org)){
-                    this->addHealth(-1); // Animal needs to expend 1 energy point to reach organism to eat
-                    this->eat(org);
-                    eaten = true;
-                    break;
-                }
-            }
-
-            // If org is not edible/eaten, note it as just another adjecent org and continue
-            adjacent_organisms.push_back(org);
-        }
+int Animal::pickDirection(int directions){
+    // Only draw a random number if there's actually a choice to make
+    int count = __builtin_popcount(directions);
+    if (count > 1){
+        for (int skip = std::uniform_int_distribution<int>(0, count - 1)(Helper::getRandomEngine()); skip > 0; skip--)
+            directions &= directions - 1; // Drop the lowest set bit
     }
+    return __builtin_ctz(directions);
+}
 
-    // If animal ate something during above search, it has already completed its update
-    if (eaten)
+void Animal::moveRandomly(WorldHash& world_hash, int free_directions, int preferred_directions){
+    // Any free preferred direction is picked over every other free direction. Every candidate is equally likely
+    int candidates = (free_directions & preferred_directions) ? (free_directions & preferred_directions) : free_directions;
+    if (!candidates){
+        // If animal is unable to move, simply decrease its health by 1 and move on
+        Metrics::local().failed_moves++;
+        this->addHealth(-1, world_hash);
         return;
+    }
 
-    // Code below will make a random move to some free adjacent location
-    // Doing so will automatically flee from any nearby predators
-    int current_x_coord = std::get<0>(m_coords);
-    int current_y_coord = std::get<1>(m_coords);
-    
-    // Get all possible adjacent locations
-    std::tuple<int, int> adjacent_locations[4];
-    int array_index = 0;
-    for(int i = 0; i < 2; i++){
-        for(int j = -1; j <=1; j+=2){
-            // Logic to calculate adjacent locations
-            std::tuple<int, int> adjacent_location;
-            if (i % 2 == 0){
-                int new_x_coord = current_x_coord + j;
-                if (new_x_coord < 0 || new_x_coord >= std::get<0>(map_dimensions)) // Boundary detection (location of {-1, -1} indicates a location that is impossible to move to)
-                    adjacent_location = {-1, -1};
-                else
-                    adjacent_location = {current_x_coord + j, current_y_coord};
-            }
-            else{
-                int new_y_coord = current_y_coord + j;
-                if (new_y_coord < 0 || new_y_coord >= std::get<1>(map_dimensions)) // Boundary detection (location of {-1, -1} indicates a location that is impossible to move to)
-                    adjacent_location = {-1, -1};
-                else
-                    adjacent_location = {current_x_coord, current_y_coord + j};
-            }
-
-            adjacent_locations[array_index] = adjacent_location;
-            array_index++;
+    int direction = pickDirection(candidates);
+    this->addHealth(-1, world_hash);
+    this->moveTo({std::get<0>(m_coords) + DIRECTION_OFFSETS[direction][0], std::get<1>(m_coords) + DIRECTION_OFFSETS[direction][1]}, world_hash);
+}
 
-        }
+int Animal::getPreferredDirections(const SpatialIndex* spatial_index){
+    if (!spatial_index || m_vision_radius <= 0)
+        return ALL_DIRECTIONS;
+
+    // Running away is more important than eating
+    bool fleeing = true;
+    const Organism* target = spatial_index->findNearestPredator(this, m_vision_radius);
+    if (!target){
+        fleeing = false;
+        target = spatial_index->findNearest(m_coords, m_vision_radius, [this](Organism* org) {
+            return org != this && this->isPredatorTo(org) && this->hungryEnoughToEat(org);
+        });
+    }
+    if (!target)
+        return ALL_DIRECTIONS;
+
+    int distance = SpatialIndex::getDistance(m_coords, target->getCoords());
+    int preferred_directions = 0;
+    for (int direction = 0; direction < 4; direction++){
+        std::tuple<int, int> new_coords {std::get<0>(m_coords) + DIRECTION_OFFSETS[direction][0], std::get<1>(m_coords) + DIRECTION_OFFSETS[direction][1]};
+        int new_distance = SpatialIndex::getDistance(new_coords, target->getCoords());
+        if (fleeing ? new_distance > distance : new_distance < distance)
+            preferred_directions |= 1 << direction;
     }
+    return preferred_directions ? preferred_directions : ALL_DIRECTIONS;
+}
+
+void Animal::update(const std::vector<Organism*>& organisms, const std::tuple<int, int>& map_dimensions, WorldHash& world_hash, FreeMaskGrid& free_masks){
+    update(organisms, map_dimensions, world_hash, free_masks, nullptr);
+}
 
-    // Shuffle adjacent locations to make movements random
-    std::random_device rd;
-    std::default_random_engine rng(rd());
-    std::shuffle(std::begin(adjacent_locations), std::end(adjacent_locations), rng);
+void Animal::update(const std::vector<Organism*>& organisms, const std::tuple<int, int>& map_dimensions, WorldHash& world_hash, FreeMaskGrid& free_masks,
+    const SpatialIndex* spatial_index){
+    std::tuple<int, int> old_coords = m_coords;
+    bool was_alive = m_alive; // Dead animals still get updated until they're cleaned up, but they don't take up a cell
+
+    // Find the first adjacent organism that's edible. Which adjacent locations are occupied is already in free_masks
+    Organism* food = nullptr;
+    int candidates = 0;
+    for(Organism* org : organisms){
+        candidates++;
 
-    // Move to first unoccupied location
-    bool moved = false;
-    for(std::tuple<int, int> location : adjacent_locations){
-        if (location == std::tuple<int, int>{-1, -1}) // Make sure new location isn't out of bounds
+        // Skip over plants that are de-spawned
+        if (!org->isAlive())
             continue;
 
-        bool occupied = false;
-        for (Organism* adjacent_org : adjacent_organisms){
-            if (adjacent_org->getCoords() == location){
-                occupied = true;
-                break;
-            }
-        }
+        // Skip over myself
+        if (org == this)
+            continue;
 
-        if (!occupied){ // Move to unoccupied location
-            this->addHealth(-1);
-            this->moveTo(location);
-            moved = true;
+        // See if this is an adjacent organism that's edible, and if animal is hungry enough to eat it
+        if (this->isNextTo(org) && this->isPredatorTo(org) && this->hungryEnoughToEat(org)){
+            food = org;
             break;
         }
     }
 
-    // If animal is unable to move, simply decrease its health by 1 and move on
-    if (!moved)
-        this->addHealth(-1);
+    Metrics::Counters& metrics = Metrics::local();
+    metrics.animal_updates++;
+    metrics.neighbor_candidates += candidates;
+
+    if (food){
+        this->addHealth(-1, world_hash); // Animal needs to expend 1 energy point to reach organism to eat
+        this->eat(food, world_hash);
+        free_masks.removeLiving(food->getCoords());
+    }
+    else{
+        // Make a random move to some free adjacent location
+        // Doing so will automatically flee from any nearby predators. Animals that can see further also head towards food and away from predators
+        this->moveRandomly(world_hash, free_masks.getFreeDirections(m_coords), getPreferredDirections(spatial_index));
+    }
+
+    if (was_alive)
+        free_masks.removeLiving(old_coords);
+    if (m_alive)
+        free_masks.addLiving(m_coords);
 }
\ No newline at end of file
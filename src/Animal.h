@@ -3,10 +3,23 @@
 
 #include "Organism.h"
 #include "Plant.h"
+#include "Metrics.h"
+#include "SpatialIndex.h"
 
 class Animal : public Organism{
+    int m_vision_radius{0}; // How far away (Manhattan distance) this animal can see predators and food. 0 = only what's right next to it
+
     public:
-    Animal(char letter_id, Organism::OrganismType animal_type, int health, const std::tuple<int, int>& coords);
+    // Adjacent locations: left, right, up, down. Opposite directions only differ in the lowest bit (direction ^ 1)
+    // Sets of directions are stored as bitmasks where bit i means DIRECTION_OFFSETS[i]
+    static const int DIRECTION_OFFSETS[4][2];
+    static constexpr int ALL_DIRECTIONS = 0b1111;
+
+    Animal(char letter_id, Organism::OrganismType animal_type, int health, const std::tuple<int, int>& coords, int vision_radius = 0);
+
+    // Setters & Getters:
+
+    int getVisionRadius() const;
 
     // Methods:
 
@@ -14,7 +27,7 @@ class Animal : public Organism{
     Move to new coordinates
     New coordinates must be within 1 unit of current coordinates, otherwise error will occur and organism will not move
     */
-    void moveTo(const std::tuple<int, int>& new_location);
+    void moveTo(const std::tuple<int, int>& new_location, WorldHash& world_hash);
     
     /*
     Eat another organism
@@ -22,20 +35,58 @@ class Animal : public Organism{
     - org.die()
     - this.m_coords = org.getCoords()
     */
-    void eat(Organism* org);
+    void eat(Organism* org, WorldHash& world_hash);
 
     /*
     See if this is hungry enough to eat org
     */
     bool hungryEnoughToEat(Organism* const org);
 
+    /*
+    See if this is hungry enough to eat something worth consume_size health
+    */
+    bool hungryEnoughToEat(int consume_size) const;
+
+    /*
+    Get the direction (index into DIRECTION_OFFSETS) of a displacement, or -1 if it's not exactly 1 step left/right/up/down
+    */
+    static int getDirection(int x_disp, int y_disp);
+
+    /*
+    Pick one of the directions in a non-empty bitmask at random, each one equally likely
+    */
+    static int pickDirection(int directions);
+
+    /*
+    Make a random move in one of free_directions (bitmask, see DIRECTION_OFFSETS). These have to be inside the map and unoccupied,
+    see FreeMaskGrid
+    - Free directions in preferred_directions are picked over other free directions
+    - Moving costs 1 health. If there's nowhere to move, animal stays where it is but still loses 1 health
+    */
+    void moveRandomly(WorldHash& world_hash, int free_directions, int preferred_directions = ALL_DIRECTIONS);
+
+    /*
+    Directions this animal would rather move in, based on what it can see within its vision radius (bitmask, see DIRECTION_OFFSETS)
+    - If it sees a predator, directions that take it further from the nearest predator
+    - Otherwise, if it sees food it's hungry enough to eat, directions that take it closer to the nearest food
+    - Otherwise (or if it has no vision radius, or spatial_index is nullptr), ALL_DIRECTIONS
+    */
+    int getPreferredDirections(const SpatialIndex* spatial_index);
+
     /*
     Given a vector of organisms and a specific animal type, update this animal object as follows:
     - If animal sees an edible organism adjacent to it and if animal is hungry enough to eat the organism, animal will eat the organism
     - Otherwise, animal will move randomly in some direction
         This will automatically allow animal to flee from any adjacent predators
+    - Which cells next to it are free comes from free_masks, so organisms are only looked through for food
+    */
+    void update(const std::vector<Organism*>& organisms, const std::tuple<int, int>& map_dimensions, WorldHash& world_hash, FreeMaskGrid& free_masks) override;
+
+    /*
+    Same as above, but animals with a vision radius use spatial_index to move towards food and away from predators they can see
     */
-    void update(const std::vector<Organism*>& organisms, const std::tuple<int, int>& map_dimensions) override;
+    void update(const std::vector<Organism*>& organisms, const std::tuple<int, int>& map_dimensions, WorldHash& world_hash, FreeMaskGrid& free_masks,
+        const SpatialIndex* spatial_index);
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,163 @@
+#include "Channel.h"
+#include "Helper.h"
+
+#include <algorithm>
+#include <cstring>
+#include <cerrno>
+#include <cstdint>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+void Channel::sendMessage(int side, const std::vector<char>& message){
+    std::uint64_t size = message.size();
+    send(side, &size, sizeof(size));
+    send(side, message.data(), message.size());
+}
+
+void Channel::receiveMessage(int side, std::vector<char>& message){
+    std::uint64_t size = 0;
+    receive(side, &size, sizeof(size));
+    message.resize(size);
+    receive(side, message.data(), size);
+}
+
+std::unique_ptr<Channel> Channel::create(const std::string& transport){
+    if (transport == "socket")
+        return std::make_unique<SocketChannel>();
+    if (transport == "shm")
+        return std::make_unique<SharedMemoryChannel>();
+    return nullptr;
+}
+
+// Unix sockets:
+
+SocketChannel::SocketChannel(){
+    if (::socketpair(AF_UNIX, SOCK_STREAM, 0, m_fds) < 0){
+        std::cerr << "Error: couldn't make a socket pair: " << std::strerror(errno) << '\n';
+        Helper::quit(11);
+    }
+}
+
+SocketChannel::~SocketChannel(){
+    for (int fd : m_fds){
+        if (fd >= 0)
+            ::close(fd);
+    }
+}
+
+void SocketChannel::send(int side, const void* data, std::size_t size){
+    const char* bytes = static_cast<const char*>(data);
+    while (size > 0){
+        ssize_t sent = ::send(m_fds[side], bytes, size, MSG_NOSIGNAL);
+        if (sent < 0 && errno == EINTR)
+            continue;
+        if (sent <= 0){
+            std::cerr << "Error: lost connection to another simulation process\n";
+            Helper::quit(11);
+        }
+        bytes += sent;
+        size -= sent;
+    }
+}
+
+void SocketChannel::receive(int side, void* data, std::size_t size){
+    char* bytes = static_cast<char*>(data);
+    while (size > 0){
+        ssize_t received = ::read(m_fds[side], bytes, size);
+        if (received < 0 && errno == EINTR)
+            continue;
+        if (received <= 0){
+            std::cerr << "Error: lost connection to another simulation process\n";
+            Helper::quit(11);
+        }
+        bytes += received;
+        size -= received;
+    }
+}
+
+// Shared memory:
+
+struct SharedMemoryChannel::Ring {
+    pthread_mutex_t mutex;
+    pthread_cond_t changed; // Signalled whenever data is added or removed
+    std::size_t read_position; // Total bytes ever read. Both positions only go up, so used space is write_position - read_position
+    std::size_t write_position; // Total bytes ever written
+    char data[RING_CAPACITY];
+};
+
+SharedMemoryChannel::SharedMemoryChannel(){
+    for (Ring*& ring : m_rings){
+        void* memory = ::mmap(nullptr, sizeof(Ring), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+        if (memory == MAP_FAILED){
+            std::cerr << "Error: couldn't map shared memory: " << std::strerror(errno) << '\n';
+            Helper::quit(11);
+        }
+        ring = static_cast<Ring*>(memory);
+
+        pthread_mutexattr_t mutex_attributes;
+        pthread_mutexattr_init(&mutex_attributes);
+        pthread_mutexattr_setpshared(&mutex_attributes, PTHREAD_PROCESS_SHARED);
+        pthread_mutex_init(&ring->mutex, &mutex_attributes);
+        pthread_mutexattr_destroy(&mutex_attributes);
+
+        pthread_condattr_t cond_attributes;
+        pthread_condattr_init(&cond_attributes);
+        pthread_condattr_setpshared(&cond_attributes, PTHREAD_PROCESS_SHARED);
+        pthread_cond_init(&ring->changed, &cond_attributes);
+        pthread_condattr_destroy(&cond_attributes);
+
+        ring->read_position = 0;
+        ring->write_position = 0;
+    }
+}
+
+SharedMemoryChannel::~SharedMemoryChannel(){
+    // The mutexes live in memory that other processes may still have mapped, so they're just unmapped here, not destroyed
+    for (Ring* ring : m_rings){
+        if (ring)
+            ::munmap(ring, sizeof(Ring));
+    }
+}
+
+void SharedMemoryChannel::send(int side, const void* data, std::size_t size){
+    Ring* ring = m_rings[1 - side]; // The other side receives from this ring
+    const char* bytes = static_cast<const char*>(data);
+
+    pthread_mutex_lock(&ring->mutex);
+    while (size > 0){
+        while (ring->write_position - ring->read_position == RING_CAPACITY)
+            pthread_cond_wait(&ring->changed, &ring->mutex);
+
+        // Copy as much as fits before the ring is full or wraps around
+        std::size_t offset = ring->write_position % RING_CAPACITY;
+        std::size_t chunk = std::min({size, RING_CAPACITY - (ring->write_position - ring->read_position), RING_CAPACITY - offset});
+        std::memcpy(ring->data + offset, bytes, chunk);
+        ring->write_position += chunk;
+        bytes += chunk;
+        size -= chunk;
+        pthread_cond_broadcast(&ring->changed);
+    }
+    pthread_mutex_unlock(&ring->mutex);
+}
+
+void SharedMemoryChannel::receive(int side, void* data, std::size_t size){
+    Ring* ring = m_rings[side];
+    char* bytes = static_cast<char*>(data);
+
+    pthread_mutex_lock(&ring->mutex);
+    while (size > 0){
+        while (ring->write_position == ring->read_position)
+            pthread_cond_wait(&ring->changed, &ring->mutex);
+
+        std::size_t offset = ring->read_position % RING_CAPACITY;
+        std::size_t chunk = std::min({size, ring->write_position - ring->read_position, RING_CAPACITY - offset});
+        std::memcpy(bytes, ring->data + offset, chunk);
+        ring->read_position += chunk;
+        bytes += chunk;
+        size -= chunk;
+        pthread_cond_broadcast(&ring->changed);
+    }
+    pthread_mutex_unlock(&ring->mutex);
+}
@@ -0,0 +1,88 @@
+#ifndef CHANNEL_H
+#define CHANNEL_H
+
+#include <vector>
+#include <memory>
+#include <string>
+#include <cstddef>
+
+/*
+Two-way byte pipe between two processes on the same machine
+- A channel is made before fork() and has 2 sides (0 and 1). Each process only uses its own side
+- send() and receive() block until all of the bytes have been sent/received
+- Transports are pluggable: Unix sockets (socketpair()) or ring buffers in shared memory. See create()
+*/
+class Channel {
+    public:
+    virtual ~Channel() = default;
+
+    /*
+    - Send size bytes from data to the other side
+    */
+    virtual void send(int side, const void* data, std::size_t size) = 0;
+
+    /*
+    - Receive exactly size bytes from the other side into data
+    */
+    virtual void receive(int side, void* data, std::size_t size) = 0;
+
+    /*
+    - Send a whole message (its size, then its bytes), so the other side doesn't need to know how big it is
+    */
+    void sendMessage(int side, const std::vector<char>& message);
+
+    /*
+    - Receive a message sent with sendMessage(). message is resized to fit it
+    */
+    void receiveMessage(int side, std::vector<char>& message);
+
+    /*
+    - Make a channel using a transport: "socket" or "shm"
+    - Returns nullptr if the transport isn't recognized
+    */
+    static std::unique_ptr<Channel> create(const std::string& transport);
+};
+
+/*
+Channel over a Unix socket pair
+- If the other process goes away, send() and receive() quit (error 11)
+*/
+class SocketChannel : public Channel {
+    int m_fds[2]{-1, -1}; // m_fds[side] is the socket used by that side
+
+    public:
+    SocketChannel();
+    ~SocketChannel();
+
+    SocketChannel(const SocketChannel&) = delete;
+    SocketChannel& operator=(const SocketChannel&) = delete;
+
+    void send(int side, const void* data, std::size_t size) override;
+    void receive(int side, void* data, std::size_t size) override;
+};
+
+/*
+Channel over 2 ring buffers (one per direction) in shared memory
+- Each ring has a process-shared mutex and condition variable, so a blocked send()/receive() sleeps instead of spinning
+- Big messages are streamed through the ring in pieces, so they don't have to fit in it
+*/
+class SharedMemoryChannel : public Channel {
+    public:
+    static constexpr std::size_t RING_CAPACITY = 1 << 20; // Bytes per direction
+
+    private:
+    struct Ring;
+    Ring* m_rings[2]{nullptr, nullptr}; // m_rings[side] is the ring that side receives from
+
+    public:
+    SharedMemoryChannel();
+    ~SharedMemoryChannel();
+
+    SharedMemoryChannel(const SharedMemoryChannel&) = delete;
+    SharedMemoryChannel& operator=(const SharedMemoryChannel&) = delete;
+
+    void send(int side, const void* data, std::size_t size) override;
+    void receive(int side, void* data, std::size_t size) override;
+};
+
+#endif
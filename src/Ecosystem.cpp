@@ -1,18 +1,32 @@
 #include "Ecosystem.h"
 
+
 std::tuple<int, int> Ecosystem::getMapDimensions(const std::filesystem::path& file_path) {
-    std::ifstream file(file_path);
+    std::ifstream file(file_path, std::ios::binary);
 
     if (!file.is_open()) {
         std::cerr << "Error: Couldn't open " << file_path << " for reading\n";
         Helper::quit(1);
     }
 
+    return getMapDimensions(file);
+}
+
+std::tuple<int, int> Ecosystem::getMapDimensions(std::istream& file) {
+    // Binary maps have their dimensions in the header
+    if (MapFile::isBinaryMap(file)) {
+        MapFile::Reader reader(file, "binary map");
+        return {reader.getHeader().width, reader.getHeader().height};
+    }
+
     // Find map dimensions
     int width = 0;
     int height = 0;
     std::string line;
     while (std::getline(file, line)) {
+        if (!line.empty() && line.back() == '\r') // Ignore Windows line endings
+            line.pop_back();
+
         if (line.size() > width) { // Find max width
             width = line.size();
         }
@@ -23,19 +37,31 @@ std::tuple<int, int> Ecosystem::getMapDimensions(const std::filesystem::path& fi
 }
 
 void Ecosystem::getOrgCoords(const std::filesystem::path& file_path, std::vector<std::tuple<char, std::tuple<int, int>>>& organism_coords_vect, int offset) {
-    std::ifstream file_(file_path);
+    std::ifstream file_(file_path, std::ios::binary);
 
     if (!file_.is_open()){
         std::cerr << "Error: Couldn't open " << file_path << " for reading\n";
         Helper::quit(1);
     }
 
+    getOrgCoords(file_, organism_coords_vect, offset);
+}
+
+void Ecosystem::getOrgCoords(std::istream& file_, std::vector<std::tuple<char, std::tuple<int, int>>>& organism_coords_vect, int offset) {
+    if (MapFile::isBinaryMap(file_)) {
+        MapFile::readOrgCoords(file_, "binary map", organism_coords_vect, offset);
+        return;
+    }
+
     // Note: I'm doing an offset of x (each coordinate is x greater than actual value) because of the way I'm printing to terminal, and also to leave room for borders when printing
     // Note 2: This was a really stupid idea so I just default to offset = 0 now, but I'm still allowing the parameter just in case I want to change the code in the future
     int y_coord = offset;
     while (file_){
         std::string strInput;
         std::getline(file_, strInput);
+        if (!strInput.empty() && strInput.back() == '\r') // Ignore Windows line endings
+            strInput.pop_back();
+
         // Analyze line and extract any char info if char is found
         for(int i = 0; i < strInput.size(); i++){
             char c = strInput[i];
@@ -49,7 +75,6 @@ void Ecosystem::getOrgCoords(const std::filesystem::path& file_path, std::vector
 
         y_coord++;
     }
-    file_.close();
 }
 
 void Ecosystem::getSpeciesInfo(const std::filesystem::path& file_path, std::unordered_map<std::string, std::tuple<std::string, std::string, std::string>>& species_info) {
@@ -60,6 +85,10 @@ void Ecosystem::getSpeciesInfo(const std::filesystem::path& file_path, std::unor
         Helper::quit(3);
     }
 
+    getSpeciesInfo(file_, species_info, file_path.string());
+}
+
+void Ecosystem::getSpeciesInfo(std::istream& file_, std::unordered_map<std::string, std::tuple<std::string, std::string, std::string>>& species_info, const std::string& source_name) {
     std::string line;
     while (std::getline(file_, line)) {
         try {
@@ -71,88 +100,338 @@ void Ecosystem::getSpeciesInfo(const std::filesystem::path& file_path, std::unor
                 if (organismType == "plant" && iss >> health >> energy_points) { // Extract plant info (health + energy points)
                     species_info[organismCharID] = std::make_tuple(organismType, health, energy_points);
                 }
-                else if (iss >> health) { // Extract animal info (just health)
-                    species_info[organismCharID] = std::make_tuple(organismType, health, "");
+                else if (iss >> health) { // Extract animal info (health + optional vision radius)
+                    std::string vision_radius;
+                    iss >> vision_radius;
+                    species_info[organismCharID] = std::make_tuple(organismType, health, vision_radius);
                 }
             }
         } catch (...) {
-            std::cerr << "Error: Invalid formatting in " << file_path << '\n';
+            std::cerr << "Error: Invalid formatting in " << source_name << '\n';
             Helper::quit(6);
         }
     }
-    file_.close();
-}
-
-void Ecosystem::printEcosystem(const std::vector<Organism*>& organisms, const std::tuple<int, int>& map_dimensions) {
-    int map_offset = 1; // This is needed for printing alignment purposes
-    std::stringstream ss; // This is where we'll be making the ecosystem map
-
-    // Initialize empty map
-    int max_height = std::get<1>(map_dimensions) + 2, max_width = std::get<0>(map_dimensions) + 2;
-    for (int i = 0; i < max_height; i++){
-        for (int j = 0; j < max_width; j++){
-            // Print horizontal borders
-            if (i == 0 || i == (max_height - 1))
-                ss << '-';
-            
-            // Print vertical borders
-            else if (j == 0 || j == (max_width - 1))
-                ss << '|';
-            
-            else
-                ss << ' ';
+}
+
+Organism* Ecosystem::createOrganism(char org_char_ID, const std::tuple<int, int>& coords, const std::unordered_map<std::string, std::tuple<std::string, std::string, std::string>>& species_info) {
+    // Get organism info from species info map
+    auto info_it = species_info.find(std::string(1, org_char_ID));
+    if (info_it == species_info.end()) {
+        std::cerr << "Error: species info not found for organism " << org_char_ID << ". Please include this species in your species list"<< "\n";
+        Helper::quit(5);
+    }
+
+    const std::tuple<std::string, std::string, std::string>& info = info_it->second;
+    std::string species = std::get<0>(info);
+    int health;
+    try {
+        health = std::stoi(std::get<1>(info));
+    } catch (const std::invalid_argument&) {
+        std::cerr << "Error: Please give an integer value for " << species << " health\n";
+        Helper::quit(7);
+    }
+
+    // Create actual plant/animal objects
+    Organism* org_ptr = nullptr;
+    std::string lowercase_species;
+    std::transform(species.begin(), species.end(), std::back_inserter(lowercase_species), [](unsigned char c) { return std::tolower(c); });
+    try {
+        if (lowercase_species == "plant") {
+            int energy_points = std::stoi(std::get<2>(info));
+            org_ptr = new Plant(org_char_ID, energy_points, health, coords);
+        } 
+        else if (lowercase_species == "herbivore" || lowercase_species == "omnivore") {
+            Organism::OrganismType animal_type = (lowercase_species == "herbivore") ? Organism::HerbivoreEnum : Organism::OmnivoreEnum;
+            int vision_radius = std::get<2>(info).empty() ? 0 : std::stoi(std::get<2>(info));
+            if (vision_radius < 0) {
+                std::cerr << "Error: vision radius of " << org_char_ID << " can't be negative\n";
+                Helper::quit(6);
+            }
+            org_ptr = new Animal(org_char_ID, animal_type, health, coords, vision_radius);
+        } 
+        else {
+            std::cerr << "Error: Check if you misspelled a species name\n";
+            Helper::quit(6);
         }
-        ss << '\n';
+    } 
+    catch (const std::invalid_argument& e) {
+        std::cerr << "Error: Invalid arguments given for " << lowercase_species << std::endl;
+        Helper::quit(6);
     }
-    std::string ecosystem_str = ss.str();
+
+    return org_ptr;
+}
+
+void Ecosystem::loadOrganisms(const std::filesystem::path& map_file, const std::filesystem::path& species_file, OrganismPool& organisms, bool layer_plants) {
+    Scenario scenario;
+    scenario.map_dimensions = getMapDimensions(map_file);
+    getOrgCoords(map_file, scenario.organism_coords); // Get coordinate info for all organisms in the map
+    getSpeciesInfo(species_file, scenario.species_info);
+    createOrganisms(scenario, organisms, layer_plants);
+}
+
+void Ecosystem::parseScenario(const std::string& map_text, const std::string& species_text, Scenario& scenario) {
+    std::istringstream map_stream(map_text);
+    scenario.map_dimensions = getMapDimensions(map_stream);
+    map_stream.clear();
+    map_stream.seekg(0);
+    scenario.organism_coords.clear();
+    getOrgCoords(map_stream, scenario.organism_coords);
+
+    std::istringstream species_stream(species_text);
+    scenario.species_info.clear();
+    getSpeciesInfo(species_stream, scenario.species_info, "species list");
+}
+
+void Ecosystem::createOrganisms(const Scenario& scenario, OrganismPool& organisms, bool layer_plants) {
+    PlantLayer& plant_layer = organisms.getPlantLayer();
+    if (layer_plants)
+        plant_layer.resize(scenario.map_dimensions);
+
+    // Make organism objects
+    for (const auto& org : scenario.organism_coords) {
+        Organism* org_ptr = createOrganism(std::get<0>(org), std::get<1>(org), scenario.species_info);
+        if (org_ptr && layer_plants && org_ptr->getType() == Organism::PlantEnum) {
+            // Only one plant object exists at a time, so a map full of plants never needs all of them in memory
+            Plant* plant {dynamic_cast<Plant*>(org_ptr)};
+            int species = plant_layer.addSpecies(plant->getLetterID(), plant->getEnergyPoints(), plant->getRegrowthCoefficient());
+            plant_layer.addPlant(plant->getCoords(), species, plant->getCurrentHealth(), plant->isAlive());
+            delete plant;
+        }
+        else if (org_ptr) {
+            organisms.insert(org_ptr);
+        }
+    }
+
+    // Organisms stay in the row-major order of the map file, so they're updated in the same order as they always have been.
+    // Only engines made with the morton option re-sort them (see cleanUpEcosystem())
+}
+
+void Ecosystem::movePlantsToLayer(OrganismPool& organisms, const std::tuple<int, int>& map_dimensions) {
+    PlantLayer& plant_layer = organisms.getPlantLayer();
+    plant_layer.resize(map_dimensions);
+
+    // Animals stay in the same order
+    organisms.eraseIf([&plant_layer](const Organism* org) {
+        const Plant* plant {dynamic_cast<const Plant*>(org)};
+        if (!plant)
+            return false;
+
+        int species = plant_layer.addSpecies(plant->getLetterID(), plant->getEnergyPoints(), plant->getRegrowthCoefficient());
+        plant_layer.addPlant(plant->getCoords(), species, plant->getCurrentHealth(), plant->isAlive());
+        return true;
+    });
+}
+
+void Ecosystem::generateOrganisms(const std::tuple<int, int>& map_dimensions, double density, const std::filesystem::path& species_file, unsigned int seed, OrganismPool& organisms) {
+    std::unordered_map<std::string, std::tuple<std::string, std::string, std::string>> species_info;
+    getSpeciesInfo(species_file, species_info);
+    if (species_info.empty()) {
+        std::cerr << "Error: " << species_file << " doesn't have any species in it\n";
+        Helper::quit(6);
+    }
+
+    // Sort species letter IDs so the generated map only depends on the seed, not on the order of the unordered map
+    std::vector<char> species_letter_IDs;
+    for (const auto& species : species_info)
+        species_letter_IDs.push_back(species.first[0]);
+    std::sort(species_letter_IDs.begin(), species_letter_IDs.end());
+
+    // Fill each cell with a random species with probability density
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<double> cell_roll(0.0, 1.0);
+    std::uniform_int_distribution<int> species_roll(0, species_letter_IDs.size() - 1);
+    for (int y = 0; y < std::get<1>(map_dimensions); y++){
+        for (int x = 0; x < std::get<0>(map_dimensions); x++){
+            if (cell_roll(rng) >= density)
+                continue;
+
+            Organism* org_ptr = createOrganism(species_letter_IDs[species_roll(rng)], {x, y}, species_info);
+            if (org_ptr)
+                organisms.insert(org_ptr);
+        }
+    }
+}
+
+void Ecosystem::updateEcosystem(OrganismPool& organisms, const std::tuple<int, int>& map_dimensions, long long iteration, bool reorder) {
+    // Only built if some animal can see further than right next to it. Kept around between calls so building doesn't need to allocate
+    // (one per thread, since several worlds can be updated at once)
+    thread_local SpatialIndex spatial_index;
+    bool spatial_index_built = false;
+
+    // Kept up to date by the organisms themselves, so it only has to be rebuilt if something else changed them since the last call
+    thread_local FreeMaskGrid free_masks;
+    if (!free_masks.isInSyncWith(organisms, map_dimensions))
+        free_masks.rebuild(organisms.getOrganisms(), map_dimensions);
+
+    // Update organisms. Plants and animals are mixed together, so with hardware counters on, the whole loop is one phase (switching for
+    // every organism would mostly count the reads of the counters)
+    {
+        PerfCounters::Scope phase_scope(PerfCounters::OrganismUpdate, organisms.size());
+        for (Organism* org : organisms.getOrganisms()){
+            if (org->getType() == Organism::PlantEnum){
+                Plant* plant {dynamic_cast<Plant*>(org)};
+                plant->update(organisms.getOrganisms(), map_dimensions, organisms.getWorldHashState(), free_masks);
+            }
+            else{
+                Animal* animal {dynamic_cast<Animal*>(org)};
+                if (animal->getVisionRadius() > 0 && !spatial_index_built){
+                    spatial_index.build(organisms.getOrganisms(), map_dimensions);
+                    spatial_index_built = true;
+                }
+                animal->update(organisms.getOrganisms(), map_dimensions, organisms.getWorldHashState(), free_masks, spatial_index_built ? &spatial_index : nullptr);
+            }
+        }
+    }
+
+    cleanUpEcosystem(organisms, iteration, reorder);
+    free_masks.markInSync(organisms);
+}
+
+void Ecosystem::cleanUpEcosystem(OrganismPool& organisms, long long iteration, bool reorder) {
+    PerfCounters::Scope phase_scope(PerfCounters::Cleanup, organisms.size());
+
+    // Clean up any eaten animals (this frees their memory), keeping everyone else in the same order
+    int erased = organisms.eraseIf([](const Organism* org) { return !org->isAlive() && (org->getType() != Organism::PlantEnum); });
+    Metrics::local().cleanup_erases += erased;
+
+    // Keep organisms that are next to each other on the map next to each other in memory
+    if (reorder && iteration % REORDER_INTERVAL == 0)
+        reorderOrganisms(organisms, REORDER_THRESHOLD);
+}
+
+std::string Ecosystem::getMemoryReport(const OrganismPool& organisms, const std::tuple<int, int>& map_dimensions) {
+    long long plants = 0, animals = 0;
+    for (const Organism* org : organisms.getOrganisms())
+        (org->getType() == Organism::PlantEnum ? plants : animals)++;
+    long long layer_plants = organisms.getPlantLayer().getPlantCount();
+    long long total_organisms = plants + animals + layer_plants;
+
+    // Every organism is its own heap block, plus a pointer in the dense list, its slot and its dense-to-slot entry in the pool
+    std::size_t plant_block = OrganismArena::getBlockSize(sizeof(Plant)), animal_block = OrganismArena::getBlockSize(sizeof(Animal));
+    std::size_t pool_entry = sizeof(Organism*) + sizeof(OrganismHandle) + sizeof(std::uint32_t);
+    std::size_t index_bytes = organisms.getIndexMemoryUsage();
+    std::size_t layer_bytes = organisms.getPlantLayer().getMemoryUsage();
+    std::size_t plant_bytes = plants * plant_block, animal_bytes = animals * animal_block;
+    std::size_t total_bytes = plant_bytes + animal_bytes + index_bytes + layer_bytes;
+
+    std::ostringstream report;
+    report << std::fixed << std::setprecision(1);
+    auto printBytes = [&report](const std::string& name, std::size_t bytes) {
+        report << "  " << std::left << std::setw(22) << name << std::right << std::setw(16) << bytes << " bytes (" << (bytes / 1048576.0) << " MiB)\n";
+    };
+
+    report << "Memory report: " << std::get<0>(map_dimensions) << "x" << std::get<1>(map_dimensions) << " map, " << total_organisms << " organisms ("
+        << plants << " plant objects, " << animals << " animals, " << layer_plants << " plants in the plant layer)\n";
+    report << "Per organism:\n";
+    report << "  Plant object          " << sizeof(Plant) << " bytes, " << plant_block << " with malloc's header and rounding\n";
+    report << "  Animal object         " << sizeof(Animal) << " bytes, " << animal_block << " with malloc's header and rounding\n";
+    report << "  Pool bookkeeping      " << pool_entry << " bytes (pointer, slot, dense-to-slot entry)\n";
+    report << "  Plant layer cell      " << sizeof(std::uint32_t) << " bytes per cell of the map, whether it has a plant or not\n";
+    report << "Totals:\n";
+    printBytes("Plant objects", plant_bytes);
+    printBytes("Animal objects", animal_bytes);
+    printBytes("Pool bookkeeping", index_bytes);
+    printBytes("Plant layer", layer_bytes);
+    printBytes("Total", total_bytes);
+    report << "  " << std::setprecision(1) << (total_bytes / static_cast<double>(std::max(1LL, total_organisms))) << " bytes per organism\n";
+
+    // The layered engines move every plant object into a layer the size of the map, and keep their own copy of the update order
+    // (a 4-byte entry per organism, a 4-byte place per cell, and a pointer and place per animal), so show what that would come to as well
+    std::size_t order_bytes = (total_organisms * sizeof(std::uint32_t)) + (static_cast<std::size_t>(std::get<0>(map_dimensions)) * std::get<1>(map_dimensions) * sizeof(std::uint32_t))
+        + (animals * (sizeof(Animal*) + sizeof(std::uint32_t)));
+    std::size_t layered_bytes = animal_bytes + (animals * pool_entry) + PlantLayer::estimateMemoryUsage(map_dimensions) + order_bytes;
+    report << "With plants in a plant layer (layered and hybrid engines):\n";
+    printBytes("Total", layered_bytes);
+    report << "  " << (layered_bytes / static_cast<double>(std::max(1LL, total_organisms))) << " bytes per organism\n";
+    return report.str();
+}
+
+void Ecosystem::printEcosystem(const std::vector<Organism*>& organisms, const std::tuple<int, int>& map_dimensions, const PlantLayer* plant_layer) {
+    PerfCounters::Scope phase_scope(PerfCounters::Render, organisms.size());
+    int width = std::get<0>(map_dimensions), height = std::get<1>(map_dimensions);
+
+    // These buffers are kept around between calls (one set per thread) so printing doesn't need to allocate once they've grown big enough
+    thread_local std::vector<const Organism*> cells; // cells[(y * width) + x] is the living organism at (x, y), or nullptr if there is none
+    thread_local std::string ecosystem_str; // This is where we'll be making the ecosystem map
 
     // Take note of where each organism needs to be plotted
-    // The pair is {index in ss string where org should be inserted (i had to do some math to figure this out), org colored ID (this is a string bc I need a bunch of weird characters to produce the color along w/ the actual ID char)}
-    std::vector<std::pair<int, std::string>> plotting_info;
+    cells.assign(width * height, nullptr);
     for (Organism* org : organisms){
         if (!org->isAlive())
             continue;
-        
-        // Get organism info
+
         std::tuple<int, int> coords = org->getCoords();
-        int x_coord = std::get<0>(coords) + map_offset, y_coord = std::get<1>(coords) + map_offset;
-
-        // Calculate where organism needs to be plotted & take note
-        int map_coord = ((max_width + 1) * y_coord) + x_coord;
-        std::string colored_ID = org->getLetterIDColored();
-        plotting_info.push_back({map_coord, colored_ID});
-    }
-
-    // Plot organisms
-    /*
-    Note: I'm plotting organisms from bottom to top.
-    This is because when i "plot" an organism, I'm literally inserting this organism's colored ID (which is a long string that displays as colored output) into ss.
-    This causes ss to be sort of "extended". For example, imagine this is ss: "abcdefg" and I want to add "hello" and "world" at indexes 2 and 5 respectively.
-    If I add "hello" first at index 2, ss becomes "abhellocdefg". Notice that now, index 5 is right after 'l' rather than 'e' because adding the "hello" ended up extending ss and messing with its old indexing.
-    But this problem can be fixed if I just add the bottom-most words first, i.e. first add "world" at index 5 and then "hello" at index 2. ss will then look like:
-    - "abcdehellofg" after adding 1st word
-    - "abhellocdehellofg" after adding 2nd word
-    This is the same logic I'm applying to plot the organisms and not mess up their spacing on the map.
-    */
-    while (!plotting_info.empty()) {
-        // Find highest organism
-        int highest_map_coords = -1;
-        for (const auto& info : plotting_info) {
-            if (info.first > highest_map_coords)
-                highest_map_coords = info.first;
-        }
+        int x_coord = std::get<0>(coords), y_coord = std::get<1>(coords);
+        if (x_coord >= 0 && x_coord < width && y_coord >= 0 && y_coord < height)
+            cells[(y_coord * width) + x_coord] = org;
+    }
 
-        // Plot this organism
-        for (auto it = plotting_info.begin(); it != plotting_info.end(); ++it) {
-            if (it->first != highest_map_coords)
-                continue;
+    if (plant_layer && plant_layer->empty())
+        plant_layer = nullptr;
 
-            ecosystem_str.replace(highest_map_coords, 1, it->second);
-            it = plotting_info.erase(it); // Erase the organism from the plotting list
-            break; // Exit the loop after plotting one organism
+    // Print map row by row, with borders around it
+    ecosystem_str.clear();
+    ecosystem_str.append(width + 2, '-'); // Top border
+    ecosystem_str += '\n';
+    for (int y = 0; y < height; y++){
+        ecosystem_str += '|';
+        for (int x = 0; x < width; x++){
+            const Organism* org = cells[(y * width) + x];
+            if (org)
+                org->appendLetterIDColored(ecosystem_str); // Colored ID is a bunch of weird characters that produce the color along w/ the actual ID char
+            else if (plant_layer && plant_layer->isAlive(plant_layer->getCellIndex(x, y)))
+                ecosystem_str += plant_layer->getSpecies(plant_layer->getCellIndex(x, y)).letter_id;
+            else
+                ecosystem_str += ' ';
         }
+        ecosystem_str += "|\n";
     }
+    ecosystem_str.append(width + 2, '-'); // Bottom border
+    ecosystem_str += '\n';
 
     std::cout << ecosystem_str;
     return;
+}
+
+std::uint64_t Ecosystem::getMortonKey(const std::tuple<int, int>& coords) {
+    // Spread the bits of a 32-bit value so there is a 0 bit between each of them (abcd --> 0a0b0c0d)
+    auto spreadBits = [](std::uint64_t v) {
+        v &= 0xFFFFFFFFull;
+        v = (v | (v << 16)) & 0x0000FFFF0000FFFFull;
+        v = (v | (v << 8)) & 0x00FF00FF00FF00FFull;
+        v = (v | (v << 4)) & 0x0F0F0F0F0F0F0F0Full;
+        v = (v | (v << 2)) & 0x3333333333333333ull;
+        v = (v | (v << 1)) & 0x5555555555555555ull;
+        return v;
+    };
+
+    // x-coordinate goes in the even bits, y-coordinate goes in the odd bits
+    return spreadBits(static_cast<std::uint32_t>(std::get<0>(coords))) | (spreadBits(static_cast<std::uint32_t>(std::get<1>(coords))) << 1);
+}
+
+double Ecosystem::getMortonDisorder(const std::vector<Organism*>& organisms) {
+    return getMortonDisorder(organisms, [](const Organism* org) { return getMortonKey(org->getCoords()); });
+}
+
+bool Ecosystem::comesFirst(const Organism* a, const Organism* b) {
+    // Plants never share a cell, so at most one of them is a plant
+    if ((a->getType() == Organism::PlantEnum) != (b->getType() == Organism::PlantEnum))
+        return a->getType() == Organism::PlantEnum;
+    return a->getID() < b->getID();
+}
+
+bool Ecosystem::reorderOrganisms(std::vector<Organism*>& organisms, double disorder_threshold) {
+    return reorderByMortonKey(organisms, disorder_threshold, [](const Organism* org) { return getMortonKey(org->getCoords()); }, comesFirst);
+}
+
+bool Ecosystem::reorderOrganisms(OrganismPool& pool, double disorder_threshold) {
+    if (getMortonDisorder(pool.getOrganisms()) <= disorder_threshold)
+        return false;
+
+    thread_local std::vector<Organism*> new_order;
+    new_order = pool.getOrganisms();
+    reorderOrganisms(new_order, disorder_threshold);
+    pool.setOrder(new_order);
+    return true;
 }
\ No newline at end of file
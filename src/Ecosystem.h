@@ -7,16 +7,37 @@
 #include <string>
 #include <algorithm>
 #include <random>
+#include <cstdint>
+#include <iomanip>
+#include <sstream>
 
 #include "Plant.h"
 #include "Animal.h"
+#include "OrganismPool.h"
+#include "FreeMaskGrid.h"
+#include "SteadyStateDetector.h"
+#include "Metrics.h"
+#include "PerfCounters.h"
 #include "Ecosystem.h"
 #include "Helper.h"
+#include "MapFile.h"
 
 using namespace std::string_literals;
 
 class Ecosystem {
 public:
+    static constexpr int REORDER_INTERVAL = 16; // How often (in iterations) to check if organisms need to be re-sorted by Morton order
+    static constexpr double REORDER_THRESHOLD = 0.05; // Re-sort organisms once more than this fraction of them are out of Morton order
+
+    /*
+    Everything read from a map file and a species list, before any organisms are made from it
+    - Making organisms from a Scenario (createOrganisms()) is the same as loading them from the files, so a parsed Scenario can be reused
+    */
+    struct Scenario {
+        std::tuple<int, int> map_dimensions{};
+        std::vector<std::tuple<char, std::tuple<int, int>>> organism_coords; // See getOrgCoords()
+        std::unordered_map<std::string, std::tuple<std::string, std::string, std::string>> species_info; // See getSpeciesInfo()
+    };
 
     /*
     - Given the path to a map, this will return a tuple containing the map dimensions
@@ -24,22 +45,200 @@ public:
     */
     static std::tuple<int, int> getMapDimensions(const std::filesystem::path& file_path);
 
+    /*
+    - Same as above, but reads the map from a stream
+    */
+    static std::tuple<int, int> getMapDimensions(std::istream& file);
+
     /*
     - Give the path to the map and the vector you want the results to be saved to
     - This will update the vector so that it's like ('a', <x_coordinates, y_coordinates>) where 'a' is the letter ID of the organism, and the tuple is the organism's coordinates
     */
     static void getOrgCoords(const std::filesystem::path& file_path, std::vector<std::tuple<char, std::tuple<int, int>>>& organism_coords_vect, int offset = 0);
 
+    /*
+    - Same as above, but reads the map from a stream
+    */
+    static void getOrgCoords(std::istream& file, std::vector<std::tuple<char, std::tuple<int, int>>>& organism_coords_vect, int offset = 0);
+
     /*
     - Give the path to the species list and the unordered map you want the info to be stored in
     - The info will be stored in the unordered map like (char (species letter id), <organism type, health, energy points (only if it's a plant)>)
     */
     static void getSpeciesInfo(const std::filesystem::path& file_path, std::unordered_map<std::string, std::tuple<std::string, std::string, std::string>>& species_info);
 
+    /*
+    - Same as above, but reads the species list from a stream. source_name is used in error messages
+    */
+    static void getSpeciesInfo(std::istream& file, std::unordered_map<std::string, std::tuple<std::string, std::string, std::string>>& species_info, const std::string& source_name);
+
+    /*
+    - Create the organism with letter ID org_char_ID at coords, using the info about its species in species_info (see getSpeciesInfo())
+    - Quits with an error if the species isn't in species_info or its info is invalid
+    */
+    static Organism* createOrganism(char org_char_ID, const std::tuple<int, int>& coords, const std::unordered_map<std::string, std::tuple<std::string, std::string, std::string>>& species_info);
+
+    /*
+    - Given the paths to a map and a species list, create every organism in the map and add it to organisms
+    - If layer_plants is true, plants go straight into the pool's plant layer instead of becoming Plant objects (see PlantLayer)
+    - Organisms start out in the row-major order of the map, like they always have (they're only re-sorted by Morton order later)
+    */
+    static void loadOrganisms(const std::filesystem::path& map_file, const std::filesystem::path& species_file, OrganismPool& organisms, bool layer_plants = false);
+
+    /*
+    - Parse the text of a map and a species list into scenario, without making any organisms
+    */
+    static void parseScenario(const std::string& map_text, const std::string& species_text, Scenario& scenario);
+
+    /*
+    - Make every organism in scenario and add it to organisms. Same as loadOrganisms() with the files scenario was parsed from,
+      including how many random numbers get used up (organism colors are random)
+    */
+    static void createOrganisms(const Scenario& scenario, OrganismPool& organisms, bool layer_plants = false);
+
+    /*
+    - Move every Plant object in organisms into the pool's plant layer, keeping its state
+    - The world hash doesn't change, since layered plants hash the same as Plant objects
+    */
+    static void movePlantsToLayer(OrganismPool& organisms, const std::tuple<int, int>& map_dimensions);
+
+    /*
+    - Fill a map of size map_dimensions with random organisms from the species list, so that roughly density (0 to 1) of all cells are occupied
+    - The same seed always generates the same map
+    */
+    static void generateOrganisms(const std::tuple<int, int>& map_dimensions, double density, const std::filesystem::path& species_file, unsigned int seed, OrganismPool& organisms);
+
+    /*
+    - Run 1 iteration of the simulation:
+        1. Update every organism (animals with a vision radius look around using a SpatialIndex, and every animal moves to a free cell from a
+           FreeMaskGrid that's kept from call to call and only rebuilt when organisms changed in between)
+        2. Clean up any eaten/starved animals, keeping everyone else in the same order
+        3. With reorder, every REORDER_INTERVAL iterations, re-sort organisms by Morton order if they've gotten too scattered
+    - Organisms are updated in pool order, and the order decides things like which of two animals gets to a plant first. Without reorder,
+      organisms stay in the order they were loaded in, so results are the same as the program's before re-sorting existed. With it, results
+      are different from the first re-sort on (the "reference:morton" engine, see Engine::create())
+    - iteration is the number of this iteration (starting from 1)
+    - Once buffers have grown to fit the ecosystem, this doesn't allocate any memory
+    */
+    static void updateEcosystem(OrganismPool& organisms, const std::tuple<int, int>& map_dimensions, long long iteration, bool reorder = false);
+
+    /*
+    - Steps 2 and 3 of updateEcosystem(). Engines that update organisms differently should still call this at the end of every iteration
+    */
+    static void cleanUpEcosystem(OrganismPool& organisms, long long iteration, bool reorder = false);
+
     /*
     - Given a vector of organisms and map dimensions, print the current ecosystem
+    - Living plants in plant_layer (layered engines) are printed too, without color since they don't have one
+    - Once its buffers have grown to fit the map, this doesn't allocate any memory
+    */
+    static void printEcosystem(const std::vector<Organism*>& organisms, const std::tuple<int, int>& map_dimensions, const PlantLayer* plant_layer = nullptr);
+
+    /*
+    - Report of how much memory organisms takes: bytes per organism of each kind (object, heap block, pool bookkeeping) and totals for each
+      part of the world, plus what the same world would take with plants in a PlantLayer (layered engines), for capacity planning
+    */
+    static std::string getMemoryReport(const OrganismPool& organisms, const std::tuple<int, int>& map_dimensions);
+
+    /*
+    - Given coordinates, return their Z-order (Morton) key by interleaving the bits of x and y
+    - Organisms that are close to each other on the map will usually have keys that are close to each other
+    */
+    static std::uint64_t getMortonKey(const std::tuple<int, int>& coords);
+
+    /*
+    - Given a vector of organisms, return the fraction (0 to 1) of neighboring vector entries that are out of Morton order
+    - 0 means the vector is fully sorted by Morton key
+    */
+    static double getMortonDisorder(const std::vector<Organism*>& organisms);
+
+    /*
+    - Re-sort organisms by the Morton key of their coordinates, but only if their disorder is above disorder_threshold
+    - Sorting is incremental: entries that are already in order stay where they are, and only the displaced entries get sorted and merged back in
+    - Displaced organisms with the same key (an animal standing on a dead plant) are ordered by comesFirst()
+    - Returns true if the organisms were re-sorted
+    */
+    static bool reorderOrganisms(std::vector<Organism*>& organisms, double disorder_threshold);
+
+    /*
+    - How reorderOrganisms() orders two organisms in the same cell: a plant goes first, then animals by ID
     */
-    static void printEcosystem(const std::vector<Organism*>& organisms, const std::tuple<int, int>& map_dimensions);
+    static bool comesFirst(const Organism* a, const Organism* b);
+
+    /*
+    - Same as getMortonDisorder() and reorderOrganisms(), for a list of anything. getKey(entry) gives an entry's Morton key, and
+      comesFirst(a, b) orders entries with the same key
+    */
+    template <typename Entry, typename GetKey>
+    static double getMortonDisorder(const std::vector<Entry>& entries, GetKey getKey);
+
+    template <typename Entry, typename GetKey, typename ComesFirst>
+    static bool reorderByMortonKey(std::vector<Entry>& entries, double disorder_threshold, GetKey getKey, ComesFirst comesFirst);
+
+    /*
+    - Same as above, but re-sorts the organisms stored in pool (handles stay valid)
+    */
+    static bool reorderOrganisms(OrganismPool& pool, double disorder_threshold);
 };
 
+template <typename Entry, typename GetKey>
+double Ecosystem::getMortonDisorder(const std::vector<Entry>& entries, GetKey getKey) {
+    if (entries.size() < 2)
+        return 0.0;
+
+    // Count how many neighboring entries are in the wrong order
+    std::size_t out_of_order = 0;
+    std::uint64_t previous_key = getKey(entries[0]);
+    for (std::size_t i = 1; i < entries.size(); i++){
+        std::uint64_t key = getKey(entries[i]);
+        if (key < previous_key)
+            out_of_order++;
+        previous_key = key;
+    }
+
+    return static_cast<double>(out_of_order) / (entries.size() - 1);
+}
+
+template <typename Entry, typename GetKey, typename ComesFirst>
+bool Ecosystem::reorderByMortonKey(std::vector<Entry>& entries, double disorder_threshold, GetKey getKey, ComesFirst comesFirst) {
+    if (getMortonDisorder(entries, getKey) <= disorder_threshold)
+        return false;
+
+    // These buffers are kept around between calls so re-sorting doesn't need to allocate once they've grown big enough
+    // (one per thread, since several worlds can be updated at once)
+    thread_local std::vector<std::pair<std::uint64_t, Entry>> in_order;
+    thread_local std::vector<std::pair<std::uint64_t, Entry>> displaced;
+    in_order.clear();
+    displaced.clear();
+    in_order.reserve(entries.size()); // Either buffer might end up holding every entry
+    displaced.reserve(entries.size());
+
+    // Split entries into the ones that are still in ascending Morton order and the ones that moved out of place
+    for (const Entry& entry : entries){
+        std::uint64_t key = getKey(entry);
+        if (in_order.empty() || key >= in_order.back().first)
+            in_order.push_back({key, entry});
+        else
+            displaced.push_back({key, entry});
+    }
+
+    // Only the displaced entries need to be sorted. Then merge them back in with the ones that were already in order
+    // Entries with equal keys are ordered by comesFirst so the result doesn't depend on how the sort works
+    // (std::sort is used rather than std::stable_sort because std::stable_sort allocates a temporary buffer)
+    std::sort(displaced.begin(), displaced.end(), [&comesFirst](const std::pair<std::uint64_t, Entry>& a, const std::pair<std::uint64_t, Entry>& b) {
+        return a.first != b.first ? a.first < b.first : comesFirst(a.second, b.second);
+    });
+
+    auto in_order_it = in_order.begin();
+    auto displaced_it = displaced.begin();
+    for (Entry& entry : entries){
+        if (displaced_it == displaced.end() || (in_order_it != in_order.end() && displaced_it->first >= in_order_it->first))
+            entry = (in_order_it++)->second;
+        else
+            entry = (displaced_it++)->second;
+    }
+
+    return true;
+}
+
 #endif
\ No newline at end of file
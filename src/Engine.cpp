@@ -0,0 +1,98 @@
+#include "Engine.h"
+#include "GridEngine.h"
+#include "ParallelEngine.h"
+#include "LayeredEngine.h"
+#include "ProcessEngine.h"
+
+std::unique_ptr<Engine> Engine::create(const std::string& name, unsigned int seed){
+    if (name == "reference" || name == "reference:morton")
+        return std::make_unique<ReferenceEngine>(name == "reference:morton");
+
+    if (name == "grid" || name == "grid:morton")
+        return std::make_unique<GridEngine>(name == "grid:morton");
+
+    if (name == "layered")
+        return std::make_unique<LayeredEngine>();
+    if (name == "hybrid")
+        return std::make_unique<LayeredEngine>(true);
+
+    const std::string PARALLEL_PREFIX = "parallel:";
+    if (name.compare(0, PARALLEL_PREFIX.size(), PARALLEL_PREFIX) == 0){
+        try {
+            int thread_count = std::stoi(name.substr(PARALLEL_PREFIX.size()));
+            if (thread_count > 0)
+                return std::make_unique<ParallelEngine>(thread_count, seed);
+        } catch (const std::exception&) {}
+    }
+
+    const std::string PROCESSES_PREFIX = "processes:";
+    if (name.compare(0, PROCESSES_PREFIX.size(), PROCESSES_PREFIX) == 0){
+        std::string options = name.substr(PROCESSES_PREFIX.size());
+        std::string transport = "socket";
+        std::size_t colon = options.find(':');
+        if (colon != std::string::npos){
+            transport = options.substr(colon + 1);
+            options = options.substr(0, colon);
+        }
+        try {
+            int process_count = std::stoi(options);
+            if (process_count > 0 && (transport == "socket" || transport == "shm")){
+                auto engine = std::make_unique<ProcessEngine>(process_count, seed, transport);
+                engine->start();
+                return engine;
+            }
+        } catch (const std::exception&) {}
+    }
+
+    return nullptr;
+}
+
+void Engine::run(OrganismPool& organisms, const std::tuple<int, int>& map_dimensions, long long first_iteration, long long iteration_count){
+    for (long long iteration = first_iteration; iteration < first_iteration + iteration_count; iteration++)
+        update(organisms, map_dimensions, iteration);
+}
+
+bool Engine::supportsVision() const{
+    return false;
+}
+
+void Engine::checkVision(const OrganismPool& organisms){
+    if (&organisms == m_vision_checked_pool && organisms.getChangeCount() == m_vision_checked_changes)
+        return;
+
+    for (const Organism* org : organisms.getOrganisms()){
+        if (!supportsVision() && org->getType() != Organism::PlantEnum && static_cast<const Animal*>(org)->getVisionRadius() > 0){
+            std::cerr << "Error: " << org->getLetterID() << " has a vision radius, but the " << getName() << " engine doesn't support vision (use reference or grid)\n";
+            Helper::quit(6);
+        }
+    }
+    m_vision_checked_pool = &organisms;
+    m_vision_checked_changes = organisms.getChangeCount();
+}
+
+std::string Engine::getBaselineName(const std::string& name){
+    if (name.compare(0, 9, "parallel:") == 0 || name.compare(0, 10, "processes:") == 0)
+        return "parallel:1";
+    if (name == "reference:morton" || name == "grid:morton")
+        return "reference:morton";
+
+    return "reference";
+}
+
+bool Engine::isEquivalentToReference(const std::string& name){
+    return getBaselineName(name) == "reference";
+}
+
+ReferenceEngine::ReferenceEngine(bool reorder) : m_reorder(reorder) {}
+
+std::string ReferenceEngine::getName() const{
+    return m_reorder ? "reference:morton" : "reference";
+}
+
+bool ReferenceEngine::supportsVision() const{
+    return true;
+}
+
+void ReferenceEngine::update(OrganismPool& organisms, const std::tuple<int, int>& map_dimensions, long long iteration){
+    Ecosystem::updateEcosystem(organisms, map_dimensions, iteration, m_reorder);
+}
@@ -0,0 +1,98 @@
+#ifndef ENGINE_H
+#define ENGINE_H
+
+#include "Ecosystem.h"
+
+#include <memory>
+#include <string>
+
+/*
+Interface for the different ways of running an iteration of the simulation
+- Every engine runs the same steps as Ecosystem::updateEcosystem() (update organisms, clean up, and re-sort if asked to), but can do the
+  first step differently
+*/
+class Engine {
+    public:
+    virtual ~Engine() = default;
+
+    /*
+    - Name that create() understands, e.g. "reference" or "parallel:4"
+    */
+    virtual std::string getName() const = 0;
+
+    /*
+    - Run 1 iteration of the simulation. iteration is the number of this iteration (starting from 1)
+    */
+    virtual void update(OrganismPool& organisms, const std::tuple<int, int>& map_dimensions, long long iteration) = 0;
+
+    /*
+    - Run iterations first_iteration to first_iteration + iteration_count - 1. Ends in the same state as calling update() for each of them
+    - By default this just calls update(). Engines that have to gather the world back up after every update() (see ProcessEngine) override
+      this so they only do it once at the end
+    */
+    virtual void run(OrganismPool& organisms, const std::tuple<int, int>& map_dimensions, long long first_iteration, long long iteration_count);
+
+    /*
+    - Whether animals use their vision radius in this engine (see Animal::getPreferredDirections()). Engines that don't would just ignore it
+      and give different results, so they refuse to run worlds that need it (see checkVision())
+    */
+    virtual bool supportsVision() const;
+
+    /*
+    - Make an engine from its name:
+        "reference"    - Ecosystem::updateEcosystem(), the behavior every other engine is checked against
+        "grid"         - GridEngine, same results as "reference"
+        "reference:morton", "grid:morton" - Same, but organisms are re-sorted by Morton order every so often, which changes results
+                         (see Ecosystem::updateEcosystem()). Only these two re-sort, and they only match each other
+        "parallel:N"   - ParallelEngine with N threads (same results for every N, but not the same as "reference")
+        "layered"      - LayeredEngine, which keeps plants in a PlantLayer (same results as "reference")
+        "hybrid"       - LayeredEngine in hybrid mode, which skips regrowing plants far from animals until they're needed (same results as "reference")
+        "processes:N"  - ProcessEngine with N worker processes talking over Unix sockets (same results as "parallel:1"). Its workers
+                         are forked here, so make it before starting any other threads
+        "processes:N:shm" - Same, but talking over shared memory
+    - seed is only used by engines that seed their own random engines
+    - Returns nullptr if the name isn't recognized
+    */
+    static std::unique_ptr<Engine> create(const std::string& name, unsigned int seed);
+
+    /*
+    - Name of the engine whose results the given engine is supposed to match exactly
+    - This is "reference" for engines that match the reference engine, "reference:morton" for "grid:morton", and "parallel:1" for parallel
+      and multi-process engines
+    - "reference", "reference:morton" and "parallel:1" are their own baseline. Comparing them with it can't find anything, so the harness refuses to
+    */
+    static std::string getBaselineName(const std::string& name);
+
+    /*
+    - Whether the given engine gives the same results as "reference". Parallel and multi-process engines don't: they update organisms
+      in a different order by design, so they only match "parallel:1"
+    */
+    static bool isEquivalentToReference(const std::string& name);
+
+    protected:
+    /*
+    - Quits (error 6) if some animal in organisms has a vision radius and this engine doesn't support vision
+    - The organisms are only looked through again once they've changed (see OrganismPool::getChangeCount())
+    */
+    void checkVision(const OrganismPool& organisms);
+
+    private:
+    const OrganismPool* m_vision_checked_pool{nullptr}; // Pool checkVision() last looked through
+    std::uint64_t m_vision_checked_changes{0}; // Its change count at the time
+};
+
+/*
+Engine that just calls Ecosystem::updateEcosystem()
+*/
+class ReferenceEngine : public Engine {
+    bool m_reorder; // Re-sort organisms by Morton order ("reference:morton")
+
+    public:
+    explicit ReferenceEngine(bool reorder = false);
+
+    std::string getName() const override;
+    bool supportsVision() const override;
+    void update(OrganismPool& organisms, const std::tuple<int, int>& map_dimensions, long long iteration) override;
+};
+
+#endif
@@ -0,0 +1,77 @@
+#include "FreeMaskGrid.h"
+#include "OrganismPool.h"
+#include "Animal.h"
+
+// Private methods:
+
+void FreeMaskGrid::setOccupied(int x_coord, int y_coord, bool occupied){
+    // The cell in direction d sees this cell in the opposite direction (d ^ 1)
+    int cell = (y_coord * m_width) + x_coord;
+    for (int directions = m_masks[cell] >> IN_MAP_SHIFT; directions; directions &= directions - 1){
+        int direction = __builtin_ctz(directions);
+        std::uint8_t& neighbor_mask = m_masks[cell + Animal::DIRECTION_OFFSETS[direction][0] + (Animal::DIRECTION_OFFSETS[direction][1] * m_width)];
+        if (occupied)
+            neighbor_mask &= ~(1 << (direction ^ 1));
+        else
+            neighbor_mask |= 1 << (direction ^ 1);
+    }
+}
+
+std::uint8_t FreeMaskGrid::getEmptyMask(int x_coord, int y_coord, const std::tuple<int, int>& map_dimensions){
+    // Bit order matches Animal::DIRECTION_OFFSETS: left, right, up, down
+    int in_map = (x_coord > 0) | ((x_coord < std::get<0>(map_dimensions) - 1) << 1) | ((y_coord > 0) << 2) | ((y_coord < std::get<1>(map_dimensions) - 1) << 3);
+    return (in_map << IN_MAP_SHIFT) | in_map;
+}
+
+// Setters & Getters:
+
+int FreeMaskGrid::getFreeDirections(const std::tuple<int, int>& coords) const{
+    return m_masks[(std::get<1>(coords) * m_width) + std::get<0>(coords)] & FREE_DIRECTIONS;
+}
+
+int FreeMaskGrid::getOccupiedDirections(const std::tuple<int, int>& coords) const{
+    int mask = m_masks[(std::get<1>(coords) * m_width) + std::get<0>(coords)];
+    return (mask >> IN_MAP_SHIFT) & ~mask;
+}
+
+bool FreeMaskGrid::isInSyncWith(const OrganismPool& organisms, const std::tuple<int, int>& map_dimensions) const{
+    return &organisms == m_pool && map_dimensions == std::tuple<int, int>{m_width, m_height} && organisms.getChangeCount() == m_pool_changes
+        && organisms.getWorldHash() == m_world_hash;
+}
+
+// Methods:
+
+void FreeMaskGrid::rebuild(const std::vector<Organism*>& organisms, const std::tuple<int, int>& map_dimensions){
+    m_width = std::get<0>(map_dimensions);
+    m_height = std::get<1>(map_dimensions);
+    m_masks.resize(static_cast<std::size_t>(m_width) * m_height);
+    m_living.assign(m_masks.size(), 0);
+    for (int y = 0; y < m_height; y++){
+        for (int x = 0; x < m_width; x++)
+            m_masks[(y * m_width) + x] = getEmptyMask(x, y, map_dimensions);
+    }
+    m_pool = nullptr;
+
+    for (const Organism* org : organisms){
+        if (org->isAlive())
+            addLiving(org->getCoords());
+    }
+}
+
+void FreeMaskGrid::markInSync(const OrganismPool& organisms){
+    m_pool = &organisms;
+    m_pool_changes = organisms.getChangeCount();
+    m_world_hash = organisms.getWorldHash();
+}
+
+void FreeMaskGrid::addLiving(const std::tuple<int, int>& coords){
+    int x_coord = std::get<0>(coords), y_coord = std::get<1>(coords);
+    if (m_living[(y_coord * m_width) + x_coord]++ == 0)
+        setOccupied(x_coord, y_coord, true);
+}
+
+void FreeMaskGrid::removeLiving(const std::tuple<int, int>& coords){
+    int x_coord = std::get<0>(coords), y_coord = std::get<1>(coords);
+    if (--m_living[(y_coord * m_width) + x_coord] == 0)
+        setOccupied(x_coord, y_coord, false);
+}
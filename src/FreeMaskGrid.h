@@ -0,0 +1,90 @@
+#ifndef FREEMASKGRID_H
+#define FREEMASKGRID_H
+
+#include "Organism.h"
+
+#include <vector>
+#include <tuple>
+#include <cstdint>
+
+class OrganismPool;
+
+/*
+Per-cell masks of which cells next to each cell are free (in the map and without a living organism), kept across iterations
+- Every cell is one byte: the low 4 bits are its free directions and the high 4 bits are its directions that are in the map at all (bit d is
+  Animal::DIRECTION_OFFSETS[d] in both). The in-map bits are worked out once when the grid is built, so nothing checks the map bounds again
+- Every cell also counts its living organisms. The masks of the 4 cells next to a cell only change when its count goes between 0 and 1,
+  so a move, death or revival costs a few byte writes instead of a look at the neighbors
+- Engines keep one across iterations and only rebuild it when something outside of them changed the world (see isInSyncWith())
+- Every cell is its own memory location, so threads can update the grid at the same time as long as the organisms they update are more
+  than 4 rows apart (see ParallelEngine::STRIP_HEIGHT)
+*/
+class FreeMaskGrid {
+    public:
+    static constexpr int FREE_DIRECTIONS = 0x0F; // Bits of a mask that are free directions
+    static constexpr int IN_MAP_SHIFT = 4; // In-map directions are mask >> IN_MAP_SHIFT
+
+    private:
+    std::vector<std::uint8_t> m_masks; // m_masks[(y * width) + x]
+    std::vector<std::uint16_t> m_living; // Living organisms in each cell. There's normally at most 1, but the API can put more in one cell
+    int m_width{0};
+    int m_height{0};
+
+    // State of the world the grid was last known to match (see markInSync())
+    const OrganismPool* m_pool{nullptr};
+    std::uint64_t m_pool_changes{0};
+    std::uint64_t m_world_hash{0};
+
+    // Private methods:
+    void setOccupied(int x_coord, int y_coord, bool occupied); // Update the masks of the cells next to (x, y)
+
+    public:
+    /*
+    - Mask of a cell at (x, y) with nothing next to it: every direction that's in the map is both free and in the map
+    - Only for building masks. Code that has a mask already reads its in-map bits instead
+    */
+    static std::uint8_t getEmptyMask(int x_coord, int y_coord, const std::tuple<int, int>& map_dimensions);
+
+    // Setters & Getters:
+
+    /*
+    - Directions from coords that are in the map and don't have a living organism in them
+    */
+    int getFreeDirections(const std::tuple<int, int>& coords) const;
+
+    /*
+    - Directions from coords that are in the map and have a living organism in them
+    */
+    int getOccupiedDirections(const std::tuple<int, int>& coords) const;
+
+    /*
+    - Whether the grid still matches organisms: it was built for this pool and these map dimensions, and neither the pool's change count nor
+      its world hash changed since markInSync(). Anything else that changed an organism changed the world hash too
+    */
+    bool isInSyncWith(const OrganismPool& organisms, const std::tuple<int, int>& map_dimensions) const;
+
+    // Methods:
+
+    /*
+    - Build the grid from scratch for the living organisms in organisms
+    */
+    void rebuild(const std::vector<Organism*>& organisms, const std::tuple<int, int>& map_dimensions);
+
+    /*
+    - Remember organisms' current state as matching the grid. Engines call this once they're done changing organisms (after cleaning up,
+      which only erases organisms that aren't alive, so the grid doesn't change)
+    */
+    void markInSync(const OrganismPool& organisms);
+
+    /*
+    - An organism came to life at coords, or a living organism moved there
+    */
+    void addLiving(const std::tuple<int, int>& coords);
+
+    /*
+    - A living organism at coords died or moved away
+    */
+    void removeLiving(const std::tuple<int, int>& coords);
+};
+
+#endif
@@ -0,0 +1,155 @@
+#include "GridEngine.h"
+
+GridEngine::GridEngine(bool reorder) : m_reorder(reorder) {}
+
+std::string GridEngine::getName() const{
+    return m_reorder ? "grid:morton" : "grid";
+}
+
+bool GridEngine::supportsVision() const{
+    return true;
+}
+
+GridEngine::Cell& GridEngine::getCell(const std::tuple<int, int>& coords){
+    return m_cells[(std::get<1>(coords) * std::get<0>(m_map_dimensions)) + std::get<0>(coords)];
+}
+
+void GridEngine::rebuild(const OrganismPool& organisms, const std::tuple<int, int>& map_dimensions){
+    m_map_dimensions = map_dimensions;
+    m_cells.assign(std::get<0>(map_dimensions) * std::get<1>(map_dimensions), {});
+    m_dead_animals.clear();
+    for (Organism* org : organisms.getOrganisms()){
+        Cell& cell = getCell(org->getCoords());
+        if (org->isAlive())
+            cell.live_org = org;
+        if (org->getType() != Organism::PlantEnum){
+            cell.animals++;
+            if (!org->isAlive())
+                m_dead_animals.push_back(static_cast<Animal*>(org));
+        }
+    }
+    m_free_masks.rebuild(organisms.getOrganisms(), map_dimensions);
+}
+
+void GridEngine::clearLiveOrg(const std::tuple<int, int>& coords, const Organism* org){
+    Cell& cell = getCell(coords);
+    if (cell.live_org == org)
+        cell.live_org = nullptr;
+}
+
+void GridEngine::update(OrganismPool& organisms, const std::tuple<int, int>& map_dimensions, long long iteration){
+    if (!m_free_masks.isInSyncWith(organisms, map_dimensions))
+        rebuild(organisms, map_dimensions);
+    m_spatial_index_built = false;
+
+    // Update organisms in the same order as the reference engine (charged to one hardware counter phase the same way too)
+    const std::vector<Organism*>& orgs = organisms.getOrganisms();
+    {
+        PerfCounters::Scope phase_scope(PerfCounters::OrganismUpdate, orgs.size());
+        for (Organism* org : orgs){
+            if (org->getType() == Organism::PlantEnum)
+                updatePlant(static_cast<Plant*>(org), organisms.getWorldHashState());
+            else{
+                Animal* animal = static_cast<Animal*>(org);
+                if (animal->getVisionRadius() > 0 && !m_spatial_index_built){
+                    m_spatial_index.build(orgs, map_dimensions);
+                    m_spatial_index_built = true;
+                }
+                updateAnimal(animal, organisms, organisms.getWorldHashState());
+            }
+        }
+    }
+
+    // Dead animals are about to be cleaned up, so they stop blocking plants
+    for (Animal* animal : m_dead_animals)
+        getCell(animal->getCoords()).animals--;
+    m_dead_animals.clear();
+
+    Ecosystem::cleanUpEcosystem(organisms, iteration, m_reorder);
+    m_free_masks.markInSync(organisms);
+}
+
+void GridEngine::updatePlant(Plant* plant, Organism::WorldHash& world_hash){
+    // Same as Plant::update(), but the occupied check is a grid lookup instead of a search through every organism
+    if (plant->isAlive())
+        return;
+
+    if (plant->getCurrentHealth() < plant->getMaxHealth())
+        plant->addHealth(1, world_hash);
+
+    if (plant->getCurrentHealth() >= plant->getMaxHealth()){
+        Cell& cell = getCell(plant->getCoords());
+        Metrics::Counters& metrics = Metrics::local();
+        metrics.plant_revive_scans++;
+        metrics.plant_revive_candidates++; // Just this plant's own cell
+        if (cell.animals == 0){ // Plants never share a cell, so only animals can be standing on this plant
+            plant->revive(world_hash);
+            cell.live_org = plant;
+            m_free_masks.addLiving(plant->getCoords());
+        }
+    }
+}
+
+void GridEngine::updateAnimal(Animal* animal, const OrganismPool& organisms, Organism::WorldHash& world_hash){
+    // Same as Animal::update(), but only this cell and the neighbors its mask says are occupied are checked
+    std::tuple<int, int> old_coords = animal->getCoords();
+    int x_coord = std::get<0>(old_coords), y_coord = std::get<1>(old_coords);
+    bool was_alive = animal->isAlive();
+
+    // The reference engine eats the first edible neighbor in pool order, so pick the edible neighbor that comes first in the pool
+    Organism* food = nullptr;
+    int food_index = 0;
+    int candidates = 0;
+    auto checkCell = [&](const Cell& cell) {
+        candidates++;
+        if (!animal->isPredatorTo(cell.live_org) || !animal->hungryEnoughToEat(cell.live_org))
+            return;
+        int index = organisms.getIndex(cell.live_org);
+        if (!food || index < food_index){
+            food = cell.live_org;
+            food_index = index;
+        }
+    };
+
+    Cell& own_cell = getCell(old_coords);
+    if (own_cell.live_org && own_cell.live_org != animal)
+        checkCell(own_cell);
+    for (int directions = m_free_masks.getOccupiedDirections(old_coords); directions; directions &= directions - 1){
+        int direction = __builtin_ctz(directions);
+        const Cell& neighbor = getCell({x_coord + Animal::DIRECTION_OFFSETS[direction][0], y_coord + Animal::DIRECTION_OFFSETS[direction][1]});
+        if (neighbor.live_org)
+            checkCell(neighbor);
+    }
+
+    Metrics::Counters& metrics = Metrics::local();
+    metrics.animal_updates++;
+    metrics.neighbor_candidates += candidates;
+
+    if (food){
+        animal->addHealth(-1, world_hash); // Animal needs to expend 1 energy point to reach organism to eat
+        animal->eat(food, world_hash);
+
+        // Food is dead now
+        clearLiveOrg(food->getCoords(), food);
+        m_free_masks.removeLiving(food->getCoords());
+        if (food->getType() != Organism::PlantEnum)
+            m_dead_animals.push_back(static_cast<Animal*>(food));
+    }
+    else{
+        animal->moveRandomly(world_hash, m_free_masks.getFreeDirections(old_coords), animal->getPreferredDirections(m_spatial_index_built ? &m_spatial_index : nullptr));
+    }
+
+    // Move animal in the grid (it might not have moved, and might have died)
+    clearLiveOrg(old_coords, animal);
+    getCell(old_coords).animals--;
+    getCell(animal->getCoords()).animals++;
+    if (was_alive)
+        m_free_masks.removeLiving(old_coords);
+    if (animal->isAlive()){
+        getCell(animal->getCoords()).live_org = animal;
+        m_free_masks.addLiving(animal->getCoords());
+    }
+    else if (was_alive){
+        m_dead_animals.push_back(animal);
+    }
+}
@@ -0,0 +1,48 @@
+#ifndef GRIDENGINE_H
+#define GRIDENGINE_H
+
+#include "Engine.h"
+
+/*
+Serial engine that gives exactly the same results as the reference engine (Ecosystem::updateEcosystem()), but faster
+- Instead of every organism looking through every other organism, organisms look up their own cell and the 4 cells next to it in a grid
+- Organisms are still updated in pool order and animals still pick the first edible neighbor in pool order, so every random number is
+  drawn in the same order as the reference engine
+- The grid is kept across iterations and updated as organisms move, eat, die and revive. Animals that died are taken out of it when
+  they're cleaned up. It's only rebuilt when something other than this engine changed the pool (see FreeMaskGrid::isInSyncWith())
+- Which cells next to each cell are free is kept in a FreeMaskGrid. An animal only looks at the neighbors its mask says are occupied,
+  and picks its move straight from it
+- Edible neighbors are compared by their place in the pool (OrganismPool::getIndex()), which doesn't change during an iteration
+- With reorder ("grid:morton"), organisms are re-sorted by Morton order like "reference:morton" (see Ecosystem::updateEcosystem())
+*/
+class GridEngine : public Engine {
+    struct Cell {
+        Organism* live_org{nullptr}; // Living organism in this cell, if any (there's never more than one)
+        int animals{}; // Animals in this cell, including ones that died this iteration (they still block plants from reviving)
+    };
+
+    std::vector<Cell> m_cells; // m_cells[(y * width) + x]
+    std::tuple<int, int> m_map_dimensions{0, 0};
+    FreeMaskGrid m_free_masks;
+    std::vector<Animal*> m_dead_animals; // Animals that died this iteration, which still count in m_cells until they're cleaned up
+    SpatialIndex m_spatial_index; // Only built if some animal has a vision radius
+    bool m_spatial_index_built{false};
+    bool m_reorder;
+
+    // Private methods:
+    Cell& getCell(const std::tuple<int, int>& coords);
+    void rebuild(const OrganismPool& organisms, const std::tuple<int, int>& map_dimensions); // Put every organism in the grid from scratch
+    void clearLiveOrg(const std::tuple<int, int>& coords, const Organism* org); // Take org out of its cell if it's the living organism there
+    void updatePlant(Plant* plant, Organism::WorldHash& world_hash);
+    void updateAnimal(Animal* animal, const OrganismPool& organisms, Organism::WorldHash& world_hash);
+
+    public:
+    explicit GridEngine(bool reorder = false);
+
+    std::string getName() const override;
+    bool supportsVision() const override;
+
+    void update(OrganismPool& organisms, const std::tuple<int, int>& map_dimensions, long long iteration) override;
+};
+
+#endif
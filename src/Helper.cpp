@@ -97,7 +97,29 @@ int Helper::getPositiveInteger(const std::string& prompt){
     return user_int;
 }
 
+std::mt19937& Helper::getRandomEngine(){
+    // Seeding is done once per thread, so drawing random numbers never needs std::random_device after that
+    thread_local std::mt19937 engine{std::random_device{}()};
+    return engine;
+}
+
+void Helper::setRandomSeed(unsigned int seed){
+    getRandomEngine().seed(seed);
+}
+
+static thread_local bool quit_throws = false;
+
+void Helper::setQuitThrows(bool throws){
+    quit_throws = throws;
+}
+
+bool Helper::getQuitThrows(){
+    return quit_throws;
+}
+
 void Helper::quit(int error_code){
+    if (quit_throws)
+        throw QuitError(error_code);
     if (error_code == 0)
         std::cout << "Thank you for using this program!\n";
     exit(error_code);
@@ -8,12 +8,22 @@
 #include <cctype>
 #include <algorithm>
 #include <filesystem>
+#include <random>
+#include <stdexcept>
 
 /*
 Helper class with various useful methods that can be used anywhere
 */
 class Helper {
 public:
+    /*
+    Thrown by quit() instead of quitting on threads that called setQuitThrows(true)
+    */
+    struct QuitError : public std::runtime_error {
+        int error_code;
+        explicit QuitError(int code) : std::runtime_error("quit with error code " + std::to_string(code)), error_code(code) {}
+    };
+
     /*
     Move cursor to specified x/y location on terminal
     */
@@ -53,7 +63,26 @@ public:
     static int getPositiveInteger(const std::string& prompt);
 
     /*
-    Quit the program.
+    Get the random engine used by the simulation.
+    Every thread has its own engine. Engines are seeded from std::random_device unless setRandomSeed() is called.
+    */
+    static std::mt19937& getRandomEngine();
+
+    /*
+    Re-seed this thread's random engine so runs can be reproduced
+    */
+    static void setRandomSeed(unsigned int seed);
+
+    /*
+    Make quit() throw a QuitError on this thread instead of ending the program
+    This is for threads that run many independent jobs (see JobService), where one bad input file shouldn't stop the others
+    */
+    static void setQuitThrows(bool quit_throws);
+
+    static bool getQuitThrows();
+
+    /*
+    Quit the program (or throw a QuitError, see setQuitThrows()).
     Error codes:
     0 - successful termination (nothing went wrong)
     1 - Bad file path given for map
@@ -63,8 +92,12 @@ public:
     5 - Invalid species given in map
     6 - Inavlid arguments given in species list
     7 - Health not given as integer
-    8 - Error with command line arguments
+    8 - Error with command line arguments (or with the arguments given to libecosystem, see Simulation)
     9 - Tried to move an animal in a way that is not allowed
+    10 - Couldn't set up metrics output
+    11 - Couldn't start or talk to a worker or branch process
+    12 - Couldn't set up or run the job service
+    13 - Couldn't create or map a tile store's backing file
     */
     static void quit(int error_code);
 };
@@ -0,0 +1,329 @@
+#include "JobService.h"
+
+#include <iomanip>
+#include <cerrno>
+#include <csignal>
+#include <unistd.h>
+
+std::atomic<bool> JobService::m_stop_requested{false};
+
+static const std::string JOB_EXTENSION = ".job";
+static const std::string RUNNING_EXTENSION = ".job.running."; // Followed by <host>.<pid> of the service that claimed the job
+
+JobService::JobService(const std::filesystem::path& spool_directory, int thread_count, bool exit_when_idle)
+    : m_spool_directory(spool_directory), m_exit_when_idle(exit_when_idle), m_thread_pool(thread_count) {
+    std::error_code error;
+    if (!std::filesystem::is_directory(spool_directory, error)){
+        std::cerr << "Error: spool directory " << spool_directory << " doesn't exist\n";
+        Helper::quit(12);
+    }
+}
+
+void JobService::requestStop(){
+    m_stop_requested.store(true);
+}
+
+long long JobService::getJobsDone() const{
+    return m_jobs_done.load();
+}
+
+long long JobService::getJobsFailed() const{
+    return m_jobs_failed.load();
+}
+
+void JobService::run(){
+    recoverJobs();
+    {
+        std::lock_guard<std::mutex> lock(m_output_mutex);
+        std::cout << "Watching " << m_spool_directory.string() << " for *" << JOB_EXTENSION << " files with " << m_thread_pool.getThreadCount() << " worker(s)\n" << std::flush;
+    }
+
+    m_thread_pool.run(m_thread_pool.getThreadCount(), [this](int) { workerLoop(); });
+
+    std::cout << "Job service stopped: " << getJobsDone() << " job(s) done, " << getJobsFailed() << " failed, "
+        << m_scenario_cache.getHits() << " scenario cache hit(s), " << m_scenario_cache.getMisses() << " miss(es)\n";
+}
+
+std::string JobService::getHostName(){
+    char host_name[256]{};
+    if (::gethostname(host_name, sizeof(host_name) - 1) != 0)
+        return "localhost";
+    return host_name;
+}
+
+void JobService::recoverJobs(){
+    std::string host_name = getHostName();
+    std::error_code error;
+    for (const auto& entry : std::filesystem::directory_iterator(m_spool_directory, error)){
+        // <name>.job.running.<host>.<pid>
+        std::string name = entry.path().filename().string();
+        std::size_t extension_start = name.rfind(RUNNING_EXTENSION);
+        if (extension_start == std::string::npos || extension_start == 0)
+            continue;
+        std::string owner = name.substr(extension_start + RUNNING_EXTENSION.size());
+        std::size_t pid_start = owner.rfind('.');
+        if (pid_start == std::string::npos || owner.substr(0, pid_start) != host_name)
+            continue;
+        pid_t pid = std::atoi(owner.c_str() + pid_start + 1);
+        if (pid <= 0)
+            continue;
+
+        // kill() with signal 0 only checks whether the process exists (EPERM means it does, it just belongs to someone else)
+        if (pid != ::getpid() && (::kill(pid, 0) == 0 || errno != ESRCH))
+            continue;
+
+        std::filesystem::path job_file = entry.path().parent_path() / (name.substr(0, extension_start) + JOB_EXTENSION);
+        std::filesystem::rename(entry.path(), job_file, error);
+    }
+}
+
+bool JobService::claimJob(std::filesystem::path& job_file, std::filesystem::path& running_file){
+    std::lock_guard<std::mutex> lock(m_claim_mutex);
+
+    // Oldest name first, so jobs named by time or sequence number run in order
+    std::vector<std::filesystem::path> jobs;
+    std::error_code error;
+    for (const auto& entry : std::filesystem::directory_iterator(m_spool_directory, error)){
+        if (entry.path().extension() == JOB_EXTENSION)
+            jobs.push_back(entry.path());
+    }
+    std::sort(jobs.begin(), jobs.end());
+
+    std::string claim_tag = RUNNING_EXTENSION.substr(JOB_EXTENSION.size()) + getHostName() + "." + std::to_string(::getpid()); // .running.<host>.<pid>
+    for (const std::filesystem::path& job : jobs){
+        job_file = job;
+        running_file = job;
+        running_file += claim_tag;
+        std::filesystem::rename(job, running_file, error);
+        if (!error) // Another service may have taken it first
+            return true;
+    }
+    return false;
+}
+
+void JobService::workerLoop(){
+    // Everything a job needs stays around for the next one
+    Helper::setQuitThrows(true);
+    OrganismArena::enable();
+    OrganismPool organisms;
+
+    while (!m_stop_requested.load()){
+        std::filesystem::path job_file, running_file;
+        if (claimJob(job_file, running_file)){
+            runJob(job_file, running_file, organisms);
+            continue;
+        }
+        if (m_exit_when_idle)
+            break;
+        Helper::sleep(POLL_INTERVAL);
+    }
+
+    organisms.clear();
+    OrganismArena::disable();
+    Helper::setQuitThrows(false);
+}
+
+JobService::JobSpec JobService::readJobSpec(const std::filesystem::path& job_file, const std::string& job_name) const{
+    JobSpec spec;
+    spec.result_file = m_spool_directory / (job_name + ".result");
+
+    std::istringstream job_text(readFile(job_file, 12));
+    std::string line;
+    while (std::getline(job_text, line)){
+        if (!line.empty() && line.back() == '\r') // Ignore Windows line endings
+            line.pop_back();
+
+        std::size_t first = line.find_first_not_of(" \t");
+        if (first == std::string::npos || line[first] == '#')
+            continue;
+
+        std::size_t equals = line.find('=');
+        if (equals == std::string::npos){
+            std::cerr << "Error: job " << job_name << " has a line without '=': " << line << '\n';
+            Helper::quit(12);
+        }
+
+        auto trim = [](std::string text) {
+            text.erase(0, text.find_first_not_of(" \t"));
+            text.erase(text.find_last_not_of(" \t") + 1);
+            return text;
+        };
+        std::string key = trim(line.substr(0, equals)), value = trim(line.substr(equals + 1));
+        std::filesystem::path path = m_spool_directory / value; // Absolute values replace the spool directory
+
+        try {
+            if (key == "map")
+                spec.map_file = path;
+            else if (key == "species")
+                spec.species_file = path;
+            else if (key == "iterations" || key == "ticks")
+                spec.iterations = std::stoll(value);
+            else if (key == "seed")
+                spec.seed = std::stoul(value);
+            else if (key == "engine")
+                spec.engine = value;
+            else if (key == "result")
+                spec.result_file = path;
+            else if (key == "final_map")
+                spec.final_map_file = path;
+            else {
+                std::cerr << "Error: job " << job_name << " has an unknown key " << key << '\n';
+                Helper::quit(12);
+            }
+        } catch (const std::logic_error&) {
+            std::cerr << "Error: job " << job_name << " has an invalid value for " << key << ": " << value << '\n';
+            Helper::quit(12);
+        }
+    }
+
+    if (spec.map_file.empty() || spec.species_file.empty() || spec.iterations < 0){
+        std::cerr << "Error: job " << job_name << " needs a map, a species list and a number of iterations that isn't negative\n";
+        Helper::quit(12);
+    }
+    // Every job makes its engine on its own job thread while other jobs are running, and forking a process with other threads running isn't safe
+    if (spec.engine.compare(0, 10, "processes:") == 0){
+        std::cerr << "Error: job " << job_name << " can't use " << spec.engine << ", since its workers would be forked while other jobs are running\n";
+        Helper::quit(12);
+    }
+    return spec;
+}
+
+std::string JobService::readFile(const std::filesystem::path& file_path, int error_code){
+    std::ifstream file(file_path, std::ios::binary);
+    if (!file.is_open()){
+        std::cerr << "Error: Couldn't open " << file_path << " for reading\n";
+        Helper::quit(error_code);
+    }
+    std::ostringstream contents;
+    contents << file.rdbuf();
+    return contents.str();
+}
+
+void JobService::writeFile(const std::filesystem::path& file_path, const std::string& contents){
+    // Write to a temporary file and rename it, so nobody watching for the file ever sees half of it
+    std::filesystem::path temporary_path = file_path;
+    temporary_path += ".tmp";
+    {
+        std::ofstream file(temporary_path, std::ios::binary | std::ios::trunc);
+        file << contents;
+        if (!file){
+            std::cerr << "Error: Couldn't write " << file_path << '\n';
+            Helper::quit(12);
+        }
+    }
+    std::error_code error;
+    std::filesystem::rename(temporary_path, file_path, error);
+    if (error){
+        std::cerr << "Error: Couldn't write " << file_path << '\n';
+        Helper::quit(12);
+    }
+}
+
+std::string JobService::getFinalMap(const OrganismPool& organisms, const std::tuple<int, int>& map_dimensions){
+    int width = std::get<0>(map_dimensions), height = std::get<1>(map_dimensions);
+    std::vector<std::string> rows(height, std::string(width, ' '));
+    for (const Organism* org : organisms.getOrganisms()){
+        if (org->isAlive())
+            rows[std::get<1>(org->getCoords())][std::get<0>(org->getCoords())] = org->getLetterID();
+    }
+
+    const PlantLayer& plant_layer = organisms.getPlantLayer();
+    for (int cell = 0; cell < plant_layer.getWidth() * plant_layer.getHeight(); cell++){
+        std::tuple<int, int> coords = plant_layer.getCoords(cell);
+        char& letter = rows[std::get<1>(coords)][std::get<0>(coords)];
+        if (letter == ' ' && plant_layer.hasPlant(cell) && plant_layer.isAlive(cell))
+            letter = plant_layer.getSpecies(cell).letter_id;
+    }
+
+    std::string map;
+    for (const std::string& row : rows)
+        map += row + '\n';
+    return map;
+}
+
+void JobService::runJob(const std::filesystem::path& job_file, const std::filesystem::path& running_file, OrganismPool& organisms){
+    std::string job_name = job_file.stem().string();
+    auto start = std::chrono::steady_clock::now();
+
+    JobSpec spec;
+    std::ostringstream result;
+    std::string log_line;
+    bool succeeded = false;
+    try {
+        spec = readJobSpec(running_file, job_name);
+        std::string map_text = readFile(spec.map_file, 1);
+        std::string species_text = readFile(spec.species_file, 3);
+
+        bool cache_hit = false;
+        std::shared_ptr<const Ecosystem::Scenario> scenario = m_scenario_cache.get(map_text, species_text, cache_hit);
+        std::unique_ptr<Engine> engine = Engine::create(spec.engine, spec.seed);
+        if (!engine){
+            std::cerr << "Error: job " << job_name << " uses unknown engine " << spec.engine << '\n';
+            Helper::quit(8);
+        }
+
+        // Organism colors are random too, so seed before making organisms (same as the harness)
+        organisms.clear();
+        Helper::setRandomSeed(spec.seed);
+        long long reused_before = OrganismArena::getReusedCount();
+        Ecosystem::createOrganisms(*scenario, organisms);
+        long long reused_organisms = OrganismArena::getReusedCount() - reused_before;
+        auto loaded = std::chrono::steady_clock::now();
+
+        if (spec.iterations > 0)
+            engine->run(organisms, scenario->map_dimensions, 1, spec.iterations);
+        auto finished = std::chrono::steady_clock::now();
+
+        int plants = std::count_if(organisms.getOrganisms().begin(), organisms.getOrganisms().end(), [](const Organism* org) { return org->getType() == Organism::PlantEnum; });
+        plants += organisms.getPlantLayer().getPlantCount();
+        int animals = organisms.size() + organisms.getPlantLayer().getPlantCount() - plants;
+        double load_ms = std::chrono::duration<double, std::milli>(loaded - start).count();
+        double run_ms = std::chrono::duration<double, std::milli>(finished - loaded).count();
+
+        if (!spec.final_map_file.empty())
+            writeFile(spec.final_map_file, getFinalMap(organisms, scenario->map_dimensions));
+
+        result << "status=ok\n"
+            << "engine=" << engine->getName() << '\n'
+            << "iterations=" << spec.iterations << '\n'
+            << "seed=" << spec.seed << '\n'
+            << "world_hash=" << std::hex << std::setw(16) << std::setfill('0') << organisms.getWorldHash() << std::dec << std::setfill(' ') << '\n'
+            << "plants=" << plants << '\n'
+            << "animals=" << animals << '\n'
+            << "scenario_cache=" << (cache_hit ? "hit" : "miss") << '\n'
+            << "reused_organisms=" << reused_organisms << '\n'
+            << std::fixed << std::setprecision(3)
+            << "load_ms=" << load_ms << '\n'
+            << "run_ms=" << run_ms << '\n';
+        log_line = "ok (" + std::to_string(spec.iterations) + " iterations, scenario cache " + (cache_hit ? "hit" : "miss") + ")";
+        succeeded = true;
+    } catch (const Helper::QuitError& error) {
+        result << "status=failed\nerror_code=" << error.error_code << '\n';
+        log_line = "failed with error code " + std::to_string(error.error_code);
+    } catch (const std::exception& error) {
+        result << "status=failed\nerror=" << error.what() << '\n';
+        log_line = std::string("failed: ") + error.what();
+    }
+    organisms.clear();
+
+    double total_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    result << std::fixed << std::setprecision(3) << "total_ms=" << total_ms << '\n';
+
+    // The result file has to be written even if the job failed, so the one from the spec is only used if it was read
+    std::filesystem::path result_file = spec.result_file.empty() ? m_spool_directory / (job_name + ".result") : spec.result_file;
+    try {
+        writeFile(result_file, result.str());
+    } catch (const Helper::QuitError&) {
+        succeeded = false;
+        log_line += ", and couldn't write its result";
+    }
+
+    std::filesystem::path finished_file = job_file;
+    finished_file += succeeded ? ".done" : ".failed";
+    std::error_code error;
+    std::filesystem::rename(running_file, finished_file, error);
+
+    (succeeded ? m_jobs_done : m_jobs_failed)++;
+    std::lock_guard<std::mutex> lock(m_output_mutex);
+    std::cout << "Job " << job_name << ": " << log_line << " in " << std::fixed << std::setprecision(3) << total_ms << " ms\n" << std::flush;
+}
@@ -0,0 +1,91 @@
+#ifndef JOBSERVICE_H
+#define JOBSERVICE_H
+
+#include "Engine.h"
+#include "ThreadPool.h"
+#include "ScenarioCache.h"
+
+#include <atomic>
+#include <mutex>
+
+/*
+Long-running service that runs batch jobs from a spool directory, so lots of small runs don't each pay for starting a new process
+- A job is a text file called <name>.job in the spool directory (see JobSpec for what goes in it)
+- A worker claims a job by renaming it to <name>.job.running.<host>.<pid> (renaming is atomic, so a job is only ever claimed once, even by
+  several services sharing a spool directory). When it's done, the job is renamed to <name>.job.done or <name>.job.failed and a result file is written
+- When a service starts, it only puts back jobs that a service on the same host claimed and that aren't running anymore: ones claimed with its
+  own pid (a service that died before it and had the same pid), or with a pid that no longer exists. Jobs other services are running are left
+  alone. Jobs claimed on another host, or by a service from before claims were tagged (<name>.job.running), have to be renamed back by hand
+- Workers are threads in a ThreadPool that stay up between jobs. Each one keeps its OrganismPool and recycles organism memory (OrganismArena),
+  and parsed scenarios are shared through a ScenarioCache, so a repeated scenario starts without reading or parsing anything
+- A bad job only fails that job: errors that would quit the program throw on worker threads instead (Helper::setQuitThrows())
+*/
+class JobService {
+    public:
+    static constexpr int POLL_INTERVAL = 100; // How often idle workers look for new jobs (ms)
+
+    /*
+    What a job file can contain, one "key = value" per line (blank lines and lines starting with # are skipped):
+        map = <path>          - Map file (required)
+        species = <path>      - Species list (required)
+        iterations = <n>      - Iterations to run (default 100). "ticks" works too
+        seed = <n>            - Random seed (default 1)
+        engine = <name>       - Engine to use (default "reference", see Engine::create()). Multi-process engines aren't allowed
+        result = <path>       - Where to write the result (default <spool directory>/<name>.result)
+        final_map = <path>    - Also write the final map here, in the same format as map files
+    - Relative paths are relative to the spool directory
+    */
+    struct JobSpec {
+        std::filesystem::path map_file;
+        std::filesystem::path species_file;
+        long long iterations{100};
+        unsigned int seed{1};
+        std::string engine{"reference"};
+        std::filesystem::path result_file;
+        std::filesystem::path final_map_file;
+    };
+
+    private:
+    std::filesystem::path m_spool_directory;
+    bool m_exit_when_idle{false};
+    ThreadPool m_thread_pool;
+    ScenarioCache m_scenario_cache;
+    std::mutex m_claim_mutex; // Workers in this process look for jobs one at a time
+    std::mutex m_output_mutex; // Keeps log lines from different workers apart
+    std::atomic<long long> m_jobs_done{0};
+    std::atomic<long long> m_jobs_failed{0};
+    static std::atomic<bool> m_stop_requested;
+
+    // Private methods:
+    void recoverJobs(); // Put jobs that were running when a previous service on this host died back in the queue
+    bool claimJob(std::filesystem::path& job_file, std::filesystem::path& running_file);
+    void workerLoop();
+    void runJob(const std::filesystem::path& job_file, const std::filesystem::path& running_file, OrganismPool& organisms);
+    static std::string getHostName();
+    JobSpec readJobSpec(const std::filesystem::path& job_file, const std::string& job_name) const;
+    static std::string readFile(const std::filesystem::path& file_path, int error_code);
+    static void writeFile(const std::filesystem::path& file_path, const std::string& contents);
+    static std::string getFinalMap(const OrganismPool& organisms, const std::tuple<int, int>& map_dimensions);
+
+    public:
+    /*
+    - spool_directory is where jobs are picked up from. thread_count workers run jobs at the same time
+    - If exit_when_idle is true, run() returns once there are no jobs left instead of waiting for more
+    */
+    JobService(const std::filesystem::path& spool_directory, int thread_count, bool exit_when_idle);
+
+    /*
+    - Run jobs until requestStop() is called (or until there are none left, see the constructor). Jobs that are running finish first
+    */
+    void run();
+
+    /*
+    - Ask every running service to stop. Only sets a flag, so it's safe to call from a signal handler
+    */
+    static void requestStop();
+
+    long long getJobsDone() const;
+    long long getJobsFailed() const;
+};
+
+#endif
@@ -0,0 +1,89 @@
+#include "Kernels.h"
+#include "PlantLayer.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define KERNELS_HAVE_AVX2 1
+#else
+#define KERNELS_HAVE_AVX2 0
+#endif
+
+Kernels::Implementation Kernels::getBestImplementation(){
+#if KERNELS_HAVE_AVX2
+    static const Implementation best = __builtin_cpu_supports("avx2") ? AVX2Implementation : ScalarImplementation;
+    return best;
+#else
+    return ScalarImplementation;
+#endif
+}
+
+const char* Kernels::getName(Implementation implementation){
+    return implementation == AVX2Implementation ? "avx2" : "scalar";
+}
+
+// Scalar:
+
+static void regrowPlantsScalar(std::uint32_t* cells, int begin, int end, std::vector<int>& counted_down, std::vector<int>& ready){
+    for (int i = begin; i < end; i++){
+        std::uint32_t value = cells[i];
+        if (!(value & PlantLayer::SPECIES_MASK) || (value & PlantLayer::ALIVE_BIT))
+            continue;
+
+        if (value >> PlantLayer::COUNTDOWN_SHIFT){
+            value -= 1u << PlantLayer::COUNTDOWN_SHIFT;
+            cells[i] = value;
+            counted_down.push_back(i);
+        }
+        if (!(value >> PlantLayer::COUNTDOWN_SHIFT))
+            ready.push_back(i);
+    }
+}
+
+// AVX2:
+
+#if KERNELS_HAVE_AVX2
+__attribute__((target("avx2")))
+static void regrowPlantsAVX2(std::uint32_t* cells, int count, std::vector<int>& counted_down, std::vector<int>& ready){
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i species_mask = _mm256_set1_epi32(PlantLayer::SPECIES_MASK);
+    const __m256i alive_bit = _mm256_set1_epi32(PlantLayer::ALIVE_BIT);
+    const __m256i step = _mm256_set1_epi32(1u << PlantLayer::COUNTDOWN_SHIFT);
+    int i = 0;
+    for (; i + 8 <= count; i += 8){
+        __m256i value = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(cells + i));
+        __m256i no_plant = _mm256_cmpeq_epi32(_mm256_and_si256(value, species_mask), zero);
+        __m256i dead = _mm256_cmpeq_epi32(_mm256_and_si256(value, alive_bit), zero);
+        __m256i dead_plant = _mm256_andnot_si256(no_plant, dead);
+        if (_mm256_testz_si256(dead_plant, dead_plant)) // Most blocks are empty or fully alive
+            continue;
+
+        // Countdowns are less than 2^23, so comparing them as signed numbers is fine
+        __m256i counting = _mm256_and_si256(dead_plant, _mm256_cmpgt_epi32(_mm256_srli_epi32(value, PlantLayer::COUNTDOWN_SHIFT), zero));
+        value = _mm256_sub_epi32(value, _mm256_and_si256(counting, step));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(cells + i), value);
+        __m256i grown = _mm256_and_si256(dead_plant, _mm256_cmpeq_epi32(_mm256_srli_epi32(value, PlantLayer::COUNTDOWN_SHIFT), zero));
+
+        unsigned int counting_mask = _mm256_movemask_ps(_mm256_castsi256_ps(counting));
+        for (; counting_mask; counting_mask &= counting_mask - 1)
+            counted_down.push_back(i + __builtin_ctz(counting_mask));
+        unsigned int grown_mask = _mm256_movemask_ps(_mm256_castsi256_ps(grown));
+        for (; grown_mask; grown_mask &= grown_mask - 1)
+            ready.push_back(i + __builtin_ctz(grown_mask));
+    }
+    regrowPlantsScalar(cells, i, count, counted_down, ready);
+}
+#endif
+
+// Dispatch:
+
+void Kernels::regrowPlants(std::uint32_t* cells, int count, std::vector<int>& counted_down, std::vector<int>& ready, Implementation implementation){
+    counted_down.clear();
+    ready.clear();
+#if KERNELS_HAVE_AVX2
+    if (implementation == AVX2Implementation){
+        regrowPlantsAVX2(cells, count, counted_down, ready);
+        return;
+    }
+#endif
+    regrowPlantsScalar(cells, 0, count, counted_down, ready);
+}
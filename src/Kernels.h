@@ -0,0 +1,35 @@
+#ifndef KERNELS_H
+#define KERNELS_H
+
+#include <vector>
+#include <cstdint>
+
+/*
+Batched versions of the simple arithmetic every organism goes through, working on packed arrays instead of one object at a time
+- Every kernel has a scalar version and an AVX2 version. The AVX2 version is only used if the CPU supports it (checked once at runtime),
+  so the program still runs everywhere. Both versions always give exactly the same results
+- The scalar versions are plain loops, so the compiler is free to vectorize them with whatever instructions the build allows
+*/
+class Kernels {
+    public:
+    enum Implementation{
+        ScalarImplementation,
+        AVX2Implementation
+    };
+
+    /*
+    - Best implementation this CPU supports
+    */
+    static Implementation getBestImplementation();
+
+    static const char* getName(Implementation implementation);
+
+    /*
+    - Regrow every dead plant in a PlantLayer's cells by 1 (the countdown part of PlantLayer::regrow()). Cells that are empty or alive aren't touched
+    - Indexes of cells whose countdown went down are put in counted_down. Indexes of dead plants whose countdown is now 0 (they're ready to revive
+      if nothing is standing on them) are put in ready. Both are cleared first and come out in increasing order
+    */
+    static void regrowPlants(std::uint32_t* cells, int count, std::vector<int>& counted_down, std::vector<int>& ready, Implementation implementation = getBestImplementation());
+};
+
+#endif
@@ -0,0 +1,385 @@
+#include "LayeredEngine.h"
+
+#include <algorithm>
+
+LayeredEngine::LayeredEngine(bool defer_idle_tiles) : m_defer_idle_tiles(defer_idle_tiles) {}
+
+std::string LayeredEngine::getName() const{
+    return m_defer_idle_tiles ? "hybrid" : "layered";
+}
+
+std::size_t LayeredEngine::getMemoryUsage() const{
+    std::size_t memory = m_animals.capacity() * sizeof(Animal*) + m_animal_keys.capacity() * sizeof(std::uint64_t);
+    memory += m_moved_plant_keys.size() * (sizeof(int) + sizeof(std::uint64_t) + 2 * sizeof(void*)); // Key, value and the node's and bucket's pointers
+    memory += m_cell_tiles.capacity() * sizeof(std::unique_ptr<Cell[]>) + m_cell_tile_stamps.capacity() * sizeof(unsigned int) + m_allocated_tiles.capacity() * sizeof(int);
+    memory += m_allocated_tiles.size() * CELL_TILE_SIZE * sizeof(Cell);
+    return memory;
+}
+
+// Private methods:
+
+LayeredEngine::Cell& LayeredEngine::getCell(int cell_index){
+    int tile = cell_index / CELL_TILE_SIZE;
+    if (!m_cell_tiles[tile])
+        makeTile(tile);
+    m_cell_tile_stamps[tile] = m_stamp;
+
+    Cell& cell = m_cell_tiles[tile][cell_index % CELL_TILE_SIZE];
+    cell.stamp = m_stamp;
+    return cell;
+}
+
+LayeredEngine::Cell* LayeredEngine::findCell(int cell_index){
+    int tile = cell_index / CELL_TILE_SIZE;
+    if (!m_cell_tiles[tile])
+        return nullptr;
+    Cell& cell = m_cell_tiles[tile][cell_index % CELL_TILE_SIZE];
+    return cell.stamp == m_stamp ? &cell : nullptr;
+}
+
+void LayeredEngine::makeTile(int tile){
+    // Nothing is in the new tile yet, but the cells next to its cells might be occupied
+    m_cell_tiles[tile].reset(new Cell[CELL_TILE_SIZE]);
+    m_allocated_tiles.push_back(tile);
+    computeMasks(tile);
+}
+
+void LayeredEngine::computeMasks(int tile){
+    int width = std::get<0>(m_map_dimensions);
+    int first_cell = tile * CELL_TILE_SIZE;
+    int end_cell = std::min<std::size_t>(first_cell + CELL_TILE_SIZE, static_cast<std::size_t>(width) * std::get<1>(m_map_dimensions));
+    for (int cell_index = first_cell; cell_index < end_cell; cell_index++){
+        std::uint8_t mask = FreeMaskGrid::getEmptyMask(cell_index % width, cell_index / width, m_map_dimensions);
+        for (int directions = mask >> FreeMaskGrid::IN_MAP_SHIFT; directions; directions &= directions - 1){
+            int direction = __builtin_ctz(directions);
+            if (isOccupied(cell_index + Animal::DIRECTION_OFFSETS[direction][0] + (Animal::DIRECTION_OFFSETS[direction][1] * width)))
+                mask &= ~(1 << direction);
+        }
+        m_cell_tiles[tile][cell_index - first_cell].free_mask = mask;
+    }
+}
+
+bool LayeredEngine::isOccupied(int cell_index) const{
+    const std::unique_ptr<Cell[]>& tile = m_cell_tiles[cell_index / CELL_TILE_SIZE];
+    if (tile && tile[cell_index % CELL_TILE_SIZE].live_animal)
+        return true;
+    return m_pool->getPlantLayer().isAlive(cell_index);
+}
+
+void LayeredEngine::setOccupied(int cell_index, bool occupied){
+    // The cell in direction d sees this cell in the opposite direction (d ^ 1). Cells in tiles that don't exist get their masks when they're made
+    int width = std::get<0>(m_map_dimensions);
+    const std::unique_ptr<Cell[]>& tile = m_cell_tiles[cell_index / CELL_TILE_SIZE];
+    int mask = tile ? tile[cell_index % CELL_TILE_SIZE].free_mask : FreeMaskGrid::getEmptyMask(cell_index % width, cell_index / width, m_map_dimensions);
+    for (int directions = mask >> FreeMaskGrid::IN_MAP_SHIFT; directions; directions &= directions - 1){
+        int direction = __builtin_ctz(directions);
+        int neighbor_index = cell_index + Animal::DIRECTION_OFFSETS[direction][0] + (Animal::DIRECTION_OFFSETS[direction][1] * width);
+        const std::unique_ptr<Cell[]>& neighbor_tile = m_cell_tiles[neighbor_index / CELL_TILE_SIZE];
+        if (!neighbor_tile)
+            continue;
+        std::uint8_t& neighbor_mask = neighbor_tile[neighbor_index % CELL_TILE_SIZE].free_mask;
+        if (occupied)
+            neighbor_mask &= ~(1 << (direction ^ 1));
+        else
+            neighbor_mask |= 1 << (direction ^ 1);
+    }
+}
+
+void LayeredEngine::rebuildGrid(){
+    for (int tile : m_allocated_tiles)
+        m_cell_tiles[tile].reset();
+    m_allocated_tiles.clear();
+
+    const PlantLayer& plant_layer = m_pool->getPlantLayer();
+    for (std::size_t i = 0; i < m_animals.size(); i++){
+        Animal* animal = m_animals[i];
+        int cell_index = plant_layer.getCellIndex(std::get<0>(animal->getCoords()), std::get<1>(animal->getCoords()));
+        Cell& cell = getCell(cell_index);
+        cell.animals++;
+        if (animal->isAlive()){
+            bool was_occupied = isOccupied(cell_index);
+            cell.live_animal = animal;
+            cell.live_animal_key = m_animal_keys[i];
+            if (!was_occupied)
+                setOccupied(cell_index, true);
+        }
+    }
+}
+
+std::uint64_t LayeredEngine::getCellKey(int cell_index){
+    return (static_cast<std::uint64_t>(cell_index) + 1) << 32;
+}
+
+std::uint64_t LayeredEngine::getPlantKey(int cell_index) const{
+    if (!m_moved_plant_keys.empty()){
+        auto it = m_moved_plant_keys.find(cell_index);
+        if (it != m_moved_plant_keys.end())
+            return it->second;
+    }
+    return getCellKey(cell_index);
+}
+
+void LayeredEngine::buildOrder(OrganismPool& organisms){
+    PlantLayer& plant_layer = organisms.getPlantLayer();
+    plant_layer.resize(m_map_dimensions);
+
+    // Plants already in the layer are merged in by cell, so the ones that had their own keys get their cell's key back
+    m_moved_plant_keys.clear();
+    m_animals.clear();
+    m_animal_keys.clear();
+
+    // Every key has to be bigger than the one before it. A plant in layer cell c goes in front of the first organism in the pool whose cell
+    // is c or later, so an organism comes after every layer plant up to the furthest cell seen so far
+    std::uint64_t last_key = 0;
+    int furthest_cell = -1;
+    for (Organism* org : organisms.getOrganisms()){
+        int cell = plant_layer.getCellIndex(std::get<0>(org->getCoords()), std::get<1>(org->getCoords()));
+        furthest_cell = std::max(furthest_cell, cell);
+        if (org->getType() == Organism::PlantEnum){
+            // Only a plant that's out of cell order needs a key of its own
+            last_key = std::max(last_key + 1, getCellKey(cell));
+            if (last_key != getCellKey(cell))
+                m_moved_plant_keys[cell] = last_key;
+        }
+        else{
+            last_key = std::max(last_key, getCellKey(furthest_cell)) + 1;
+            m_animals.push_back(static_cast<Animal*>(org));
+            m_animal_keys.push_back(last_key);
+        }
+    }
+
+    // Plant objects only need to be moved over once. Their keys already come from their cells
+    Ecosystem::movePlantsToLayer(organisms, m_map_dimensions);
+    m_pool = &organisms;
+}
+
+// Methods:
+
+void LayeredEngine::update(OrganismPool& organisms, const std::tuple<int, int>& map_dimensions, long long iteration){
+    run(organisms, map_dimensions, iteration, 1);
+}
+
+void LayeredEngine::run(OrganismPool& organisms, const std::tuple<int, int>& map_dimensions, long long first_iteration, long long iteration_count){
+    checkVision(organisms);
+    for (long long iteration = first_iteration; iteration < first_iteration + iteration_count; iteration++)
+        runIteration(organisms, map_dimensions, iteration);
+    if (m_defer_idle_tiles){
+        // Catching up can revive most of the map, so the tiles that exist work their masks out again instead of every revived plant
+        // updating its neighbors
+        organisms.getPlantLayer().catchUp();
+        for (int tile : m_allocated_tiles)
+            computeMasks(tile);
+        m_world_hash = organisms.getWorldHash();
+    }
+}
+
+void LayeredEngine::runIteration(OrganismPool& organisms, const std::tuple<int, int>& map_dimensions, long long iteration){
+    PlantLayer& plant_layer = organisms.getPlantLayer();
+    if (map_dimensions != m_map_dimensions){
+        m_map_dimensions = map_dimensions;
+        std::size_t cell_count = static_cast<std::size_t>(std::get<0>(map_dimensions)) * std::get<1>(map_dimensions);
+        m_cell_tiles.clear();
+        m_cell_tiles.resize((cell_count + CELL_TILE_SIZE - 1) / CELL_TILE_SIZE);
+        m_cell_tile_stamps.assign(m_cell_tiles.size(), 0);
+        m_allocated_tiles.clear();
+        m_pool = nullptr;
+    }
+    bool pool_changed = m_pool != &organisms || organisms.getChangeCount() != m_pool_changes;
+    if (pool_changed)
+        buildOrder(organisms);
+    if (pool_changed || organisms.getWorldHash() != m_world_hash)
+        rebuildGrid();
+    m_stamp++;
+    plant_layer.startIteration();
+
+    // Plants and animals take turns in one loop, so the whole iteration (other than regrowing and cleaning up) counts as updating animals
+    PerfCounters::Scope phase_scope(PerfCounters::AnimalUpdate, m_animals.size() + plant_layer.getPlantCount());
+
+    // Mark the cells every animal is in and next to as touched, and keep the plants in them in memory. Plants that revive because their
+    // tile was behind (hybrid mode) make the cells next to them occupied
+    int width = std::get<0>(map_dimensions);
+    m_revived_cells.clear();
+    for (Animal* animal : m_animals){
+        int cell_index = plant_layer.getCellIndex(std::get<0>(animal->getCoords()), std::get<1>(animal->getCoords()));
+        Cell& cell = getCell(cell_index);
+        plant_layer.keepResident(cell_index, m_revived_cells);
+        for (int directions = cell.free_mask >> FreeMaskGrid::IN_MAP_SHIFT; directions; directions &= directions - 1){
+            int direction = __builtin_ctz(directions);
+            int neighbor_index = cell_index + Animal::DIRECTION_OFFSETS[direction][0] + (Animal::DIRECTION_OFFSETS[direction][1] * width);
+            getCell(neighbor_index);
+            plant_layer.keepResident(neighbor_index, m_revived_cells);
+        }
+    }
+    for (int cell_index : m_revived_cells)
+        setOccupied(cell_index, true);
+
+    // Count every dead plant down at once. Plants that are fully grown where no animal can reach revive now,
+    // and the ones near animals wait for their turn, since an animal might step on them first
+    {
+        PerfCounters::Scope regrow_scope(PerfCounters::PlantUpdate, plant_layer.getPlantCount());
+        plant_layer.regrowAll(m_ready_cells, Kernels::getBestImplementation(), m_defer_idle_tiles);
+        m_plant_turns.clear();
+        for (int cell_index : m_ready_cells){
+            if (findCell(cell_index)){
+                m_plant_turns.push_back(cell_index);
+            }
+            else{
+                plant_layer.revive(cell_index);
+                setOccupied(cell_index, true);
+            }
+        }
+        // Ready cells come in cell order, which is key order unless some plant has a key of its own
+        if (!m_moved_plant_keys.empty())
+            std::sort(m_plant_turns.begin(), m_plant_turns.end(), [this](int a, int b) { return getPlantKey(a) < getPlantKey(b); });
+
+        Metrics::Counters& metrics = Metrics::local();
+        metrics.plant_revive_scans += m_ready_cells.size();
+        metrics.plant_revive_candidates += m_ready_cells.size(); // Each check is just a look at the plant's own cell
+    }
+
+    // Take turns in order
+    auto plant_turn = m_plant_turns.begin();
+    for (std::size_t i = 0; i < m_animals.size(); i++){
+        for (; plant_turn != m_plant_turns.end() && getPlantKey(*plant_turn) < m_animal_keys[i]; plant_turn++)
+            updatePlant(*plant_turn, plant_layer);
+        updateAnimal(m_animals[i], m_animal_keys[i], plant_layer, organisms.getWorldHashState());
+    }
+    for (; plant_turn != m_plant_turns.end(); plant_turn++)
+        updatePlant(*plant_turn, plant_layer);
+
+    // Tiles that nothing was in this iteration are freed
+    std::size_t kept = 0;
+    for (int tile : m_allocated_tiles){
+        if (m_cell_tile_stamps[tile] != m_stamp)
+            m_cell_tiles[tile].reset();
+        else
+            m_allocated_tiles[kept++] = tile;
+    }
+    m_allocated_tiles.resize(kept);
+
+    cleanUp(organisms);
+}
+
+void LayeredEngine::updatePlant(int cell_index, PlantLayer& plant_layer){
+    // Same as the end of Plant::update(): a fully grown plant revives unless something is standing on it
+    if (getCell(cell_index).animals == 0){
+        plant_layer.revive(cell_index);
+        setOccupied(cell_index, true);
+    }
+}
+
+void LayeredEngine::updateAnimal(Animal* animal, std::uint64_t key, PlantLayer& plant_layer, Organism::WorldHash& world_hash){
+    int width = std::get<0>(m_map_dimensions);
+    int old_cell_index = plant_layer.getCellIndex(std::get<0>(animal->getCoords()), std::get<1>(animal->getCoords()));
+    int own_mask = getCell(old_cell_index).free_mask;
+    bool eats_plants = animal->isPredatorTo(Organism::PlantEnum);
+
+    // Look at this animal's own cell and the cells next to it that its mask says are occupied. Like Animal::update(), the edible organism that
+    // comes first in the order is eaten
+    Organism* food = nullptr;
+    int food_plant_cell = -1;
+    std::uint64_t food_key = UINT64_MAX;
+    int candidates = 0;
+    auto check_cell = [&](int cell_index){
+        Cell& cell = getCell(cell_index);
+        if (cell.live_animal && cell.live_animal != animal){
+            candidates++;
+            if (animal->isPredatorTo(cell.live_animal) && animal->hungryEnoughToEat(cell.live_animal) && cell.live_animal_key < food_key){
+                food = cell.live_animal;
+                food_plant_cell = -1;
+                food_key = cell.live_animal_key;
+            }
+        }
+        else if (plant_layer.isAlive(cell_index)){
+            candidates++;
+            if (eats_plants && animal->hungryEnoughToEat(plant_layer.getSpecies(cell_index).energy_points) && getPlantKey(cell_index) < food_key){
+                food = nullptr;
+                food_plant_cell = cell_index;
+                food_key = getPlantKey(cell_index);
+            }
+        }
+    };
+    check_cell(old_cell_index);
+    for (int directions = (own_mask >> FreeMaskGrid::IN_MAP_SHIFT) & ~own_mask; directions; directions &= directions - 1){
+        int direction = __builtin_ctz(directions);
+        check_cell(old_cell_index + Animal::DIRECTION_OFFSETS[direction][0] + (Animal::DIRECTION_OFFSETS[direction][1] * width));
+    }
+
+    Metrics::Counters& metrics = Metrics::local();
+    metrics.animal_updates++;
+    metrics.neighbor_candidates += candidates;
+
+    if (food){
+        animal->addHealth(-1, world_hash); // Animal needs to expend 1 energy point to reach organism to eat
+        animal->eat(food, world_hash);
+
+        // Food is dead now
+        int food_cell_index = plant_layer.getCellIndex(std::get<0>(food->getCoords()), std::get<1>(food->getCoords()));
+        Cell& food_cell = getCell(food_cell_index);
+        if (food_cell.live_animal == food)
+            food_cell.live_animal = nullptr;
+        if (!isOccupied(food_cell_index))
+            setOccupied(food_cell_index, false);
+    }
+    else if (food_plant_cell != -1){
+        // Same steps as Animal::eat()
+        animal->addHealth(-1, world_hash);
+        animal->addHealth(plant_layer.getSpecies(food_plant_cell).energy_points, world_hash);
+        animal->moveTo(plant_layer.getCoords(food_plant_cell), world_hash);
+        plant_layer.eat(food_plant_cell);
+        if (!isOccupied(food_plant_cell))
+            setOccupied(food_plant_cell, false);
+
+        // If the plant's turn hasn't come yet, it still regrows by 1 this iteration. This animal is standing on it, so it stays dead
+        if (key < food_key)
+            plant_layer.regrow(food_plant_cell, true);
+    }
+    else{
+        animal->moveRandomly(world_hash, own_mask & FreeMaskGrid::FREE_DIRECTIONS);
+    }
+
+    // Move animal in the grid (it might not have moved, and might have died)
+    Cell& old_cell = getCell(old_cell_index);
+    if (old_cell.live_animal == animal){
+        old_cell.live_animal = nullptr;
+        if (!isOccupied(old_cell_index))
+            setOccupied(old_cell_index, false);
+    }
+    old_cell.animals--;
+
+    int new_cell_index = plant_layer.getCellIndex(std::get<0>(animal->getCoords()), std::get<1>(animal->getCoords()));
+    Cell& new_cell = getCell(new_cell_index);
+    new_cell.animals++;
+    if (animal->isAlive()){
+        bool was_occupied = isOccupied(new_cell_index);
+        new_cell.live_animal = animal;
+        new_cell.live_animal_key = key;
+        if (!was_occupied)
+            setOccupied(new_cell_index, true);
+    }
+}
+
+void LayeredEngine::cleanUp(OrganismPool& organisms){
+    PerfCounters::Scope phase_scope(PerfCounters::Cleanup, m_animals.size());
+
+    // Clean up any eaten animals, keeping everything else in the same order like Ecosystem::cleanUpEcosystem() does.
+    // The animals that are left keep their keys, since their order didn't change
+    const PlantLayer& plant_layer = organisms.getPlantLayer();
+    std::size_t kept = 0;
+    for (std::size_t i = 0; i < m_animals.size(); i++){
+        if (!m_animals[i]->isAlive()){
+            getCell(plant_layer.getCellIndex(std::get<0>(m_animals[i]->getCoords()), std::get<1>(m_animals[i]->getCoords()))).animals--;
+        }
+        else{
+            m_animals[kept] = m_animals[i];
+            m_animal_keys[kept] = m_animal_keys[i];
+            kept++;
+        }
+    }
+    m_animals.resize(kept);
+    m_animal_keys.resize(kept);
+    Metrics::local().cleanup_erases += organisms.eraseIf([](const Organism* org) { return !org->isAlive(); });
+
+    m_pool_changes = organisms.getChangeCount();
+    m_world_hash = organisms.getWorldHash();
+}
@@ -0,0 +1,122 @@
+#ifndef LAYEREDENGINE_H
+#define LAYEREDENGINE_H
+
+#include "Engine.h"
+
+#include <unordered_map>
+
+/*
+Serial engine where plants live in the pool's PlantLayer instead of being Organism objects, with the same results as the reference engine
+- Plants that are still Organism objects get moved into the layer at the start of the first iteration
+- The plant layer can be kept in a file (PlantLayer::useBackingFile()). Tiles with animals in or next to them are kept in memory, and regrowing
+  only looks at tiles with dead plants, so an iteration only pages in tiles near animals
+- Animals find plants by indexing the plant layer at their own cell and the 4 cells next to it, and find other animals through a per-cell grid,
+  so they never look through every organism. The grid is kept across iterations, and every cell in it has a mask of which cells next to it
+  are free (no living animal or plant), laid out like FreeMaskGrid's. Animals only look at the neighbors their mask says are occupied.
+  Masks are updated when an animal moves or dies and when a plant is eaten or revives, including plants that revive while a tile is caught
+  up in hybrid mode. The grid is only rebuilt when something else changed the pool or the world hash since the engine last ran
+- The reference engine updates organisms in pool order, and plants are part of that order, so every organism gets a 64-bit key that sorts
+  the same way (see getPlantKey()). A plant's key comes from its cell, since plants are loaded in cell order, so nothing is stored per plant
+  or per cell. Only animals (m_animal_keys) and plants that are out of cell order in the pool (m_moved_plant_keys) store their keys.
+  Dead animals are erased without changing the order of the rest, so keys never have to be given out again. Re-sorting by Morton order isn't
+  supported, so results match "reference", not "reference:morton"
+- Every plant has the same place in the order as in the reference engine, so only what can be seen from outside has to happen on a plant's turn:
+    1. Every dead plant regrows at the start of the iteration (PlantLayer::regrowAll()). Nothing can see a dead plant's countdown, so only
+       plants that become fully grown near an animal wait for their turn to check whether they're occupied. The rest revive right away
+    2. An animal eats the edible neighbor that comes first in the order, like Animal::update() does
+    3. A plant that's eaten before its turn still regrows by 1 this iteration (the animal that ate it is standing on it, so it can't revive)
+- If something outside the engine inserts or erases organisms (see OrganismPool::getChangeCount()), the order is made again from the pool's
+  order, with plants that were already in the layer merged in by cell (the order they were loaded in). Results only match the reference
+  engine if it had the same order
+- Hybrid mode ("hybrid") lets tiles of the plant layer with no animal in or next to them fall behind on regrowing, and catches them up in one go
+  when an animal comes near or at the end of run(). Nothing can eat or stand on a plant there, so its countdown just goes down by 1 each
+  iteration and catching up is exact: results are the same as "layered", it just skips the work on the plant-only parts of the map
+- Animals don't use their vision radius here, so worlds where some animal has one are refused (see Engine::checkVision())
+*/
+class LayeredEngine : public Engine {
+    struct Cell {
+        Organism* live_animal{nullptr}; // Living animal in this cell, if any
+        std::uint64_t live_animal_key{}; // Key of live_animal (see m_animal_keys)
+        int animals{}; // Animals in this cell, including ones that died this iteration (they still block plants from reviving)
+        unsigned int stamp{}; // Last iteration an animal was in or next to this cell
+        std::uint8_t free_mask{}; // Free directions and directions that are in the map (same layout as FreeMaskGrid's masks)
+    };
+
+    static constexpr int CELL_TILE_SIZE = 1024; // Cells per tile of the grid
+
+    // The grid is split into tiles, and only tiles with animals in or next to them exist, so the grid stays small on maps that are mostly
+    // empty of animals (and might not fit in memory at all). A tile that nothing was in or next to for an iteration is freed, and its
+    // masks are worked out again from the plant layer and the tiles around it if it's needed again
+    std::vector<std::unique_ptr<Cell[]>> m_cell_tiles; // Cell (y * width) + x is in tile cell / CELL_TILE_SIZE
+    std::vector<unsigned int> m_cell_tile_stamps; // Last iteration each tile was used in
+    std::vector<int> m_allocated_tiles; // Tiles of m_cell_tiles that exist, so freeing them doesn't have to look at every tile of the map
+
+    // Every animal in the order the reference engine would update it in, and its key. A plant in cell c comes after every organism
+    // with a smaller key and before every organism with a bigger one
+    std::vector<Animal*> m_animals;
+    std::vector<std::uint64_t> m_animal_keys;
+    std::unordered_map<int, std::uint64_t> m_moved_plant_keys; // Keys of plants whose place in the pool didn't follow cell order (see getPlantKey())
+    const OrganismPool* m_pool{nullptr}; // Pool the keys were given out for
+    std::uint64_t m_pool_changes{0}; // Change count of m_pool when the keys were last up to date with it
+    std::uint64_t m_world_hash{0}; // World hash of m_pool when the grid was last up to date with it
+
+    std::vector<int> m_plant_turns; // Cells of fully grown plants near animals, by key (scratch space for runIteration())
+    std::vector<int> m_ready_cells; // Dead plants that are fully grown this iteration (see PlantLayer::regrowAll())
+    std::vector<int> m_revived_cells; // Plants revived while catching up tiles (see PlantLayer::keepResident())
+    std::tuple<int, int> m_map_dimensions{0, 0};
+    unsigned int m_stamp{0};
+    bool m_defer_idle_tiles{false};
+
+    // Private methods:
+    Cell& getCell(int cell_index); // Get cell and mark it as touched this iteration, making its tile first if it doesn't exist
+    Cell* findCell(int cell_index); // Get cell if its tile exists and it's been touched this iteration, nullptr otherwise
+    void makeTile(int tile); // Allocate a tile of the grid and work out the masks of its cells
+    void computeMasks(int tile); // Work out the masks of a tile's cells from the plant layer and the animals in the grid
+    bool isOccupied(int cell_index) const; // Whether a cell has a living animal or plant in it
+    void setOccupied(int cell_index, bool occupied); // Update the masks of the cells next to a cell that just became occupied or free
+    void rebuildGrid(); // Put every animal in a new grid
+    static std::uint64_t getCellKey(int cell_index); // ((cell_index + 1) << 32). Cell -1 gets 0
+
+    /*
+    - Key of the plant in cell_index: getCellKey(cell_index), unless the plant is in m_moved_plant_keys
+    - Animals get keys with low bits set (see buildOrder()), so they sort between the plants that came before and after them in the pool
+    */
+    std::uint64_t getPlantKey(int cell_index) const;
+
+    /*
+    - Give every animal in the pool a key, and move every Plant object into the plant layer
+    - Plants that were already in the layer go in front of the first organism in a later cell (or in the same cell, since a plant comes
+      before an animal standing on it), the order they were loaded in
+    */
+    void buildOrder(OrganismPool& organisms);
+    void updateAnimal(Animal* animal, std::uint64_t key, PlantLayer& plant_layer, Organism::WorldHash& world_hash);
+    void updatePlant(int cell_index, PlantLayer& plant_layer); // Turn of a fully grown plant near an animal
+    void cleanUp(OrganismPool& organisms); // Same as Ecosystem::cleanUpEcosystem(), for m_animals and the pool together
+    void runIteration(OrganismPool& organisms, const std::tuple<int, int>& map_dimensions, long long iteration);
+
+    public:
+    /*
+    - defer_idle_tiles turns on hybrid mode
+    */
+    explicit LayeredEngine(bool defer_idle_tiles = false);
+
+    std::string getName() const override;
+
+    /*
+    - Memory the engine itself uses (in bytes): the animals and their keys, and the grid tiles that exist. Nothing is kept per plant or per
+      cell of the map, so none of it grows with the plant layer, which has a memory limit of its own
+    */
+    std::size_t getMemoryUsage() const;
+
+    /*
+    - In hybrid mode, every tile is caught up at the end of each update(), so the plant layer is always up to date in between
+    */
+    void update(OrganismPool& organisms, const std::tuple<int, int>& map_dimensions, long long iteration) override;
+
+    /*
+    - In hybrid mode, tiles are only caught up at the end, so plant-only tiles are regrown once per run() instead of once per iteration
+    */
+    void run(OrganismPool& organisms, const std::tuple<int, int>& map_dimensions, long long first_iteration, long long iteration_count) override;
+};
+
+#endif
@@ -0,0 +1,238 @@
+#include "MapFile.h"
+#include "Helper.h"
+
+#include <cstring>
+#include <fstream>
+
+// Header:
+
+bool MapFile::Header::hasLetter(char letter_id) const{
+    return letter_id >= 0 && (letters[letter_id / 8] >> (letter_id % 8)) & 1;
+}
+
+// Little-endian helpers. Header fields are written a byte at a time, so files are the same on every machine
+
+static void writeUint(std::ostream& stream, std::uint64_t value, int bytes){
+    for (int i = 0; i < bytes; i++)
+        stream.put(static_cast<char>((value >> (8 * i)) & 0xFF));
+}
+
+static std::uint64_t readUint(const unsigned char* bytes, int count){
+    std::uint64_t value = 0;
+    for (int i = 0; i < count; i++)
+        value |= static_cast<std::uint64_t>(bytes[i]) << (8 * i);
+    return value;
+}
+
+static void writeVarint(std::ostream& stream, std::uint64_t value){
+    while (value >= 0x80){
+        stream.put(static_cast<char>((value & 0x7F) | 0x80));
+        value >>= 7;
+    }
+    stream.put(static_cast<char>(value));
+}
+
+static void writeHeader(std::ostream& stream, const MapFile::Header& header){
+    stream.write(MapFile::MAGIC, sizeof(MapFile::MAGIC));
+    writeUint(stream, header.width, 4);
+    writeUint(stream, header.height, 4);
+    writeUint(stream, header.organism_count, 8);
+    writeUint(stream, header.run_count, 8);
+    stream.write(reinterpret_cast<const char*>(header.letters), sizeof(header.letters));
+}
+
+// Reader:
+
+MapFile::Reader::Reader(std::istream& stream, const std::string& source_name) : m_stream(stream), m_source_name(source_name) {
+    unsigned char bytes[HEADER_SIZE];
+    if (!m_stream.read(reinterpret_cast<char*>(bytes), HEADER_SIZE) || std::memcmp(bytes, MAGIC, sizeof(MAGIC)) != 0)
+        fail("it doesn't start with a binary map header");
+
+    std::uint64_t width = readUint(bytes + 8, 4), height = readUint(bytes + 12, 4);
+    if (width > static_cast<std::uint64_t>(INT32_MAX) || height > static_cast<std::uint64_t>(INT32_MAX))
+        fail("its dimensions are too big");
+    m_header.width = width;
+    m_header.height = height;
+    m_header.organism_count = readUint(bytes + 16, 8);
+    m_header.run_count = readUint(bytes + 24, 8);
+    std::memcpy(m_header.letters, bytes + 32, sizeof(m_header.letters));
+    m_runs_left = m_header.run_count;
+}
+
+const MapFile::Header& MapFile::Reader::getHeader() const{
+    return m_header;
+}
+
+void MapFile::Reader::fail(const std::string& problem) const{
+    std::cerr << "Error: " << m_source_name << " isn't a valid binary map: " << problem << '\n';
+    Helper::quit(2);
+    throw Helper::QuitError(2); // Only reached if quit() didn't end the program or throw
+}
+
+std::uint64_t MapFile::Reader::readVarint(){
+    std::streambuf* buffer = m_stream.rdbuf();
+    std::uint64_t value = 0;
+    for (int shift = 0; shift < 64; shift += 7){
+        int byte = buffer->sbumpc();
+        if (byte == std::char_traits<char>::eof())
+            fail("it ends in the middle of a run");
+        value |= static_cast<std::uint64_t>(byte & 0x7F) << shift;
+        if (!(byte & 0x80))
+            return value;
+    }
+    fail("a number in it is too long");
+}
+
+bool MapFile::Reader::next(Run& run){
+    if (m_runs_left == 0){
+        if (m_organisms_read != m_header.organism_count)
+            fail("its header has the wrong number of organisms");
+        return false;
+    }
+    m_runs_left--;
+
+    std::uint64_t cell_count = static_cast<std::uint64_t>(m_header.width) * m_header.height;
+    std::uint64_t gap = readVarint();
+    std::uint64_t length = readVarint() + 1;
+    int letter_id = m_stream.rdbuf()->sbumpc();
+    if (letter_id == std::char_traits<char>::eof())
+        fail("it ends in the middle of a run");
+
+    // Checked this way round so huge values can't overflow
+    if (gap > cell_count - m_next_cell || length > cell_count - m_next_cell - gap)
+        fail("a run goes past the end of the map");
+    if (length > UINT32_MAX)
+        fail("a run is too long");
+
+    run.first_cell = m_next_cell + gap;
+    run.length = length;
+    run.letter_id = static_cast<char>(letter_id);
+    m_next_cell = run.first_cell + length;
+    m_organisms_read += length;
+    return true;
+}
+
+// Methods:
+
+bool MapFile::isBinaryMap(std::istream& stream){
+    char magic[sizeof(MAGIC)];
+    std::streampos start = stream.tellg();
+    bool binary = stream.read(magic, sizeof(magic)) && std::memcmp(magic, MAGIC, sizeof(MAGIC)) == 0;
+    stream.clear();
+    stream.seekg(start);
+    return binary;
+}
+
+bool MapFile::isBinaryMap(const std::filesystem::path& file_path){
+    std::ifstream file(file_path, std::ios::binary);
+    return file.is_open() && isBinaryMap(file);
+}
+
+std::tuple<int, int> MapFile::readOrgCoords(std::istream& stream, const std::string& source_name, std::vector<std::tuple<char, std::tuple<int, int>>>& organism_coords_vect, int offset){
+    Reader reader(stream, source_name);
+    const Header& header = reader.getHeader();
+
+    // The count comes from the file, so don't trust it further than the map could hold
+    std::uint64_t cell_count = static_cast<std::uint64_t>(header.width) * header.height;
+    organism_coords_vect.reserve(organism_coords_vect.size() + std::min(header.organism_count, cell_count));
+
+    Run run;
+    while (reader.next(run)){
+        for (std::uint64_t cell = run.first_cell; cell < run.first_cell + run.length; cell++)
+            organism_coords_vect.push_back({run.letter_id, {static_cast<int>(cell % header.width) + offset, static_cast<int>(cell / header.width)}});
+    }
+    return {header.width, header.height};
+}
+
+void MapFile::convert(const std::filesystem::path& input_file, const std::filesystem::path& output_file){
+    std::ifstream input(input_file, std::ios::binary);
+    if (!input.is_open()){
+        std::cerr << "Error: Couldn't open " << input_file << " for reading\n";
+        Helper::quit(1);
+    }
+    std::ofstream output(output_file, std::ios::binary | std::ios::trunc);
+    if (!output.is_open()){
+        std::cerr << "Error: Couldn't open " << output_file << " for writing\n";
+        Helper::quit(8);
+    }
+
+    if (isBinaryMap(input)){
+        // Binary to text: rows are filled in from the runs and written out as soon as the runs move past them
+        Reader reader(input, input_file.string());
+        const Header& header = reader.getHeader();
+        std::string row(header.width, ' ');
+        int y_coord = 0;
+        Run run;
+        while (reader.next(run)){
+            for (std::uint64_t cell = run.first_cell; cell < run.first_cell + run.length; cell++){
+                for (; y_coord < cell / header.width; y_coord++){
+                    output << row << '\n';
+                    std::fill(row.begin(), row.end(), ' ');
+                }
+                row[cell % header.width] = run.letter_id;
+            }
+        }
+        for (; y_coord < header.height; y_coord++){
+            output << row << '\n';
+            std::fill(row.begin(), row.end(), ' ');
+        }
+    }
+    else {
+        // Text to binary. The width is the longest line (same as Ecosystem::getMapDimensions()), so it takes a pass to find it
+        Header header;
+        std::string line;
+        while (std::getline(input, line)){
+            if (!line.empty() && line.back() == '\r') // Ignore Windows line endings
+                line.pop_back();
+            header.width = std::max<int>(header.width, line.size());
+            header.height++;
+        }
+        input.clear();
+        input.seekg(0);
+
+        // Counts and letters aren't known until the end, so the header is written again once they are
+        writeHeader(output, header);
+        Run run{0, 0, 0};
+        std::uint64_t next_cell = 0;
+        auto writeRun = [&]() {
+            writeVarint(output, run.first_cell - next_cell);
+            writeVarint(output, run.length - 1);
+            output.put(run.letter_id);
+            next_cell = run.first_cell + run.length;
+            header.run_count++;
+        };
+
+        for (std::uint64_t y_coord = 0; std::getline(input, line); y_coord++){
+            if (!line.empty() && line.back() == '\r')
+                line.pop_back();
+
+            for (int x_coord = 0; x_coord < line.size(); x_coord++){
+                char letter_id = line[x_coord];
+                if (letter_id == ' ')
+                    continue;
+
+                std::uint64_t cell = (y_coord * header.width) + x_coord;
+                if (run.length > 0 && run.length < UINT32_MAX && run.letter_id == letter_id && run.first_cell + run.length == cell)
+                    run.length++;
+                else {
+                    if (run.length > 0)
+                        writeRun();
+                    run = {cell, 1, letter_id};
+                }
+                header.organism_count++;
+                if (letter_id >= 0)
+                    header.letters[letter_id / 8] |= 1 << (letter_id % 8);
+            }
+        }
+        if (run.length > 0)
+            writeRun();
+
+        output.seekp(0);
+        writeHeader(output, header);
+    }
+
+    if (!output.flush()){
+        std::cerr << "Error: Couldn't write " << output_file << '\n';
+        Helper::quit(8);
+    }
+}
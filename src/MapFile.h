@@ -0,0 +1,99 @@
+#ifndef MAPFILE_H
+#define MAPFILE_H
+
+#include <cstdint>
+#include <istream>
+#include <filesystem>
+#include <string>
+#include <tuple>
+#include <vector>
+
+/*
+Compact binary map format, where size and load time depend on how many organisms there are instead of how big the map is
+- Layout (little-endian):
+    8 bytes  - MAGIC
+    uint32   - width, then height
+    uint64   - number of organisms, then number of runs
+    16 bytes - bitmap of the letter IDs that are in the map (bit c of byte c / 8 for letter c), so species can be checked up front
+    runs     - in row-major order. Each run is varint(empty cells skipped since the end of the last run), varint(length - 1), letter ID byte
+- A run is a stretch of cells in a row (or wrapping onto the next ones) that all have an organism of the same species, so a dense field of
+  plants takes a few bytes per row and a sparse map takes a few bytes per organism
+- Varints are LEB128: 7 bits per byte, lowest bits first, high bit set on every byte but the last
+- Text maps can be converted to binary maps and back (convert()). Everything that reads maps (Ecosystem) reads both formats
+*/
+class MapFile {
+    public:
+    static constexpr char MAGIC[8] = {'E', 'C', 'O', 'M', 'A', 'P', '1', '\n'};
+    static constexpr int HEADER_SIZE = 48;
+
+    struct Header {
+        int width{0};
+        int height{0};
+        std::uint64_t organism_count{0};
+        std::uint64_t run_count{0};
+        std::uint8_t letters[16]{};
+
+        bool hasLetter(char letter_id) const;
+    };
+
+    /*
+    Cells first_cell to first_cell + length - 1 (row-major, so cell = (y * width) + x) all have an organism with this letter ID
+    */
+    struct Run {
+        std::uint64_t first_cell;
+        std::uint32_t length;
+        char letter_id;
+    };
+
+    /*
+    Reads a binary map one run at a time, so the whole map never has to be in memory
+    */
+    class Reader {
+        std::istream& m_stream;
+        std::string m_source_name;
+        Header m_header;
+        std::uint64_t m_runs_left{0};
+        std::uint64_t m_next_cell{0}; // First cell the next run can start at
+        std::uint64_t m_organisms_read{0};
+
+        // Private methods:
+        std::uint64_t readVarint();
+        [[noreturn]] void fail(const std::string& problem) const; // Quits (error 2)
+
+        public:
+        /*
+        - Read the header of the binary map in stream. source_name is used in error messages
+        - Quits (error 2) if the stream isn't a valid binary map
+        */
+        Reader(std::istream& stream, const std::string& source_name);
+
+        const Header& getHeader() const;
+
+        /*
+        - Read the next run into run. Returns false once every run has been read
+        - Quits (error 2) if the run is outside the map or the map ends early
+        */
+        bool next(Run& run);
+    };
+
+    /*
+    - See if stream starts with MAGIC. The stream is left where it was
+    */
+    static bool isBinaryMap(std::istream& stream);
+    static bool isBinaryMap(const std::filesystem::path& file_path);
+
+    /*
+    - Read every organism in the binary map in stream into organism_coords_vect, in the same order and format as Ecosystem::getOrgCoords()
+    - Returns the map dimensions
+    */
+    static std::tuple<int, int> readOrgCoords(std::istream& stream, const std::string& source_name, std::vector<std::tuple<char, std::tuple<int, int>>>& organism_coords_vect, int offset = 0);
+
+    /*
+    - Convert a text map to a binary map, or a binary map to a text map (whichever input_file isn't)
+    - Both directions stream the input, so neither map has to fit in memory. Text maps are read twice (once to find the width)
+    - Quits (error 1 or 2) if input_file can't be read, or (error 8) if output_file can't be written
+    */
+    static void convert(const std::filesystem::path& input_file, const std::filesystem::path& output_file);
+};
+
+#endif
@@ -0,0 +1,108 @@
+#include "Metrics.h"
+
+#include <algorithm>
+#include <sstream>
+
+std::mutex Metrics::m_mutex;
+std::vector<Metrics::ThreadCounters*> Metrics::m_threads;
+Metrics::Counters Metrics::m_retired;
+Metrics::Snapshot Metrics::m_snapshot;
+
+Metrics::Counters& Metrics::Counters::operator+=(const Counters& other){
+    animal_updates += other.animal_updates;
+    neighbor_candidates += other.neighbor_candidates;
+    failed_moves += other.failed_moves;
+    plant_revive_scans += other.plant_revive_scans;
+    plant_revive_candidates += other.plant_revive_candidates;
+    cleanup_erases += other.cleanup_erases;
+    return *this;
+}
+
+Metrics::ThreadCounters::ThreadCounters(){
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_threads.push_back(this);
+}
+
+Metrics::ThreadCounters::~ThreadCounters(){
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_retired += counters;
+    m_threads.erase(std::find(m_threads.begin(), m_threads.end(), this));
+}
+
+Metrics::Counters& Metrics::local(){
+    thread_local ThreadCounters thread_counters;
+    return thread_counters.counters;
+}
+
+void Metrics::recordIteration(const OrganismPool& organisms, long long iteration, double seconds, long long skipped_iterations){
+    // Count organisms outside of the lock, so readers are never kept waiting on a big pool
+    int live_animals = 0, live_plants = 0, dead_plants = 0;
+    for (const Organism* org : organisms.getOrganisms()){
+        if (org->getType() != Organism::PlantEnum)
+            live_animals += org->isAlive();
+        else if (org->isAlive())
+            live_plants++;
+        else
+            dead_plants++;
+    }
+    const PlantLayer& plant_layer = organisms.getPlantLayer(); // Plants of layered engines
+    int layer_dead_plants = plant_layer.getDeadPlantCount();
+    live_plants += plant_layer.getPlantCount() - layer_dead_plants;
+    dead_plants += layer_dead_plants;
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    Counters total = m_retired;
+    for (const ThreadCounters* thread_counters : m_threads)
+        total += thread_counters->counters;
+
+    m_snapshot.counters = total;
+    m_snapshot.iterations++;
+    m_snapshot.skipped_iterations += skipped_iterations;
+    m_snapshot.last_iteration = iteration + skipped_iterations;
+    m_snapshot.last_iteration_seconds = seconds;
+    m_snapshot.total_iteration_seconds += seconds;
+    m_snapshot.live_animals = live_animals;
+    m_snapshot.live_plants = live_plants;
+    m_snapshot.dead_plants = dead_plants;
+}
+
+Metrics::Snapshot Metrics::getSnapshot(){
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_snapshot;
+}
+
+/*
+- Write one metric (with its HELP and TYPE lines) in Prometheus text format
+*/
+template <typename T>
+static void writeMetric(std::ostream& out, const char* name, const char* type, const char* help, T value){
+    out << "# HELP " << name << ' ' << help << '\n';
+    out << "# TYPE " << name << ' ' << type << '\n';
+    out << name << ' ' << value << '\n';
+}
+
+std::string Metrics::getPrometheusText(){
+    Snapshot snapshot = getSnapshot();
+    const Counters& counters = snapshot.counters;
+
+    std::ostringstream out;
+    writeMetric(out, "ecosystem_iterations_total", "counter", "Iterations run.", snapshot.iterations);
+    writeMetric(out, "ecosystem_skipped_iterations_total", "counter", "Iterations skipped because the ecosystem was in a steady state.", snapshot.skipped_iterations);
+    writeMetric(out, "ecosystem_iteration", "gauge", "Current iteration number.", snapshot.last_iteration);
+    writeMetric(out, "ecosystem_iteration_duration_seconds_total", "counter", "Time spent running iterations.", snapshot.total_iteration_seconds);
+    writeMetric(out, "ecosystem_last_iteration_duration_seconds", "gauge", "Time the last iteration took.", snapshot.last_iteration_seconds);
+
+    out << "# HELP ecosystem_organisms Organisms in the pool.\n";
+    out << "# TYPE ecosystem_organisms gauge\n";
+    out << "ecosystem_organisms{type=\"animal\",state=\"alive\"} " << snapshot.live_animals << '\n';
+    out << "ecosystem_organisms{type=\"plant\",state=\"alive\"} " << snapshot.live_plants << '\n';
+    out << "ecosystem_organisms{type=\"plant\",state=\"dead\"} " << snapshot.dead_plants << '\n';
+
+    writeMetric(out, "ecosystem_animal_updates_total", "counter", "Animals updated.", counters.animal_updates);
+    writeMetric(out, "ecosystem_neighbor_candidates_total", "counter", "Organisms examined by animals looking for neighbors.", counters.neighbor_candidates);
+    writeMetric(out, "ecosystem_failed_moves_total", "counter", "Animals that had no free cell to move to.", counters.failed_moves);
+    writeMetric(out, "ecosystem_plant_revive_scans_total", "counter", "Occupancy checks done by regrown plants.", counters.plant_revive_scans);
+    writeMetric(out, "ecosystem_plant_revive_candidates_total", "counter", "Organisms examined during plant occupancy checks.", counters.plant_revive_candidates);
+    writeMetric(out, "ecosystem_cleanup_erases_total", "counter", "Dead animals erased from the pool.", counters.cleanup_erases);
+    return out.str();
+}
@@ -0,0 +1,80 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include "OrganismPool.h"
+
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/*
+Cheap counters for what the engine is doing internally, so a long run can be charted to see whether (and why) it's getting slower
+- Every thread has its own counters (see local()), so counting is just adding to a plain integer and threads never fight over a cache line
+- Once per iteration, recordIteration() adds up every thread's counters into a snapshot. Exporters (see MetricsExporter) only ever read the snapshot
+- The snapshot is formatted as Prometheus text by getPrometheusText()
+*/
+class Metrics {
+    public:
+    struct Counters {
+        std::uint64_t animal_updates{0}; // Animals updated
+        std::uint64_t neighbor_candidates{0}; // Organisms an animal looked at while searching for neighbors
+        std::uint64_t failed_moves{0}; // Animals that wanted to move but had no free cell next to them
+        std::uint64_t plant_revive_scans{0}; // Times a regrown plant checked whether something is standing on it
+        std::uint64_t plant_revive_candidates{0}; // Organisms looked at during those checks
+        std::uint64_t cleanup_erases{0}; // Dead animals erased from the pool
+
+        Counters& operator+=(const Counters& other);
+    };
+
+    struct Snapshot {
+        Counters counters;
+        std::uint64_t iterations{0}; // Iterations actually run
+        std::uint64_t skipped_iterations{0}; // Iterations skipped because the ecosystem was in a steady state
+        long long last_iteration{0};
+        double last_iteration_seconds{0};
+        double total_iteration_seconds{0};
+        int live_animals{0};
+        int live_plants{0};
+        int dead_plants{0};
+    };
+
+    private:
+    // Counters of one thread. They register themselves when a thread first counts something, and hand their counts over when the thread ends
+    struct ThreadCounters {
+        Counters counters;
+        ThreadCounters();
+        ~ThreadCounters();
+    };
+
+    static std::mutex m_mutex; // Protects everything below
+    static std::vector<ThreadCounters*> m_threads;
+    static Counters m_retired; // Counts from threads that have ended
+    static Snapshot m_snapshot;
+
+    public:
+    /*
+    - This thread's counters. Add to these from anywhere in the engine
+    */
+    static Counters& local();
+
+    /*
+    - Add up every thread's counters and save them, along with stats about this iteration, in the snapshot
+    - Call this between iterations (while no other thread is counting)
+    - skipped_iterations is how many iterations were skipped right after this one
+    - Plants in the pool's plant layer are counted along with Plant objects
+    */
+    static void recordIteration(const OrganismPool& organisms, long long iteration, double seconds, long long skipped_iterations = 0);
+
+    /*
+    - Copy of the latest snapshot. Safe to call from any thread
+    */
+    static Snapshot getSnapshot();
+
+    /*
+    - Latest snapshot in Prometheus text exposition format
+    */
+    static std::string getPrometheusText();
+};
+
+#endif
@@ -0,0 +1,139 @@
+#include "MetricsExporter.h"
+#include "Helper.h"
+
+#include <fstream>
+#include <cstring>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+MetricsExporter::MetricsExporter(const std::filesystem::path& textfile_path, const std::filesystem::path& socket_path)
+    : m_textfile_path(textfile_path), m_socket_path(socket_path) {
+    if (!m_socket_path.empty()){
+        sockaddr_un address{};
+        address.sun_family = AF_UNIX;
+        std::string path = m_socket_path.string();
+        if (path.size() >= sizeof(address.sun_path)){
+            std::cerr << "Error: metrics socket path is too long: " << path << '\n';
+            Helper::quit(10);
+        }
+        std::strcpy(address.sun_path, path.c_str());
+
+        // A socket left over from an earlier run would make bind() fail
+        ::unlink(path.c_str());
+
+        m_listen_fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (m_listen_fd < 0 || ::bind(m_listen_fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0
+            || ::listen(m_listen_fd, 16) < 0 || ::pipe(m_wake_pipe) < 0){
+            std::cerr << "Error: couldn't set up metrics socket " << path << ": " << std::strerror(errno) << '\n';
+            Helper::quit(10);
+        }
+        m_socket_thread = std::thread(&MetricsExporter::socketLoop, this);
+    }
+
+    if (!m_textfile_path.empty())
+        m_textfile_thread = std::thread(&MetricsExporter::textfileLoop, this);
+}
+
+MetricsExporter::~MetricsExporter(){
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+    m_stop_requested.notify_all();
+    if (m_textfile_thread.joinable())
+        m_textfile_thread.join(); // Writes the final snapshot on its way out
+
+    if (m_socket_thread.joinable()){
+        char wake = 0;
+        (void)!::write(m_wake_pipe[1], &wake, 1);
+        m_socket_thread.join();
+    }
+    if (m_listen_fd >= 0){
+        ::close(m_listen_fd);
+        ::close(m_wake_pipe[0]);
+        ::close(m_wake_pipe[1]);
+        ::unlink(m_socket_path.c_str());
+    }
+}
+
+// Textfile:
+
+void MetricsExporter::writeTextfile(){
+    // Write next to the real file so the rename stays on the same filesystem (and is atomic)
+    std::filesystem::path temporary_path = m_textfile_path;
+    temporary_path += ".tmp";
+    {
+        std::ofstream file(temporary_path, std::ios::trunc);
+        file << Metrics::getPrometheusText();
+        if (!file)
+            return; // Try again next time
+    }
+
+    std::error_code error;
+    std::filesystem::rename(temporary_path, m_textfile_path, error);
+}
+
+void MetricsExporter::textfileLoop(){
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (true){
+        lock.unlock();
+        writeTextfile();
+        lock.lock();
+
+        if (m_stopping)
+            return;
+        m_stop_requested.wait_for(lock, std::chrono::milliseconds(WRITE_INTERVAL), [this] { return m_stopping; });
+    }
+}
+
+// Unix socket:
+
+void MetricsExporter::socketLoop(){
+    pollfd fds[2] = {{m_listen_fd, POLLIN, 0}, {m_wake_pipe[0], POLLIN, 0}};
+    while (true){
+        if (::poll(fds, 2, -1) < 0){
+            if (errno == EINTR)
+                continue;
+            return;
+        }
+        if (fds[1].revents)
+            return; // Exporter is stopping
+
+        if (fds[0].revents & POLLIN){
+            int client_fd = ::accept4(m_listen_fd, nullptr, nullptr, SOCK_CLOEXEC);
+            if (client_fd >= 0){
+                serveClient(client_fd);
+                ::close(client_fd);
+            }
+        }
+    }
+}
+
+void MetricsExporter::serveClient(int client_fd){
+    // Plain clients (like socat) may not send anything, so only wait a moment for a request
+    char request[512];
+    ssize_t request_size = 0;
+    pollfd client_poll{client_fd, POLLIN, 0};
+    if (::poll(&client_poll, 1, CLIENT_TIMEOUT) > 0)
+        request_size = ::read(client_fd, request, sizeof(request));
+
+    std::string body = Metrics::getPrometheusText();
+    std::string response;
+    if (request_size >= 4 && std::strncmp(request, "GET ", 4) == 0){
+        response = "HTTP/1.0 200 OK\r\nContent-Type: text/plain; version=0.0.4\r\nContent-Length: " + std::to_string(body.size()) + "\r\n\r\n";
+    }
+    response += body;
+
+    // Send everything, but give up on clients that go away
+    const char* data = response.data();
+    size_t left = response.size();
+    while (left > 0){
+        ssize_t sent = ::send(client_fd, data, left, MSG_NOSIGNAL);
+        if (sent <= 0)
+            return;
+        data += sent;
+        left -= sent;
+    }
+}
@@ -0,0 +1,59 @@
+#ifndef METRICSEXPORTER_H
+#define METRICSEXPORTER_H
+
+#include "Metrics.h"
+
+#include <filesystem>
+#include <thread>
+#include <condition_variable>
+#include <atomic>
+
+/*
+Serves the metrics snapshot (see Metrics) to a local scraper, without ever writing to stdout
+- Textfile: the snapshot is written to a file every WRITE_INTERVAL milliseconds (and once more when the exporter stops), for the node_exporter
+  textfile collector. It's written to a temporary file first and renamed into place, so the collector never sees a half-written file
+- Unix socket: every connection to the socket gets the snapshot and is then closed. Clients that send an HTTP GET get an HTTP response,
+  so Prometheus-style scrapers can read it as-is
+- Each output runs on its own background thread, so the simulation thread never waits on disk or on a slow client
+*/
+class MetricsExporter {
+    public:
+    static constexpr int WRITE_INTERVAL = 1000; // Time between textfile writes (in milliseconds)
+    static constexpr int CLIENT_TIMEOUT = 200; // How long to wait for a socket client to send its request (in milliseconds)
+
+    private:
+    std::filesystem::path m_textfile_path;
+    std::filesystem::path m_socket_path;
+    int m_listen_fd{-1};
+    int m_wake_pipe[2]{-1, -1}; // Writing to m_wake_pipe[1] wakes up the socket thread so it can stop
+
+    std::mutex m_mutex;
+    std::condition_variable m_stop_requested;
+    bool m_stopping{false}; // Protected by m_mutex
+
+    std::thread m_textfile_thread;
+    std::thread m_socket_thread;
+
+    // Private methods:
+    void writeTextfile();
+    void textfileLoop();
+    void socketLoop();
+    void serveClient(int client_fd);
+
+    public:
+    /*
+    - Start exporting to textfile_path and/or socket_path (an empty path means that output is turned off)
+    - Quits (error 10) if the socket can't be set up
+    */
+    MetricsExporter(const std::filesystem::path& textfile_path, const std::filesystem::path& socket_path);
+
+    /*
+    - Write the textfile one last time, then stop every background thread and remove the socket
+    */
+    ~MetricsExporter();
+
+    MetricsExporter(const MetricsExporter&) = delete;
+    MetricsExporter& operator=(const MetricsExporter&) = delete;
+};
+
+#endif
@@ -1,6 +1,8 @@
 #include "Organism.h"
 
-int Organism::m_id_counter {0}; // This will be used for making unique IDs for each organism
+#include <charconv>
+
+std::atomic<int> Organism::m_id_counter {0}; // This will be used for making unique IDs for each organism
 
 std::unordered_map<Organism::OrganismType, std::vector<int>> Organism::m_colorMap = {
     {Organism::PlantEnum, {2, 10, 35, 40, 70, 83, 119}},        // Plants will be some shade of green
@@ -23,7 +25,7 @@ const std::unordered_map<Organism::OrganismType, std::vector<Organism::OrganismT
 };
 
 Organism::Organism(char letter_id, OrganismType type, int health, const std::tuple<int, int>& coords)
-    : m_id(m_id_counter++), m_letter_id(letter_id), m_type(type), m_coords(coords) {
+    : m_id(m_id_counter++), m_coords(coords), m_type(type), m_letter_id(letter_id) {
     // Initialize organism health
     setHealth(health);
 
@@ -31,6 +33,14 @@ Organism::Organism(char letter_id, OrganismType type, int health, const std::tup
     setColor();
 }
 
+void* Organism::operator new(std::size_t size){
+    return OrganismArena::allocate(size);
+}
+
+void Organism::operator delete(void* ptr, std::size_t size){
+    OrganismArena::deallocate(ptr, size);
+}
+
 // Setters & Getters
 
 int Organism::getID() const{
@@ -66,35 +76,77 @@ bool Organism::isAlive() const{
     return m_alive;
 }
 
-std::vector<Organism::OrganismType> Organism::getPredators() const {
+std::uint64_t Organism::getHashContribution() const{
+    return getHashContribution(m_letter_id, m_type, m_coords, m_current_health, m_alive);
+}
+
+std::uint64_t Organism::getHashContribution(char letter_id, OrganismType type, const std::tuple<int, int>& coords, int current_health, bool alive){
+    if (!alive && type != PlantEnum)
+        return 0;
+
+    // splitmix64 finalizer, used to turn organism state into a well-mixed 64-bit key
+    auto mix = [](std::uint64_t z) {
+        z += 0x9E3779B97F4A7C15ull;
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+        return z ^ (z >> 31);
+    };
+
+    std::uint64_t location = (static_cast<std::uint64_t>(static_cast<std::uint32_t>(std::get<0>(coords))) << 32) | static_cast<std::uint32_t>(std::get<1>(coords));
+    std::uint64_t state = (static_cast<std::uint64_t>(static_cast<unsigned char>(letter_id)) << 40) | (static_cast<std::uint64_t>(static_cast<std::uint32_t>(current_health)) << 1) | (alive ? 1 : 0);
+    return mix(mix(location) ^ state);
+}
+
+void Organism::WorldHash::addLiving(char letter_id, OrganismType type, int count){
+    live_counts[static_cast<unsigned char>(letter_id)].fetch_add(count, std::memory_order_relaxed);
+    live_types[type].fetch_add(count, std::memory_order_relaxed);
+}
+
+void Organism::WorldHash::clear(){
+    hash.store(0, std::memory_order_relaxed);
+    for (std::atomic<int>& count : live_counts)
+        count.store(0, std::memory_order_relaxed);
+    for (std::atomic<int>& count : live_types)
+        count.store(0, std::memory_order_relaxed);
+}
+
+void Organism::updateWorldHash(std::uint64_t old_hash_contribution, WorldHash& world_hash) const{
+    world_hash.hash.fetch_xor(old_hash_contribution ^ getHashContribution(), std::memory_order_relaxed);
+}
+
+const std::vector<Organism::OrganismType>& Organism::getPredators() const {
+    static const std::vector<Organism::OrganismType> NO_TYPES;
+
     // Find the entry for this organism's type in the predators map
     auto it = m_PREDATORS_MAP.find(m_type);
     if (it != m_PREDATORS_MAP.end()) {
         return it->second; // Return the vector of predators for this organism's type
     }
     else {
-        return {}; // If the organism's type is not found in the map, return an empty vector
+        return NO_TYPES; // If the organism's type is not found in the map, return an empty vector
     }
 }
 
-std::vector<Organism::OrganismType> Organism::getPrey() const {
+const std::vector<Organism::OrganismType>& Organism::getPrey() const {
+    static const std::vector<Organism::OrganismType> NO_TYPES;
+
     // Find the entry for this organism's type in the prey map
     auto it = m_PREY_MAP.find(m_type);
     if (it != m_PREY_MAP.end()) {
         return it->second; // Return the vector of prey for this organism's type
     }
     else {
-        return {}; // If the organism's type is not found in the map, return an empty vector
+        return NO_TYPES; // If the organism's type is not found in the map, return an empty vector
     }
 }
 
 void Organism::setColor() {
-    if (m_colorMap.find(m_type) != m_colorMap.end() && !m_colorMap[m_type].empty()) {
-        std::random_device rd;
-        std::mt19937 gen(rd());
-        std::uniform_int_distribution<> dis(0, m_colorMap[m_type].size() - 1);
-        int index = dis(gen);
-        m_color = m_colorMap[m_type][index];
+    // Only read the map (no operator[]), since organisms can be made on several threads at once
+    auto colors = m_colorMap.find(m_type);
+    if (colors != m_colorMap.end() && !colors->second.empty()) {
+        std::uniform_int_distribution<> dis(0, colors->second.size() - 1);
+        int index = dis(Helper::getRandomEngine());
+        m_color = colors->second[index];
     } else {
         std::cerr << "Color vector for OrganismType not initialized or empty.\n";
     }
@@ -106,37 +158,45 @@ int Organism::getColor() const{
 
 // Methods
 
-void Organism::die(){
+void Organism::die(WorldHash& world_hash){
+    std::uint64_t old_hash_contribution = getHashContribution();
+    if (m_alive)
+        world_hash.addLiving(m_letter_id, m_type, -1);
     m_current_health = 0;
     m_alive = false;
+    updateWorldHash(old_hash_contribution, world_hash);
 }
 
-void Organism::addHealth(int heal_amount){
-    m_current_health += heal_amount;
-    if (m_current_health > m_max_health)
-        m_current_health = m_max_health;
+void Organism::addHealth(int heal_amount, WorldHash& world_hash){
+    std::uint64_t old_hash_contribution = getHashContribution();
+    // Added up in 64 bits, so a big heal or hit can't overflow before it's clamped (anything at or below 0 dies right after anyway)
+    m_current_health = std::clamp(static_cast<std::int64_t>(m_current_health) + heal_amount, static_cast<std::int64_t>(MIN_HEALTH), static_cast<std::int64_t>(m_max_health));
+    updateWorldHash(old_hash_contribution, world_hash);
     
     if (m_current_health <= 0)
-        this->die();
+        this->die(world_hash);
 }
 
 bool Organism::isPredatorTo(const Organism* const org) const{
-    std::vector<Organism::OrganismType> org_predators = org->getPredators();
+    return isPredatorTo(org->getType());
+}
 
-    // Check if org has no predators
-    if (org_predators.empty())
+bool Organism::isPredatorTo(OrganismType type) const{
+    // Check if organisms of this type have no predators
+    auto it = m_PREDATORS_MAP.find(type);
+    if (it == m_PREDATORS_MAP.end())
         return false;
     
-    // Check each and every predator of org and see if this is a predator
-    for (Organism::OrganismType org_type : org_predators){
-        if (m_type == org_type)
+    // Check each and every predator of this type and see if this is a predator
+    for (Organism::OrganismType predator_type : it->second){
+        if (m_type == predator_type)
             return true;
     }
     return false;
 }
 
 bool Organism::isPreyTo(const Organism* const org) const{
-    std::vector<Organism::OrganismType> org_prey = org->getPrey();
+    const std::vector<Organism::OrganismType>& org_prey = org->getPrey();
 
     // Check if org has no prey
     if (org_prey.empty())
@@ -151,11 +211,21 @@ bool Organism::isPreyTo(const Organism* const org) const{
 }
 
 std::string Organism::getLetterIDColored() const{
-    std::stringstream ss;
-    ss << "\033[38;5;" << m_color << "m";
-    ss << getLetterID();
-    ss << "\033[0m";
-    return ss.str();
+    std::string colored_ID;
+    appendLetterIDColored(colored_ID);
+    return colored_ID;
+}
+
+void Organism::appendLetterIDColored(std::string& out) const{
+    // Write color code digits into a small buffer on the stack rather than going through a stringstream
+    char color_digits[12];
+    char* color_digits_end = std::to_chars(std::begin(color_digits), std::end(color_digits), m_color).ptr;
+
+    out += "\033[38;5;";
+    out.append(color_digits, color_digits_end);
+    out += 'm';
+    out += getLetterID();
+    out += "\033[0m";
 }
 
 int Organism::getCommonCoordinate(const Organism* const org) const{
@@ -2,45 +2,103 @@
 #define ORGANISM_H
 
 #include "Helper.h"
+#include "OrganismArena.h"
 
 #include <vector>
 #include <tuple>
 #include <random>
 #include <unordered_map>
 #include <sstream>
+#include <cstdint>
+#include <atomic>
+
+class FreeMaskGrid;
+
+/*
+Generation-checked reference to an organism stored in an OrganismPool
+- index is the organism's slot in the pool, generation is bumped every time that slot is reused
+- A handle to an organism that has since been erased will not match its slot's generation anymore, so it can be detected as stale
+*/
+struct OrganismHandle{
+    std::uint32_t index{UINT32_MAX};
+    std::uint32_t generation{0};
+
+    bool operator==(const OrganismHandle& other) const { return index == other.index && generation == other.generation; }
+    bool operator!=(const OrganismHandle& other) const { return !(*this == other); }
+};
 
+/*
+Base class of every plant and animal
+- Fields are ordered widest first and kept as narrow as their values allow (the pool slot is stored instead of the whole handle, and type,
+  letter ID, color and alive are 1 byte each), so there's no padding between them and Plant's and Animal's own field fits in what would
+  otherwise be padding at the end (40 bytes each)
+- Organisms don't point to the world hash of their pool. Methods that change them take it as a parameter (see WorldHash)
+*/
 class Organism{
     public:
-    enum OrganismType{
+    enum OrganismType : std::uint8_t{
         PlantEnum = 0,
         HerbivoreEnum = 1,
         OmnivoreEnum = 2,
         COUNT
     };
-    
+
+    // What's kept up to date about a whole world as its organisms change: the XOR of the hash contributions of every organism (see
+    // getHashContribution()), and how many organisms are alive. The pool owns it, and anything that changes an organism gets it from the
+    // pool (OrganismPool::getWorldHashState()) and passes it in, so organisms don't each need a pointer to it
+    struct WorldHash {
+        std::atomic<std::uint64_t> hash{0};
+        std::atomic<int> live_counts[256]{}; // Living organisms of each letter ID (indexed by unsigned char)
+        std::atomic<int> live_types[COUNT]{}; // Living organisms of each type
+
+        void addLiving(char letter_id, OrganismType type, int count); // count organisms came to life (or died, if it's negative)
+        void clear();
+    };
+
+    // Health (and regrowth coefficient) is stored in 32 bits, so any health a species file can give fits
+    using Health = std::int32_t;
+    static constexpr int MIN_HEALTH = INT32_MIN;
+    static constexpr int MAX_HEALTH = INT32_MAX;
+
     private:
-    OrganismType m_type{};
-    static int m_id_counter; // Used to come up with a unique ID for every organism created
-    int m_id{}; // Unique ID
-    char m_letter_id{}; // Letter ID. Multiple organisms can have the same letter ID
-    int m_color; // Unique ANSI Escape color code for organism
+    static std::atomic<int> m_id_counter; // Used to come up with a unique ID for every organism created (organisms can be made on several threads at once)
     static std::unordered_map<OrganismType, std::vector<int>> m_colorMap; // Used for setting colors for each organism type
     static const std::unordered_map<OrganismType, std::vector<OrganismType>> m_PREDATORS_MAP; // Map that's like: {organism type (plant/herbivore/omnivore etc) : list of other organism types that are a predator to key organism}
     static const std::unordered_map<OrganismType, std::vector<OrganismType>> m_PREY_MAP; // Map that's like: {organism type (plant/herbivore/omnivore etc) : list of other organism types that are prey to key organism}
-    
+    std::uint32_t m_slot_index{UINT32_MAX}; // Slot of this organism in the pool that owns it. This is set by OrganismPool, which has the generation (see OrganismPool::getHandle())
+    int m_id{}; // Unique ID
+
+    protected:
+    Health m_max_health{};
+    Health m_current_health{};
+    std::tuple<int, int> m_coords;
+
+    private:
+    OrganismType m_type{};
+    char m_letter_id{}; // Letter ID. Multiple organisms can have the same letter ID
+    std::uint8_t m_color{}; // ANSI 256-color code for organism (every code in m_colorMap fits in a byte)
+
     // Private methods:
     void setHealth(int health); // Set both max health & current health to health. This is currently only used in the constructor
     void setColor(); // Set m_color to some random value from m_colorMap
 
     protected:
     bool m_alive{true};
-    int m_max_health{};
-    int m_current_health{};
-    std::tuple<int, int> m_coords;
+
+    /*
+    - Call this after changing coordinates/health/alive with the hash contribution from before the change, so world_hash stays up to date
+    */
+    void updateWorldHash(std::uint64_t old_hash_contribution, WorldHash& world_hash) const;
 
     public:
     Organism(char letter_id, OrganismType type, int health, const std::tuple<int, int>& coords);
 
+    virtual ~Organism() = default;
+
+    // Organisms get their memory from OrganismArena, so threads that make lots of worlds can reuse it
+    static void* operator new(std::size_t size);
+    static void operator delete(void* ptr, std::size_t size);
+
     // Setters & Getters:
 
     int getID() const;
@@ -55,27 +113,44 @@ class Organism{
 
     int getCurrentHealth() const;
 
-    std::vector<Organism::OrganismType> getPredators() const;
+    const std::vector<Organism::OrganismType>& getPredators() const;
 
-    std::vector<Organism::OrganismType> getPrey() const;
+    const std::vector<Organism::OrganismType>& getPrey() const;
 
     int getColor() const;
 
     bool isAlive() const;
 
+    /*
+    - This organism's part of the world hash. The world hash is the XOR of every organism's contribution (Zobrist hashing)
+    - Depends on letter ID, coordinates, current health and whether the organism is alive. Dead animals contribute 0 since they're about to be cleaned up
+    */
+    std::uint64_t getHashContribution() const;
+
+    /*
+    - Hash contribution of an organism in the given state. Used for organisms that aren't stored as Organism objects (see PlantLayer)
+    */
+    static std::uint64_t getHashContribution(char letter_id, OrganismType type, const std::tuple<int, int>& coords, int current_health, bool alive);
+
     // Methods:
 
     /*
     - Set current health to 0
     - Set alive to false
+    - world_hash is the hash of the world this organism is in (see WorldHash). Every method that changes an organism takes it
     */
-    void die();
+    void die(WorldHash& world_hash);
 
     /*
     - See if this is a predator to org
     */
     bool isPredatorTo(const Organism* const org) const;
 
+    /*
+    - See if this is a predator to organisms of type type
+    */
+    bool isPredatorTo(OrganismType type) const;
+
     /*
     - See if this is a prey to org
     */
@@ -85,13 +160,19 @@ class Organism{
     - current health += heal amount
     - heal amount can be negative to reduce health of organism
     */
-    void addHealth(int heal_amount);
+    void addHealth(int heal_amount, WorldHash& world_hash);
 
     /*
     - Get a string containing the organism's letter ID in its corresponding oclor
     */
     std::string getLetterIDColored() const;
 
+    /*
+    - Same as getLetterIDColored(), but appends the colored letter ID to out instead of making a new string
+    - This doesn't allocate as long as out already has enough capacity
+    */
+    void appendLetterIDColored(std::string& out) const;
+
     /*
     - See if this and parameter org have any coordiantes in common.
     - Ex: if this is located at (3, 5) and parameter org is located at (2, 5), the common coordinate is the y-coordinate
@@ -108,8 +189,12 @@ class Organism{
     /*
     - Given a vector of all organisms in the simulation as well as the map dimensions, update this organism.
     - Since plants and animals have different behaviors and need to be updated differently, this is a virtual method that will be overridden.
+    - free_masks has to match organisms' living organisms (see FreeMaskGrid). Organisms keep it up to date as they move, die and revive
     */
-    virtual void update(const std::vector<Organism*>& organisms, const std::tuple<int, int>& map_dimensions) = 0;
+    virtual void update(const std::vector<Organism*>& organisms, const std::tuple<int, int>& map_dimensions, WorldHash& world_hash, FreeMaskGrid& free_masks) = 0;
+
+    friend class OrganismPool;
+    friend class ProcessEngine;
 };
 
 #endif
\ No newline at end of file
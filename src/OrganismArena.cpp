@@ -0,0 +1,84 @@
+#include "OrganismArena.h"
+
+#include <algorithm>
+#include <new>
+#include <utility>
+
+/*
+- Kept blocks, grouped by size. There are only a couple of organism classes, so a short list beats a hash map
+*/
+struct ThreadArena {
+    bool enabled{false};
+    long long reused{0};
+    std::vector<std::pair<std::size_t, std::vector<void*>>> kept;
+
+    std::vector<void*>& getKept(std::size_t size){
+        for (auto& sized : kept){
+            if (sized.first == size)
+                return sized.second;
+        }
+        kept.push_back({size, {}});
+        return kept.back().second;
+    }
+
+    void release(){
+        for (auto& sized : kept){
+            for (void* ptr : sized.second)
+                ::operator delete(ptr);
+        }
+        kept.clear();
+    }
+
+    ~ThreadArena(){
+        release();
+    }
+};
+
+static thread_local ThreadArena arena;
+
+void* OrganismArena::allocate(std::size_t size){
+    if (arena.enabled){
+        std::vector<void*>& kept = arena.getKept(size);
+        if (!kept.empty()){
+            void* ptr = kept.back();
+            kept.pop_back();
+            arena.reused++;
+            return ptr;
+        }
+    }
+    return ::operator new(size);
+}
+
+void OrganismArena::deallocate(void* ptr, std::size_t size){
+    if (!ptr)
+        return;
+    if (arena.enabled)
+        arena.getKept(size).push_back(ptr);
+    else
+        ::operator delete(ptr);
+}
+
+void OrganismArena::enable(){
+    arena.enabled = true;
+    arena.reused = 0;
+}
+
+void OrganismArena::disable(){
+    arena.enabled = false;
+    arena.release();
+}
+
+long long OrganismArena::getReusedCount(){
+    return arena.reused;
+}
+
+std::size_t OrganismArena::getKeptCount(){
+    std::size_t count = 0;
+    for (const auto& sized : arena.kept)
+        count += sized.second.size();
+    return count;
+}
+
+std::size_t OrganismArena::getBlockSize(std::size_t size){
+    return std::max<std::size_t>(32, (size + sizeof(std::size_t) + 15) & ~static_cast<std::size_t>(15));
+}
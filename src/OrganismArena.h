@@ -0,0 +1,47 @@
+#ifndef ORGANISMARENA_H
+#define ORGANISMARENA_H
+
+#include <vector>
+#include <cstddef>
+
+/*
+Per-thread recycling of the memory organisms live in
+- Every Organism is allocated through here (Organism has its own operator new/delete)
+- By default this just calls the global operator new/delete, so nothing changes for programs that don't use it
+- A thread that calls enable() keeps freed organisms' memory and hands it back out to the next organisms of the same size. A thread that runs
+  many worlds one after another (see JobService) then stops going to the heap once it has warmed up
+- Memory freed on one thread can be reused by another. Every block is a plain global operator new block, so it can always be freed normally
+*/
+class OrganismArena {
+    public:
+    static void* allocate(std::size_t size);
+    static void deallocate(void* ptr, std::size_t size);
+
+    /*
+    - Start keeping freed organism memory on this thread
+    */
+    static void enable();
+
+    /*
+    - Stop keeping freed organism memory on this thread and free everything that was kept
+    */
+    static void disable();
+
+    /*
+    - How many allocations on this thread were served from kept memory since enable()
+    */
+    static long long getReusedCount();
+
+    /*
+    - How many blocks this thread is keeping right now
+    */
+    static std::size_t getKeptCount();
+
+    /*
+    - Estimated heap memory behind one block of size bytes, counting malloc's header and rounding (glibc: 8-byte header, multiples of 16,
+      at least 32 bytes)
+    */
+    static std::size_t getBlockSize(std::size_t size);
+};
+
+#endif
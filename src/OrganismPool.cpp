@@ -0,0 +1,168 @@
+#include "OrganismPool.h"
+
+OrganismPool::OrganismPool(std::uint32_t max_generation) : m_max_generation(max_generation){
+    m_plant_layer.m_world_hash = &m_world_hash;
+}
+
+OrganismPool::~OrganismPool(){
+    clear();
+}
+
+// Private methods:
+
+void OrganismPool::retireSlot(std::uint32_t slot_index){
+    m_change_count++;
+    m_slots[slot_index].generation++;
+    if (m_slots[slot_index].generation < m_max_generation)
+        m_free_slots.push_back(slot_index);
+}
+
+// Setters & Getters:
+
+const std::vector<Organism*>& OrganismPool::getOrganisms() const{
+    return m_organisms;
+}
+
+int OrganismPool::size() const{
+    return m_organisms.size();
+}
+
+bool OrganismPool::empty() const{
+    return m_organisms.empty();
+}
+
+Organism* OrganismPool::get(const OrganismHandle& handle) const{
+    if (!contains(handle))
+        return nullptr;
+
+    return m_organisms[m_slots[handle.index].dense_index];
+}
+
+OrganismHandle OrganismPool::getHandle(const Organism* org) const{
+    return {org->m_slot_index, m_slots[org->m_slot_index].generation};
+}
+
+int OrganismPool::getIndex(const Organism* org) const{
+    return m_slots[org->m_slot_index].dense_index;
+}
+
+bool OrganismPool::contains(const OrganismHandle& handle) const{
+    return handle.index < m_slots.size() && m_slots[handle.index].generation == handle.generation;
+}
+
+std::uint64_t OrganismPool::getWorldHash() const{
+    return m_world_hash.hash.load(std::memory_order_relaxed);
+}
+
+Organism::WorldHash& OrganismPool::getWorldHashState(){
+    return m_world_hash;
+}
+
+int OrganismPool::getLiveCount(char letter_id) const{
+    return m_world_hash.live_counts[static_cast<unsigned char>(letter_id)].load(std::memory_order_relaxed);
+}
+
+int OrganismPool::getLiveCount(Organism::OrganismType type) const{
+    return m_world_hash.live_types[type].load(std::memory_order_relaxed);
+}
+
+std::uint64_t OrganismPool::getChangeCount() const{
+    return m_change_count;
+}
+
+PlantLayer& OrganismPool::getPlantLayer(){
+    return m_plant_layer;
+}
+
+const PlantLayer& OrganismPool::getPlantLayer() const{
+    return m_plant_layer;
+}
+
+std::size_t OrganismPool::getIndexMemoryUsage() const{
+    return (m_organisms.capacity() * sizeof(Organism*)) + (m_dense_to_slot.capacity() * sizeof(std::uint32_t)) + (m_slots.capacity() * sizeof(Slot))
+        + (m_free_slots.capacity() * sizeof(std::uint32_t));
+}
+
+// Methods:
+
+OrganismHandle OrganismPool::insert(Organism* org){
+    // Reuse a free slot if there is one, otherwise make a new slot
+    std::uint32_t slot_index;
+    if (!m_free_slots.empty()){
+        slot_index = m_free_slots.back();
+        m_free_slots.pop_back();
+    }
+    else{
+        slot_index = m_slots.size();
+        m_slots.push_back({});
+
+        // Every slot can end up on the free list, so make room for that now instead of while erasing
+        m_free_slots.reserve(m_slots.capacity());
+    }
+
+    // Add organism to the end of the dense list
+    m_slots[slot_index].dense_index = m_organisms.size();
+    m_organisms.push_back(org);
+    m_dense_to_slot.push_back(slot_index);
+
+    m_change_count++;
+    org->m_slot_index = slot_index;
+    m_world_hash.hash.fetch_xor(org->getHashContribution(), std::memory_order_relaxed);
+    if (org->isAlive())
+        m_world_hash.addLiving(org->getLetterID(), org->getType(), 1);
+    return {slot_index, m_slots[slot_index].generation};
+}
+
+bool OrganismPool::erase(const OrganismHandle& handle){
+    if (!contains(handle))
+        return false;
+
+    eraseAt(m_slots[handle.index].dense_index);
+    return true;
+}
+
+void OrganismPool::eraseAt(int dense_index){
+    std::uint32_t slot_index = m_dense_to_slot[dense_index];
+    Organism* org = m_organisms[dense_index];
+    m_world_hash.hash.fetch_xor(org->getHashContribution(), std::memory_order_relaxed);
+    if (org->isAlive())
+        m_world_hash.addLiving(org->getLetterID(), org->getType(), -1);
+    delete m_organisms[dense_index];
+
+    // Move last organism into the erased organism's place so the dense list has no holes
+    std::uint32_t last_index = m_organisms.size() - 1;
+    if (dense_index != last_index){
+        m_organisms[dense_index] = m_organisms[last_index];
+        m_dense_to_slot[dense_index] = m_dense_to_slot[last_index];
+        m_slots[m_dense_to_slot[dense_index]].dense_index = dense_index;
+    }
+    m_organisms.pop_back();
+    m_dense_to_slot.pop_back();
+
+    // Any handles to the erased organism are now stale
+    retireSlot(slot_index);
+}
+
+void OrganismPool::setOrder(const std::vector<Organism*>& new_order){
+    for (int i = 0; i < new_order.size(); i++){
+        std::uint32_t slot_index = new_order[i]->m_slot_index;
+        m_organisms[i] = new_order[i];
+        m_dense_to_slot[i] = slot_index;
+        m_slots[slot_index].dense_index = i;
+    }
+}
+
+void OrganismPool::clear(){
+    for (Organism* org : m_organisms)
+        delete org;
+
+    // Bump every generation so any handles that are still around become stale
+    for (std::uint32_t slot_index : m_dense_to_slot)
+        retireSlot(slot_index);
+
+    m_change_count++;
+    m_organisms.clear();
+    m_dense_to_slot.clear();
+    m_plant_layer.clear();
+    m_world_hash.clear();
+}
@@ -0,0 +1,202 @@
+#ifndef ORGANISMPOOL_H
+#define ORGANISMPOOL_H
+
+#include "Organism.h"
+#include "PlantLayer.h"
+
+#include <vector>
+#include <cstdint>
+#include <atomic>
+
+/*
+Slot map that owns every organism in the simulation
+- Organisms are stored densely (getOrganisms()) so iterating over them is just iterating over a vector
+- Every organism gets a generation-checked OrganismHandle, so code can hold on to an organism without risking a dangling pointer
+- Inserting and erasing are both O(1). Erasing one organism moves the last organism into its place. eraseIf() erases many at once and keeps
+  the rest in order, which matters to engines, since the order decides who eats and moves first
+- A slot is retired instead of reused once its generation reaches the pool's max generation, so a stale handle can never match a later organism
+- Plants can also be stored in a PlantLayer instead of as Organism objects (see getPlantLayer()). Those plants are part of the world hash too
+*/
+class OrganismPool {
+    struct Slot {
+        std::uint32_t dense_index{}; // Where this slot's organism is in m_organisms
+        std::uint32_t generation{}; // Bumped every time the organism in this slot is erased
+    };
+
+    std::vector<Organism*> m_organisms; // Dense list of organisms
+    std::vector<std::uint32_t> m_dense_to_slot; // m_dense_to_slot[i] is the slot of m_organisms[i]
+    std::vector<Slot> m_slots;
+    std::vector<std::uint32_t> m_free_slots; // Slots that can be reused by the next insert
+
+    std::uint32_t m_max_generation; // Slots whose generation reaches this are retired (see retireSlot())
+
+    std::uint64_t m_change_count{0}; // Bumped by every insert and erase (see getChangeCount())
+
+    Organism::WorldHash m_world_hash; // World hash and live counts of every organism. Whatever changes an organism passes this in (see getWorldHashState())
+
+    PlantLayer m_plant_layer; // Plants that aren't stored as Organism objects. Empty unless something puts plants in it
+
+    // Private methods:
+
+    /*
+    - Bump the generation of a slot whose organism was erased, so handles to it become stale, and put the slot on the free list unless its
+      generation ran out
+    */
+    void retireSlot(std::uint32_t slot_index);
+
+    public:
+    /*
+    - max_generation is how many organisms a slot can hold before it's retired. Only checks need anything but the default (a small value
+      lets them reach it quickly)
+    */
+    explicit OrganismPool(std::uint32_t max_generation = UINT32_MAX);
+    ~OrganismPool();
+
+    // The pool owns its organisms, so it can't be copied
+    OrganismPool(const OrganismPool&) = delete;
+    OrganismPool& operator=(const OrganismPool&) = delete;
+
+    // Setters & Getters:
+
+    /*
+    - Dense list of every organism in the pool, in the order they were inserted
+    - eraseIf() keeps this order, eraseAt() and erase() don't (see eraseAt())
+    */
+    const std::vector<Organism*>& getOrganisms() const;
+
+    int size() const;
+
+    bool empty() const;
+
+    /*
+    - Get the organism that handle refers to
+    - Returns nullptr if the handle is stale (its organism was erased) or was never valid
+    */
+    Organism* get(const OrganismHandle& handle) const;
+
+    /*
+    - Handle of org, which has to be in this pool
+    - Organisms only store their slot, so the generation comes from the pool
+    */
+    OrganismHandle getHandle(const Organism* org) const;
+
+    /*
+    - Position of org in getOrganisms(), which it has to be in. This changes whenever organisms before it are erased or re-sorted
+    */
+    int getIndex(const Organism* org) const;
+
+    /*
+    - See if handle still refers to an organism in the pool
+    */
+    bool contains(const OrganismHandle& handle) const;
+
+    /*
+    - Zobrist-style hash of every organism in the pool (see Organism::getHashContribution())
+    - This is updated incrementally whenever an organism moves, eats, dies, revives, or changes health, so getting it is O(1)
+    - Two pools with the same organisms in the same state have the same hash, no matter what order the organisms are in
+    */
+    std::uint64_t getWorldHash() const;
+
+    /*
+    - The world hash itself, to pass to methods that change organisms in this pool (Organism::die(), Animal::moveTo() etc.), so it stays
+      up to date. Organisms don't keep a pointer to it, which keeps them at 40 bytes
+    */
+    Organism::WorldHash& getWorldHashState();
+
+    /*
+    - Living organisms (in the pool and the plant layer) with letter_id, or of type. These are kept up to date along with the world hash,
+      so getting them is O(1)
+    */
+    int getLiveCount(char letter_id) const;
+    int getLiveCount(Organism::OrganismType type) const;
+
+    /*
+    - Number of times an organism has been inserted into or erased from the pool
+    - Code that keeps its own list of the pool's organisms (see LayeredEngine) can compare this with the count it last saw to tell whether
+      something else changed the pool in the meantime
+    */
+    std::uint64_t getChangeCount() const;
+
+    /*
+    - Plants stored in a dense per-cell layer instead of as Organism objects
+    - Only engines that know about the layer (see LayeredEngine) update these plants
+    */
+    PlantLayer& getPlantLayer();
+    const PlantLayer& getPlantLayer() const;
+
+    /*
+    - Memory used by the pool's own bookkeeping (in bytes): the dense list and slots, but not the organisms or the plant layer
+    */
+    std::size_t getIndexMemoryUsage() const;
+
+    // Methods:
+
+    /*
+    - Take ownership of org and return its handle
+    - This can invalidate iterators over getOrganisms(), so don't call it while iterating
+    */
+    OrganismHandle insert(Organism* org);
+
+    /*
+    - Delete the organism that handle refers to
+    - Returns false if handle was stale
+    */
+    bool erase(const OrganismHandle& handle);
+
+    /*
+    - Delete the organism at position dense_index of getOrganisms()
+    - The last organism gets moved into dense_index, so loops that erase while iterating should go from back to front. Use this only
+      where the order of the pool doesn't matter
+    */
+    void eraseAt(int dense_index);
+
+    /*
+    - Delete every organism should_erase(org) returns true for, in one pass that keeps the rest in the same order
+    - Returns how many organisms were erased
+    */
+    template <typename Predicate>
+    int eraseIf(Predicate should_erase);
+
+    /*
+    - Given a new order for the organisms in the pool, replace the current order with it
+    - new_order must contain exactly the organisms that are in the pool (just in a different order)
+    */
+    void setOrder(const std::vector<Organism*>& new_order);
+
+    /*
+    - Delete every organism in the pool, and every plant in the plant layer
+    */
+    void clear();
+};
+
+template <typename Predicate>
+int OrganismPool::eraseIf(Predicate should_erase){
+    // Slide every organism that stays down over the erased ones, fixing up the slot of each one that moved
+    std::uint32_t kept = 0;
+    for (std::uint32_t i = 0; i < m_organisms.size(); i++){
+        Organism* org = m_organisms[i];
+        std::uint32_t slot_index = m_dense_to_slot[i];
+        if (should_erase(org)){
+            m_world_hash.hash.fetch_xor(org->getHashContribution(), std::memory_order_relaxed);
+            if (org->isAlive())
+                m_world_hash.addLiving(org->getLetterID(), org->getType(), -1);
+            delete org;
+            retireSlot(slot_index);
+            continue;
+        }
+
+        if (kept != i){
+            m_organisms[kept] = org;
+            m_dense_to_slot[kept] = slot_index;
+            m_slots[slot_index].dense_index = kept;
+        }
+        kept++;
+    }
+
+    int erased = m_organisms.size() - kept;
+    m_organisms.resize(kept);
+    m_dense_to_slot.resize(kept);
+    return erased;
+}
+
+#endif
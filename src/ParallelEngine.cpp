@@ -0,0 +1,94 @@
+#include "ParallelEngine.h"
+
+ParallelEngine::ParallelEngine(int thread_count, unsigned int seed)
+    : m_thread_pool(thread_count), m_seed(seed) {}
+
+int ParallelEngine::getThreadCount() const{
+    return m_thread_pool.getThreadCount();
+}
+
+std::string ParallelEngine::getName() const{
+    return "parallel:" + std::to_string(getThreadCount());
+}
+
+int ParallelEngine::getStripCount(int map_height){
+    return std::max(1, (map_height + STRIP_HEIGHT - 1) / STRIP_HEIGHT);
+}
+
+int ParallelEngine::getStrip(int y_coord, int strip_count){
+    int strip = y_coord / STRIP_HEIGHT;
+    return std::clamp(strip, 0, strip_count - 1);
+}
+
+unsigned int ParallelEngine::getStripSeed(unsigned int seed, long long iteration, int strip){
+    // splitmix64 finalizer
+    std::uint64_t z = (static_cast<std::uint64_t>(seed) << 32) ^ (static_cast<std::uint64_t>(iteration) << 20) ^ static_cast<std::uint64_t>(strip);
+    z += 0x9E3779B97F4A7C15ull;
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return static_cast<unsigned int>(z ^ (z >> 31));
+}
+
+void ParallelEngine::updateOrganisms(const std::vector<Organism*>& owned, const std::vector<Organism*>& nearby, const std::tuple<int, int>& map_dimensions,
+    Organism::WorldHash& world_hash, FreeMaskGrid& free_masks){
+    for (Organism* org : owned){
+        if (org->getType() == Organism::PlantEnum){
+            Plant* plant {dynamic_cast<Plant*>(org)};
+            plant->update(nearby, map_dimensions, world_hash, free_masks);
+        }
+        else{
+            Animal* animal {dynamic_cast<Animal*>(org)};
+            animal->update(nearby, map_dimensions, world_hash, free_masks);
+        }
+    }
+}
+
+void ParallelEngine::updateStrip(int strip, long long iteration, const std::tuple<int, int>& map_dimensions, Organism::WorldHash& world_hash){
+    Helper::setRandomSeed(getStripSeed(m_seed, iteration, strip));
+
+    // Organisms in this strip can only see organisms in this strip or right next to it, so that's all they need to look through
+    updateOrganisms(m_owned_organisms[strip], m_nearby_organisms[strip], map_dimensions, world_hash, m_free_masks);
+}
+
+void ParallelEngine::update(OrganismPool& organisms, const std::tuple<int, int>& map_dimensions, long long iteration){
+    checkVision(organisms);
+    int strip_count = getStripCount(std::get<1>(map_dimensions));
+    if (m_owned_organisms.size() < strip_count){
+        m_owned_organisms.resize(strip_count);
+        m_nearby_organisms.resize(strip_count);
+    }
+    if (!m_free_masks.isInSyncWith(organisms, map_dimensions))
+        m_free_masks.rebuild(organisms.getOrganisms(), map_dimensions);
+
+    // Sort organisms by ID so the update order doesn't depend on the order of the pool
+    m_sorted_organisms = organisms.getOrganisms();
+    std::sort(m_sorted_organisms.begin(), m_sorted_organisms.end(), [](const Organism* a, const Organism* b) { return a->getID() < b->getID(); });
+
+    // Each organism gets updated by the strip it's in right now, even if it moves into another strip before that strip is updated
+    for (int strip = 0; strip < strip_count; strip++)
+        m_owned_organisms[strip].clear();
+    for (Organism* org : m_sorted_organisms)
+        m_owned_organisms[getStrip(std::get<1>(org->getCoords()), strip_count)].push_back(org);
+
+    for (int phase = 0; phase < 2; phase++){
+        // Find nearby organisms for every strip in this phase. This has to be redone every phase since the last phase moved animals around
+        for (int strip = phase; strip < strip_count; strip += 2)
+            m_nearby_organisms[strip].clear();
+        for (Organism* org : m_sorted_organisms){
+            int y_coord = std::get<1>(org->getCoords());
+            int strip = getStrip(y_coord, strip_count);
+            if (strip % 2 == phase)
+                m_nearby_organisms[strip].push_back(org);
+            else if (y_coord % STRIP_HEIGHT == 0 && strip > 0) // First row of a strip is right below the strip above it
+                m_nearby_organisms[strip - 1].push_back(org);
+            else if (y_coord % STRIP_HEIGHT == STRIP_HEIGHT - 1 && strip + 1 < strip_count) // Last row of a strip is right above the strip below it
+                m_nearby_organisms[strip + 1].push_back(org);
+        }
+
+        int phase_strip_count = (strip_count - phase + 1) / 2;
+        m_thread_pool.run(phase_strip_count, [&](int i) { updateStrip(phase + (2 * i), iteration, map_dimensions, organisms.getWorldHashState()); });
+    }
+
+    Ecosystem::cleanUpEcosystem(organisms, iteration);
+    m_free_masks.markInSync(organisms);
+}
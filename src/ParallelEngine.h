@@ -0,0 +1,76 @@
+#ifndef PARALLELENGINE_H
+#define PARALLELENGINE_H
+
+#include "Engine.h"
+#include "ThreadPool.h"
+
+/*
+Engine that updates organisms on multiple threads
+- The map is cut into horizontal strips that are STRIP_HEIGHT rows tall. Each organism is owned by the strip it's in at the start of an iteration
+- An iteration has 2 phases: even strips get updated in parallel, then odd strips do. Strips that are updated at the same time are always
+  separated by a whole strip, so animals in them can never reach the same organisms
+- Organisms in a strip are updated in order of ID, and each strip re-seeds the random engine from (seed, iteration, strip).
+  This means results only depend on the seed, not on the number of threads
+- Strips share one FreeMaskGrid, kept across iterations like the reference engine's. Strips that are updated at the same time never change
+  the same cells of it
+- Note: since organisms are updated strip by strip rather than in the order of the pool, results are not the same as Ecosystem::updateEcosystem()
+- Animals don't use their vision radius here, so worlds where some animal has one are refused (see Engine::checkVision())
+*/
+class ParallelEngine : public Engine {
+    public:
+    static constexpr int STRIP_HEIGHT = 8; // Must be at least 4 so strips that are updated at the same time can't interact (see FreeMaskGrid)
+
+    private:
+    ThreadPool m_thread_pool;
+    unsigned int m_seed{};
+
+    // Buffers that are reused every iteration
+    std::vector<Organism*> m_sorted_organisms; // Every organism, sorted by ID
+    std::vector<std::vector<Organism*>> m_owned_organisms; // m_owned_organisms[s] = organisms that strip s updates this iteration
+    std::vector<std::vector<Organism*>> m_nearby_organisms; // m_nearby_organisms[s] = organisms in strip s plus the row right above and below it
+    FreeMaskGrid m_free_masks; // Kept across iterations, and only rebuilt if something else changed the pool since the last update()
+
+    // Private methods:
+    void updateStrip(int strip, long long iteration, const std::tuple<int, int>& map_dimensions, Organism::WorldHash& world_hash);
+
+    public:
+    /*
+    - Number of strips a map with the given height is cut into
+    */
+    static int getStripCount(int map_height);
+
+    /*
+    - Strip that row y_coord is in
+    */
+    static int getStrip(int y_coord, int strip_count);
+
+    /*
+    - Seed for one strip's random engine, mixed from the engine's seed, the iteration and the strip
+    */
+    static unsigned int getStripSeed(unsigned int seed, long long iteration, int strip);
+
+    /*
+    - Update owned organisms in order, letting them see nearby organisms. This is what every strip does once its random engine is seeded
+    - world_hash is the hash of the pool they're in (see OrganismPool::getWorldHashState()) and free_masks has to match them. Strips can
+      update both at the same time
+    */
+    static void updateOrganisms(const std::vector<Organism*>& owned, const std::vector<Organism*>& nearby, const std::tuple<int, int>& map_dimensions,
+        Organism::WorldHash& world_hash, FreeMaskGrid& free_masks);
+
+    /*
+    - thread_count is the number of threads used to update strips (including the thread calling update())
+    - seed is what every strip's random engine gets seeded from
+    */
+    ParallelEngine(int thread_count, unsigned int seed);
+
+    int getThreadCount() const;
+
+    std::string getName() const override;
+
+    /*
+    - Run 1 iteration of the simulation (same steps as Ecosystem::updateEcosystem(), but organisms get updated in parallel)
+    */
+    void update(OrganismPool& organisms, const std::tuple<int, int>& map_dimensions, long long iteration) override;
+};
+
+#endif
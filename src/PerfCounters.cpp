@@ -0,0 +1,276 @@
+#include "PerfCounters.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <iomanip>
+#include <sstream>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+int PerfCounters::m_fds[EVENT_COUNT] = {-1, -1, -1, -1, -1};
+int PerfCounters::m_group_index[EVENT_COUNT] = {};
+bool PerfCounters::m_available[EVENT_COUNT] = {};
+int PerfCounters::m_leader_fd = -1;
+int PerfCounters::m_open_events = 0;
+std::string PerfCounters::m_unavailable_reason;
+PerfCounters::Phase PerfCounters::m_phase = NoPhase;
+std::uint64_t PerfCounters::m_last_values[EVENT_COUNT] = {};
+std::uint64_t PerfCounters::m_last_enabled = 0;
+std::uint64_t PerfCounters::m_last_running = 0;
+PerfCounters::PhaseTotals PerfCounters::m_totals[PHASE_COUNT];
+std::uint64_t PerfCounters::m_read_count = 0;
+double PerfCounters::m_read_seconds = 0;
+std::chrono::steady_clock::time_point PerfCounters::m_start_time;
+double PerfCounters::m_counted_seconds = 0;
+thread_local bool PerfCounters::m_counting_thread = false;
+
+// Scope:
+
+PerfCounters::Scope::Scope(Phase phase, std::uint64_t organisms) : m_counting(isCounting()) {
+    if (m_counting)
+        m_previous_phase = switchPhase(phase, organisms);
+}
+
+PerfCounters::Scope::~Scope(){
+    if (m_counting && isCounting())
+        switchPhase(m_previous_phase);
+}
+
+// Setters & Getters:
+
+const char* PerfCounters::getPhaseName(Phase phase){
+    static const char* names[PHASE_COUNT] = {"plant update", "animal update", "organism update", "cleanup", "render"};
+    return phase < PHASE_COUNT ? names[phase] : "none";
+}
+
+const char* PerfCounters::getEventName(Event event){
+    static const char* names[EVENT_COUNT] = {"cycles", "instructions", "L1D misses", "LLC misses", "branch misses"};
+    return names[event];
+}
+
+bool PerfCounters::isCounting(){
+    return m_counting_thread;
+}
+
+bool PerfCounters::isAvailable(Event event){
+    return m_available[event];
+}
+
+const std::string& PerfCounters::getUnavailableReason(){
+    return m_unavailable_reason;
+}
+
+PerfCounters::Phase PerfCounters::getPhase(){
+    return m_phase;
+}
+
+PerfCounters::PhaseTotals PerfCounters::getTotals(Phase phase){
+    return m_totals[phase];
+}
+
+std::uint64_t PerfCounters::getReadCount(){
+    return m_read_count;
+}
+
+double PerfCounters::getReadSeconds(){
+    return m_read_seconds;
+}
+
+// Private methods:
+
+bool PerfCounters::readValues(std::uint64_t* values, std::uint64_t& enabled, std::uint64_t& running){
+    // PERF_FORMAT_GROUP layout: number of events, time enabled, time running, then one value per event in the order they joined the group
+    std::uint64_t buffer[3 + EVENT_COUNT];
+    auto start = std::chrono::steady_clock::now();
+    ssize_t bytes_read = read(m_leader_fd, buffer, sizeof(buffer));
+    m_read_seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    m_read_count++;
+    if (bytes_read < static_cast<ssize_t>((3 + m_open_events) * sizeof(std::uint64_t)))
+        return false;
+
+    enabled = buffer[1];
+    running = buffer[2];
+    for (int event = 0; event < EVENT_COUNT; event++)
+        values[event] = m_fds[event] != -1 ? buffer[3 + m_group_index[event]] : 0;
+    return true;
+}
+
+void PerfCounters::closeAll(){
+    for (int event = 0; event < EVENT_COUNT; event++){
+        if (m_fds[event] != -1)
+            close(m_fds[event]);
+        m_fds[event] = -1;
+    }
+    m_open_events = 0;
+    m_leader_fd = -1;
+}
+
+// Methods:
+
+bool PerfCounters::start(){
+    if (m_counting_thread)
+        stop();
+    closeAll();
+    for (PhaseTotals& totals : m_totals)
+        totals = {};
+    m_read_count = 0;
+    m_read_seconds = 0;
+    m_counted_seconds = 0;
+    m_phase = NoPhase;
+    m_unavailable_reason.clear();
+    std::fill(m_available, m_available + EVENT_COUNT, false);
+
+    static const std::uint32_t types[EVENT_COUNT] = {PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE, PERF_TYPE_HW_CACHE, PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE};
+    static const std::uint64_t configs[EVENT_COUNT] = {
+        PERF_COUNT_HW_CPU_CYCLES,
+        PERF_COUNT_HW_INSTRUCTIONS,
+        PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16),
+        PERF_COUNT_HW_CACHE_MISSES, // The kernel maps this to the last level cache
+        PERF_COUNT_HW_BRANCH_MISSES
+    };
+
+    // Events are opened one at a time, so a CPU without some of them still counts the rest
+    int leader = -1;
+    int first_error = 0;
+    for (int event = 0; event < EVENT_COUNT; event++){
+        perf_event_attr attr;
+        std::memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = types[event];
+        attr.config = configs[event];
+        attr.disabled = leader == -1; // The whole group is started at once through the leader
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+        int fd = syscall(SYS_perf_event_open, &attr, 0, -1, leader, 0); // This thread, on any CPU
+        if (fd == -1){
+            if (!first_error)
+                first_error = errno;
+            continue;
+        }
+        if (leader == -1)
+            leader = fd;
+        m_fds[event] = fd;
+        m_available[event] = true;
+        m_group_index[event] = m_open_events++;
+    }
+
+    if (leader == -1){
+        m_unavailable_reason = std::string("perf_event_open failed: ") + std::strerror(first_error);
+        if (first_error == EACCES || first_error == EPERM)
+            m_unavailable_reason += " (see /proc/sys/kernel/perf_event_paranoid, or run with CAP_PERFMON)";
+        else if (first_error == ENOENT || first_error == ENODEV || first_error == EOPNOTSUPP)
+            m_unavailable_reason += " (this machine has no hardware counters, which is common in VMs)";
+        else if (first_error == ENOSYS)
+            m_unavailable_reason += " (the kernel doesn't support perf events)";
+        return false;
+    }
+
+    m_leader_fd = leader;
+    ioctl(leader, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+    ioctl(leader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+    if (!readValues(m_last_values, m_last_enabled, m_last_running)){
+        m_unavailable_reason = "couldn't read the counters";
+        closeAll();
+        std::fill(m_available, m_available + EVENT_COUNT, false);
+        return false;
+    }
+    m_counting_thread = true;
+    m_start_time = std::chrono::steady_clock::now();
+    return true;
+}
+
+void PerfCounters::stop(){
+    if (!m_counting_thread)
+        return;
+    switchPhase(NoPhase);
+    m_counting_thread = false;
+    m_counted_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - m_start_time).count();
+    closeAll();
+}
+
+PerfCounters::Phase PerfCounters::switchPhase(Phase phase, std::uint64_t organisms){
+    Phase previous_phase = m_phase;
+    if (phase != NoPhase)
+        m_totals[phase].organisms += organisms;
+    if (phase == m_phase)
+        return previous_phase;
+
+    std::uint64_t values[EVENT_COUNT], enabled, running;
+    if (readValues(values, enabled, running)){
+        if (m_phase != NoPhase){
+            // If the kernel had to share the counters with something else, they only ran part of the time, so scale up to the whole time
+            std::uint64_t enabled_time = enabled - m_last_enabled, running_time = running - m_last_running;
+            double scale = running_time > 0 && running_time < enabled_time ? static_cast<double>(enabled_time) / running_time : 1.0;
+            for (int event = 0; event < EVENT_COUNT; event++)
+                m_totals[m_phase].events[event] += static_cast<std::uint64_t>((values[event] - m_last_values[event]) * scale);
+        }
+        std::copy(values, values + EVENT_COUNT, m_last_values);
+        m_last_enabled = enabled;
+        m_last_running = running;
+    }
+
+    m_phase = phase;
+    if (phase != NoPhase)
+        m_totals[phase].entries++;
+    return previous_phase;
+}
+
+std::string PerfCounters::getReport(){
+    std::ostringstream report;
+    report << std::fixed;
+    if (!m_unavailable_reason.empty()){
+        report << "Hardware counters unavailable: " << m_unavailable_reason << '\n';
+        return report.str();
+    }
+
+    report << std::left << std::setw(15) << "Phase" << std::right << std::setw(12) << "Organisms" << std::setw(10) << "Switches";
+    for (int event = 0; event < EVENT_COUNT; event++){
+        if (isAvailable(static_cast<Event>(event)))
+            report << std::setw(16) << getEventName(static_cast<Event>(event));
+    }
+    report << std::setw(8) << "IPC" << "  Per organism\n";
+
+    for (int phase = 0; phase < PHASE_COUNT; phase++){
+        const PhaseTotals& totals = m_totals[phase];
+        if (totals.entries == 0)
+            continue;
+
+        report << std::left << std::setw(15) << getPhaseName(static_cast<Phase>(phase)) << std::right << std::setw(12) << totals.organisms << std::setw(10) << totals.entries;
+        for (int event = 0; event < EVENT_COUNT; event++){
+            if (isAvailable(static_cast<Event>(event)))
+                report << std::setw(16) << totals.events[event];
+        }
+
+        if (isAvailable(Cycles) && isAvailable(Instructions) && totals.events[Cycles] > 0)
+            report << std::setw(8) << std::setprecision(2) << (static_cast<double>(totals.events[Instructions]) / totals.events[Cycles]);
+        else
+            report << std::setw(8) << "-";
+
+        report << " ";
+        if (totals.organisms > 0){
+            for (int event = 0; event < EVENT_COUNT; event++){
+                if (isAvailable(static_cast<Event>(event)))
+                    report << ' ' << getEventName(static_cast<Event>(event)) << ' ' << std::setprecision(event == Cycles || event == Instructions ? 0 : 2)
+                        << (static_cast<double>(totals.events[event]) / totals.organisms);
+            }
+        }
+        report << '\n';
+    }
+
+    for (int event = 0; event < EVENT_COUNT; event++){
+        if (!isAvailable(static_cast<Event>(event)))
+            report << "(" << getEventName(static_cast<Event>(event)) << " not supported on this machine)\n";
+    }
+
+    // Reads happen at every phase switch, and the events of the code around them are charged to the phases
+    report << "Counters were read " << m_read_count << " times, taking " << std::setprecision(3) << (m_read_seconds * 1000) << " ms";
+    if (m_counted_seconds > 0)
+        report << " (" << std::setprecision(2) << (100 * m_read_seconds / m_counted_seconds) << "% of the " << std::setprecision(3) << (m_counted_seconds * 1000) << " ms counted)";
+    report << '\n';
+    return report.str();
+}
@@ -0,0 +1,117 @@
+#ifndef PERFCOUNTERS_H
+#define PERFCOUNTERS_H
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+/*
+Hardware performance counters (perf_event_open) for each phase of an iteration, so changes to data layout can be judged by cache misses,
+branch misses and instructions per cycle instead of just wall-clock time
+- Counts cycles, instructions, L1 data cache read misses, last level cache misses and branch misses, in user space only
+- Only the thread that called start() is counted. Engines that update organisms on other threads (parallel:N, processes:N) only show cleanup
+  and rendering
+- Counters are read whenever the phase changes (a read() call), so phases are only switched a few times per iteration. Engines that update
+  plants and animals in one mixed loop (reference, grid) charge the whole loop to OrganismUpdate instead of switching per organism, which
+  would mostly measure the reads. The time spent reading is kept and shown in the report, so the overhead is known. When counters aren't
+  running, isCounting() is all the engine checks
+- If the kernel doesn't allow counters (perf_event_paranoid, containers, VMs without a PMU), start() returns false and says why, and every phase
+  is just ignored. Events the CPU doesn't have are left out of the report
+*/
+class PerfCounters {
+    public:
+    enum Phase {PlantUpdate, AnimalUpdate, OrganismUpdate, Cleanup, Render, PHASE_COUNT, NoPhase = PHASE_COUNT}; // OrganismUpdate is plants and animals in one loop
+    enum Event {Cycles, Instructions, L1DMisses, LLCMisses, BranchMisses, EVENT_COUNT};
+
+    struct PhaseTotals {
+        std::uint64_t events[EVENT_COUNT]{};
+        std::uint64_t organisms{0}; // Organisms handled in this phase (see switchPhase())
+        std::uint64_t entries{0}; // Times this phase was switched to
+    };
+
+    /*
+    - Switch to phase until the end of the scope, then switch back to whatever phase came before
+    */
+    class Scope {
+        Phase m_previous_phase{NoPhase};
+        bool m_counting{false};
+
+        public:
+        explicit Scope(Phase phase, std::uint64_t organisms = 0);
+        ~Scope();
+
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+    };
+
+    private:
+    static int m_fds[EVENT_COUNT]; // -1 for events that couldn't be opened
+    static int m_leader_fd; // First event that could be opened. The others join its group, so they're all started and read together
+    static int m_group_index[EVENT_COUNT]; // Position of each event's value in a group read
+    static bool m_available[EVENT_COUNT]; // Events the last start() could open. Kept after stop() for the report
+    static int m_open_events;
+    static std::string m_unavailable_reason;
+    static Phase m_phase;
+    static std::uint64_t m_last_values[EVENT_COUNT];
+    static std::uint64_t m_last_enabled; // Times from the last read, to scale counts when the kernel had to share the counters
+    static std::uint64_t m_last_running;
+    static PhaseTotals m_totals[PHASE_COUNT];
+    static std::uint64_t m_read_count; // Reads of the counters since start(), and the time they took
+    static double m_read_seconds;
+    static std::chrono::steady_clock::time_point m_start_time;
+    static double m_counted_seconds; // Time from start() to stop()
+    static thread_local bool m_counting_thread;
+
+    // Private methods:
+    static bool readValues(std::uint64_t* values, std::uint64_t& enabled, std::uint64_t& running);
+    static void closeAll();
+
+    public:
+    // Setters & Getters:
+
+    static const char* getPhaseName(Phase phase);
+    static const char* getEventName(Event event);
+
+    /*
+    - True on the thread that started the counters, while they're running
+    */
+    static bool isCounting();
+
+    static bool isAvailable(Event event); // Whether the last start() could count the event
+    static const std::string& getUnavailableReason(); // Why start() failed, or "" if it didn't
+    static Phase getPhase();
+    static PhaseTotals getTotals(Phase phase);
+
+    /*
+    - Times the counters were read since the last start(), and how long that took (in seconds). Reads are what switching phases costs
+    */
+    static std::uint64_t getReadCount();
+    static double getReadSeconds();
+
+    // Methods:
+
+    /*
+    - Open and start the counters for the calling thread, and clear the totals
+    - Returns false (and nothing is counted) if no counter could be opened. getUnavailableReason() says why
+    */
+    static bool start();
+
+    /*
+    - Stop counting and close the counters. Totals are kept. Call from the same thread as start()
+    */
+    static void stop();
+
+    /*
+    - Charge everything counted since the last switch to the current phase, then make phase the current phase and add organisms to its count
+    - Does nothing (and no read happens) if phase is already the current phase, except for adding organisms
+    - Returns the phase that was current before. Only call this while isCounting()
+    */
+    static Phase switchPhase(Phase phase, std::uint64_t organisms = 0);
+
+    /*
+    - Table of totals for each phase, with IPC and counts per organism, and how much of the time counted went to reading the counters
+    */
+    static std::string getReport();
+};
+
+#endif
@@ -1,4 +1,5 @@
 #include "Plant.h"
+#include "FreeMaskGrid.h"
 
 Plant::Plant(char letter_id, int energy_points, int regrowth_coefficient, const std::tuple<int, int>& coords)
     : Organism::Organism(letter_id, Organism::PlantEnum, regrowth_coefficient, coords), m_energy_points{energy_points} 
@@ -16,24 +17,30 @@ int Plant::getEnergyPoints() const{
 
 // Methods:
 
-void Plant::revive(){
+void Plant::revive(WorldHash& world_hash){
+    std::uint64_t old_hash_contribution = getHashContribution();
+    if (!m_alive)
+        world_hash.addLiving(getLetterID(), PlantEnum, 1);
     m_current_health = m_max_health;
     m_alive = true;
+    updateWorldHash(old_hash_contribution, world_hash);
 }
 
-void Plant::update(const std::vector<Organism*>& organisms, const std::tuple<int, int>& map_dimensions){
+void Plant::update(const std::vector<Organism*>& organisms, const std::tuple<int, int>& map_dimensions, WorldHash& world_hash, FreeMaskGrid& free_masks){
     // If plant is dead, add 1 to its health
     if (!this->isAlive()){
         if (this->getCurrentHealth() < this->getMaxHealth()){
-            this->addHealth(1);
+            this->addHealth(1, world_hash);
         }
 
         // If plant is currently not alive and its coordinates are not occupied by another organism, revive it
         if (this->getCurrentHealth() >= this->getMaxHealth()){
             // Check if another organism is standing on the plant
             bool occupied = false;
+            int candidates = 0;
             for(Organism* org : organisms){
-                if (org->getID() == this->getID())
+                candidates++;
+                if (org == this)
                     continue;
 
                 if (org->getCoords() == m_coords){
@@ -42,8 +49,14 @@ void Plant::update(const std::vector<Organism*>& organisms, const std::tuple<int
                 }
             }
 
-            if (!occupied)
-                this->revive();
+            Metrics::Counters& metrics = Metrics::local();
+            metrics.plant_revive_scans++;
+            metrics.plant_revive_candidates += candidates;
+
+            if (!occupied){
+                this->revive(world_hash);
+                free_masks.addLiving(m_coords);
+            }
         }
     }
 }
\ No newline at end of file
@@ -2,6 +2,7 @@
 #define PLANT_H
 
 #include "Organism.h"
+#include "Metrics.h"
 
 class Plant : public Organism{
     const int m_energy_points{};
@@ -28,14 +29,14 @@ class Plant : public Organism{
     - current health = max health
     - alive = true
     */
-    void revive();
+    void revive(WorldHash& world_hash);
 
     /*
     Given a vector of organisms, update this plant object as follows:
     - If a plant is dead, add 1 to its health
     - If its health >= max_health, revive it
     */
-    void update(const std::vector<Organism*>& organisms, const std::tuple<int, int>& map_dimensions) override;
+    void update(const std::vector<Organism*>& organisms, const std::tuple<int, int>& map_dimensions, WorldHash& world_hash, FreeMaskGrid& free_masks) override;
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,380 @@
+#include "PlantLayer.h"
+
+#include <cstring>
+
+int PlantLayer::Species::getRegrowthTime() const{
+    return std::max(regrowth_coefficient, 0);
+}
+
+// Setters & Getters:
+
+int PlantLayer::getWidth() const{
+    return m_width;
+}
+
+int PlantLayer::getHeight() const{
+    return m_height;
+}
+
+int PlantLayer::getPlantCount() const{
+    return m_plant_count;
+}
+
+bool PlantLayer::empty() const{
+    return m_plant_count == 0;
+}
+
+int PlantLayer::getCellIndex(int x_coord, int y_coord) const{
+    return (y_coord * m_width) + x_coord;
+}
+
+std::tuple<int, int> PlantLayer::getCoords(int cell) const{
+    return {cell % m_width, cell / m_width};
+}
+
+bool PlantLayer::hasPlant(int cell) const{
+    return (m_cells[cell] & SPECIES_MASK) != 0;
+}
+
+bool PlantLayer::isAlive(int cell) const{
+    return (m_cells[cell] & ALIVE_BIT) != 0;
+}
+
+const PlantLayer::Species& PlantLayer::getSpecies(int cell) const{
+    return m_species[(m_cells[cell] & SPECIES_MASK) - 1];
+}
+
+const std::uint32_t* PlantLayer::getCells() const{
+    return m_cells.data();
+}
+
+const std::vector<PlantLayer::Species>& PlantLayer::getSpeciesTable() const{
+    return m_species;
+}
+
+int PlantLayer::getCurrentHealth(int cell) const{
+    if (isAlive(cell))
+        return getSpecies(cell).regrowth_coefficient;
+    return getSpecies(cell).getRegrowthTime() - static_cast<int>(m_cells[cell] >> COUNTDOWN_SHIFT);
+}
+
+std::size_t PlantLayer::getMemoryUsage() const{
+    std::size_t tile_memory = ((m_dead_plants.capacity() + m_dead_tiles.capacity() + m_dead_tile_slots.capacity() + m_active_tiles.capacity()) * sizeof(int))
+        + ((m_tile_stamps.capacity() + m_regrown_stamps.capacity()) * sizeof(std::uint64_t));
+    return m_cells.getMemoryUsage() + tile_memory + (m_species.capacity() * sizeof(Species));
+}
+
+std::size_t PlantLayer::estimateMemoryUsage(const std::tuple<int, int>& map_dimensions){
+    std::size_t cell_count = static_cast<std::size_t>(std::get<0>(map_dimensions)) * std::get<1>(map_dimensions);
+    std::size_t tile_count = (cell_count + TileStore::TILE_CELLS - 1) / TileStore::TILE_CELLS;
+    // Cells, plus a dead plant count, a place in m_dead_tiles and m_active_tiles, and 2 stamps per tile
+    return (cell_count * sizeof(std::uint32_t)) + (tile_count * ((4 * sizeof(int)) + (2 * sizeof(std::uint64_t))));
+}
+
+TileStore::Stats PlantLayer::getTileStats() const{
+    return m_cells.getStats();
+}
+
+bool PlantLayer::isFileBacked() const{
+    return m_cells.isFileBacked();
+}
+
+std::size_t PlantLayer::getMemoryLimit() const{
+    return m_cells.getMemoryLimit();
+}
+
+bool PlantLayer::isOverMemoryLimit() const{
+    return isFileBacked() && static_cast<std::size_t>(getTileStats().peak_hot_tiles) * TileStore::TILE_BYTES > getMemoryLimit();
+}
+
+int PlantLayer::getDeadPlantCount() const{
+    return m_dead_plant_count;
+}
+
+std::uint64_t PlantLayer::getHashContribution(int cell) const{
+    return getHashContribution(cell, m_cells[cell]);
+}
+
+std::uint64_t PlantLayer::getHashContribution(int cell, std::uint32_t value) const{
+    if (!(value & SPECIES_MASK))
+        return 0;
+
+    const Species& species = m_species[(value & SPECIES_MASK) - 1];
+    bool alive = value & ALIVE_BIT;
+    int current_health = alive ? species.regrowth_coefficient : species.getRegrowthTime() - static_cast<int>(value >> COUNTDOWN_SHIFT);
+    return Organism::getHashContribution(species.letter_id, Organism::PlantEnum, getCoords(cell), current_health, alive);
+}
+
+bool PlantLayer::isDeadPlant(std::uint32_t value){
+    return (value & SPECIES_MASK) && !(value & ALIVE_BIT);
+}
+
+void PlantLayer::setCell(int cell, std::uint32_t value){
+    std::uint64_t old_hash_contribution = getHashContribution(cell);
+    m_plant_count += ((value & SPECIES_MASK) != 0) - hasPlant(cell);
+
+    int dead_change = isDeadPlant(value) - isDeadPlant(m_cells[cell]);
+    if (dead_change != 0){
+        int tile = cell / TileStore::TILE_CELLS;
+        m_dead_plant_count += dead_change;
+        m_dead_plants[tile] += dead_change;
+        if (m_dead_plants[tile] == 1 && dead_change == 1){
+            // Plants only die where animals are, so the tile is as far along as the last regrowAll()
+            m_dead_tile_slots[tile] = m_dead_tiles.size();
+            m_dead_tiles.push_back(tile);
+            m_regrown_stamps[tile] = m_regrow_stamp;
+        }
+        else if (m_dead_plants[tile] == 0){
+            int slot = m_dead_tile_slots[tile];
+            m_dead_tiles[slot] = m_dead_tiles.back();
+            m_dead_tile_slots[m_dead_tiles[slot]] = slot;
+            m_dead_tiles.pop_back();
+            m_dead_tile_slots[tile] = -1;
+        }
+    }
+    std::uint32_t old_value = m_cells[cell];
+    m_cells.touch(cell, true);
+    m_cells[cell] = value;
+    if (m_world_hash){
+        m_world_hash->hash.fetch_xor(old_hash_contribution ^ getHashContribution(cell), std::memory_order_relaxed);
+        if ((old_value ^ value) & ALIVE_BIT){
+            // Only one of the two values is a living plant, and its species is the one that changed count
+            std::uint32_t alive_value = (old_value & ALIVE_BIT) ? old_value : value;
+            m_world_hash->addLiving(m_species[(alive_value & SPECIES_MASK) - 1].letter_id, Organism::PlantEnum, (value & ALIVE_BIT) ? 1 : -1);
+        }
+    }
+}
+
+// Methods:
+
+void PlantLayer::useBackingFile(const std::filesystem::path& directory, std::size_t memory_limit){
+    m_cells.useBackingFile(directory, memory_limit);
+}
+
+void PlantLayer::keepResident(int cell, std::vector<int>& revived){
+    m_cells.keepResident(cell);
+
+    // An animal is about to look at this tile, so it can't stay behind
+    int tile = cell / TileStore::TILE_CELLS;
+    if (m_tile_stamps[tile] == m_stamp)
+        return;
+    m_tile_stamps[tile] = m_stamp;
+    m_active_tiles.push_back(tile);
+    if (m_dead_plants[tile] > 0 && m_regrown_stamps[tile] != m_regrow_stamp)
+        catchUpTile(tile, &revived);
+}
+
+void PlantLayer::startIteration(){
+    m_cells.advanceClock();
+    m_stamp++;
+    m_active_tiles.clear();
+}
+
+void PlantLayer::resize(const std::tuple<int, int>& map_dimensions){
+    int width = std::get<0>(map_dimensions), height = std::get<1>(map_dimensions);
+    if (width == m_width && height == m_height)
+        return;
+    catchUp();
+
+    // Plants that don't fit anymore are dropped
+    for (int cell = 0; cell < m_cells.size(); cell++){
+        std::tuple<int, int> coords = getCoords(cell);
+        if (hasPlant(cell) && (std::get<0>(coords) >= width || std::get<1>(coords) >= height))
+            setCell(cell, 0);
+    }
+
+    // Move rows in place, since a different width moves every cell (and the cells might be in a file too big to copy).
+    // Rows move towards the end when the layer gets wider, so they're moved last to first to not overwrite rows that haven't moved yet
+    std::size_t old_size = m_cells.size(), new_size = static_cast<std::size_t>(width) * height;
+    int row_count = std::min(height, m_height), row_length = std::min(width, m_width);
+    if (new_size > m_cells.size())
+        m_cells.resize(new_size);
+    std::uint32_t* cells = m_cells.data();
+    auto move_row = [&](int y){
+        std::memmove(cells + (static_cast<std::size_t>(y) * width), cells + (static_cast<std::size_t>(y) * m_width), row_length * sizeof(std::uint32_t));
+        if (width > m_width) // Cells past the old end of the row held the start of the next row
+            std::fill(cells + (static_cast<std::size_t>(y) * width) + m_width, cells + (static_cast<std::size_t>(y + 1) * width), 0);
+    };
+    if (width >= m_width){
+        for (int y = row_count - 1; y >= 0; y--)
+            move_row(y);
+    }
+    else {
+        for (int y = 0; y < row_count; y++)
+            move_row(y);
+    }
+    if (old_size > static_cast<std::size_t>(row_count) * width) // Cells after the last moved row might still hold old cells
+        std::fill(cells + (static_cast<std::size_t>(row_count) * width), cells + std::min(new_size, old_size), 0);
+    if (new_size < m_cells.size())
+        m_cells.resize(new_size);
+
+    m_width = width;
+    m_height = height;
+
+    // Every tile might have different cells now. Only the rows that were moved can have plants in them, so the rest of a big new layer
+    // never has to be paged in
+    std::size_t moved_size = static_cast<std::size_t>(row_count) * width;
+    std::size_t tile_count = (new_size + TileStore::TILE_CELLS - 1) / TileStore::TILE_CELLS;
+    m_dead_plants.assign(tile_count, 0);
+    m_dead_tile_slots.assign(tile_count, -1);
+    m_dead_tiles.clear();
+    m_tile_stamps.assign(tile_count, 0);
+    m_active_tiles.clear();
+    m_regrown_stamps.assign(tile_count, m_regrow_stamp);
+    for (std::size_t cell = 0; cell < moved_size; cell++)
+        m_dead_plants[cell / TileStore::TILE_CELLS] += isDeadPlant(m_cells[cell]);
+    for (int tile = 0; tile < tile_count; tile++){
+        if (m_dead_plants[tile] > 0){
+            m_dead_tile_slots[tile] = m_dead_tiles.size();
+            m_dead_tiles.push_back(tile);
+        }
+    }
+    for (std::size_t cell = 0; cell < moved_size; cell += TileStore::TILE_CELLS)
+        m_cells.touch(cell, true);
+}
+
+int PlantLayer::addSpecies(char letter_id, int energy_points, int regrowth_coefficient){
+    for (int i = 0; i < m_species.size(); i++){
+        const Species& species = m_species[i];
+        if (species.letter_id == letter_id && species.energy_points == energy_points && species.regrowth_coefficient == regrowth_coefficient)
+            return i;
+    }
+
+    if (m_species.size() >= MAX_SPECIES){
+        std::cerr << "Error: too many plant species (at most " << MAX_SPECIES << " are supported)\n";
+        Helper::quit(6);
+    }
+    if (regrowth_coefficient > MAX_REGROWTH_COEFFICIENT){
+        std::cerr << "Error: regrowth coefficient of plant " << letter_id << " can't be more than " << MAX_REGROWTH_COEFFICIENT << '\n';
+        Helper::quit(6);
+    }
+
+    m_species.push_back({letter_id, energy_points, regrowth_coefficient});
+    return m_species.size() - 1;
+}
+
+void PlantLayer::addPlant(const std::tuple<int, int>& coords, int species, int current_health, bool alive){
+    int regrowth_time = m_species[species].getRegrowthTime();
+    std::uint32_t countdown = alive ? 0 : std::clamp(regrowth_time - current_health, 0, regrowth_time);
+    setCell(getCellIndex(std::get<0>(coords), std::get<1>(coords)), (species + 1) | (alive ? ALIVE_BIT : 0) | (countdown << COUNTDOWN_SHIFT));
+}
+
+void PlantLayer::eat(int cell){
+    // Health goes to 0, so the countdown starts over at the regrowth coefficient
+    std::uint32_t countdown = getSpecies(cell).getRegrowthTime();
+    setCell(cell, (m_cells[cell] & SPECIES_MASK) | (countdown << COUNTDOWN_SHIFT));
+}
+
+bool PlantLayer::regrow(int cell, bool occupied){
+    std::uint32_t value = m_cells[cell];
+    if (!(value & SPECIES_MASK) || (value & ALIVE_BIT))
+        return false;
+
+    // Grow by 1
+    std::uint32_t countdown = value >> COUNTDOWN_SHIFT;
+    if (countdown > 0){
+        countdown--;
+        setCell(cell, (value & SPECIES_MASK) | (countdown << COUNTDOWN_SHIFT));
+    }
+
+    // Revive once fully grown, as long as nothing is standing on it
+    if (countdown > 0)
+        return false;
+    if (!occupied)
+        revive(cell);
+    return true;
+}
+
+void PlantLayer::regrowAll(std::vector<int>& ready, Kernels::Implementation implementation, bool defer_idle_tiles){
+    // Each tile is regrown on its own, so tiles without dead plants are never touched. In hybrid mode, only tiles near animals are
+    m_regrow_stamp = m_stamp;
+    m_counted_down.clear();
+    ready.clear();
+    m_regrow_tiles.clear();
+    if (defer_idle_tiles){
+        for (int tile : m_active_tiles){
+            if (m_dead_plants[tile] > 0)
+                m_regrow_tiles.push_back(tile);
+        }
+    }
+    else{
+        m_regrow_tiles.assign(m_dead_tiles.begin(), m_dead_tiles.end());
+    }
+    std::sort(m_regrow_tiles.begin(), m_regrow_tiles.end()); // So ready comes out in cell order
+
+    for (int tile : m_regrow_tiles){
+        m_regrown_stamps[tile] = m_stamp;
+        int first_cell = tile * TileStore::TILE_CELLS;
+        int cell_count = std::min<int>(TileStore::TILE_CELLS, m_cells.size() - first_cell);
+        Kernels::regrowPlants(m_cells.data() + first_cell, cell_count, m_tile_counted_down, m_tile_ready, implementation);
+        m_cells.touch(first_cell, !m_tile_counted_down.empty());
+        for (int cell : m_tile_counted_down)
+            m_counted_down.push_back(first_cell + cell);
+        for (int cell : m_tile_ready)
+            ready.push_back(first_cell + cell);
+    }
+
+    // The kernel doesn't know about hashing, so every plant whose health went up still has to be re-hashed
+    if (!m_world_hash)
+        return;
+    std::uint64_t hash_change = 0;
+    for (int cell : m_counted_down){
+        std::uint32_t value = m_cells[cell];
+        hash_change ^= getHashContribution(cell, value + (1u << COUNTDOWN_SHIFT)) ^ getHashContribution(cell, value);
+    }
+    m_world_hash->hash.fetch_xor(hash_change, std::memory_order_relaxed);
+}
+
+void PlantLayer::catchUpTile(int tile, std::vector<int>* revived){
+    // No animal was in or next to the tile while it was behind, so every countdown just went down by 1 each iteration,
+    // and plants revived as soon as theirs reached 0
+    std::uint64_t owed = m_regrow_stamp - m_regrown_stamps[tile];
+    m_regrown_stamps[tile] = m_regrow_stamp;
+    int first_cell = tile * TileStore::TILE_CELLS;
+    int end_cell = std::min<std::size_t>(first_cell + TileStore::TILE_CELLS, m_cells.size());
+    m_cells.touch(first_cell, false);
+    for (int cell = first_cell; cell < end_cell; cell++){
+        std::uint32_t value = m_cells[cell];
+        if (!isDeadPlant(value))
+            continue;
+
+        std::uint32_t countdown = value >> COUNTDOWN_SHIFT;
+        if (countdown <= owed){
+            setCell(cell, (value & SPECIES_MASK) | ALIVE_BIT);
+            if (revived)
+                revived->push_back(cell);
+        }
+        else
+            setCell(cell, (value & SPECIES_MASK) | ((countdown - owed) << COUNTDOWN_SHIFT));
+    }
+}
+
+void PlantLayer::catchUp(){
+    // Catching up can leave a tile without dead plants, which moves the last tile into its place, so go from back to front
+    for (int slot = static_cast<int>(m_dead_tiles.size()) - 1; slot >= 0; slot--){
+        if (slot < m_dead_tiles.size() && m_regrown_stamps[m_dead_tiles[slot]] != m_regrow_stamp)
+            catchUpTile(m_dead_tiles[slot], nullptr);
+    }
+}
+
+void PlantLayer::revive(int cell){
+    setCell(cell, (m_cells[cell] & SPECIES_MASK) | ALIVE_BIT);
+}
+
+void PlantLayer::clear(){
+    for (int cell = 0; cell < m_cells.size(); cell++){
+        if (hasPlant(cell))
+            setCell(cell, 0);
+    }
+    m_cells.resize(0);
+    m_dead_plants.clear();
+    m_dead_plant_count = 0;
+    m_dead_tiles.clear();
+    m_dead_tile_slots.clear();
+    m_tile_stamps.clear();
+    m_active_tiles.clear();
+    m_regrown_stamps.clear();
+    m_species.clear();
+    m_width = 0;
+    m_height = 0;
+}
@@ -0,0 +1,202 @@
+#ifndef PLANTLAYER_H
+#define PLANTLAYER_H
+
+#include "Organism.h"
+#include "Kernels.h"
+#include "TileStore.h"
+
+#include <vector>
+#include <cstdint>
+#include <atomic>
+
+/*
+Dense per-cell store for plants. Plants never move, so instead of being Organism objects they can just be a few bits in a grid
+- Every cell is one 32-bit word: species index + 1 (0 = no plant), an alive bit, and a regrowth countdown
+- Things that are the same for a whole species (letter ID, energy points, regrowth coefficient) are looked up in a small species table
+- A living plant's health is its regrowth coefficient, and a dead plant's health is its regrowth coefficient (or 0 if that's negative)
+  minus its countdown, so plants here behave (and hash) exactly like Plant objects
+- Cells are indexed like the map: (y * width) + x
+- Cells are kept in a TileStore, so maps that are too big for memory can keep them in a file instead (see useBackingFile())
+*/
+class PlantLayer {
+    public:
+    struct Species {
+        char letter_id{};
+        int energy_points{};
+        int regrowth_coefficient{}; // Max health
+
+        int getRegrowthTime() const; // Iterations it takes a dead plant to grow back
+    };
+
+    static constexpr int MAX_SPECIES = 255;
+    static constexpr int MAX_REGROWTH_COEFFICIENT = (1 << 23) - 1; // Largest countdown that fits in a cell
+
+    // Layout of a cell (see Kernels::regrowPlants())
+    static constexpr std::uint32_t SPECIES_MASK = 0xFF;
+    static constexpr std::uint32_t ALIVE_BIT = 1u << 8;
+    static constexpr int COUNTDOWN_SHIFT = 9;
+
+    private:
+
+    TileStore m_cells;
+    std::vector<int> m_dead_plants; // Dead plants in each tile of m_cells
+    int m_dead_plant_count{0};
+
+    // Tiles with dead plants in them, in no particular order, so regrowAll() and catchUp() only go through those instead of every tile
+    std::vector<int> m_dead_tiles;
+    std::vector<int> m_dead_tile_slots; // Where each tile is in m_dead_tiles (-1 if it has no dead plants)
+
+    std::vector<std::uint64_t> m_tile_stamps; // Last iteration each tile had an animal in or next to it (see keepResident())
+    std::vector<int> m_active_tiles; // Tiles keepResident() was called on this iteration
+    std::vector<std::uint64_t> m_regrown_stamps; // Last iteration each tile with dead plants was regrown for. Older than m_regrow_stamp = behind
+    std::uint64_t m_stamp{1};
+    std::uint64_t m_regrow_stamp{1}; // Iteration regrowAll() was last called in
+    std::vector<Species> m_species;
+    int m_width{0};
+    int m_height{0};
+    int m_plant_count{0};
+    Organism::WorldHash* m_world_hash{nullptr}; // Hash and live counts of the world these plants are in. This is set by OrganismPool
+    std::vector<int> m_counted_down; // Scratch space for regrowAll()
+    std::vector<int> m_tile_counted_down; // Scratch space for regrowAll()
+    std::vector<int> m_tile_ready; // Scratch space for regrowAll()
+    std::vector<int> m_regrow_tiles; // Scratch space for regrowAll()
+
+    // Private methods:
+    std::uint64_t getHashContribution(int cell) const;
+    std::uint64_t getHashContribution(int cell, std::uint32_t value) const; // Hash contribution cell would have if it held value
+    static bool isDeadPlant(std::uint32_t value);
+    void setCell(int cell, std::uint32_t value); // Change a cell and keep the world hash, live and dead plant counts and m_dead_tiles up to date
+    void catchUpTile(int tile, std::vector<int>* revived); // Apply the iterations of regrowth a tile is behind in one go, adding revived cells to revived if it isn't nullptr
+
+    public:
+    // Setters & Getters:
+
+    int getWidth() const;
+    int getHeight() const;
+
+    /*
+    - Number of plants (dead or alive)
+    */
+    int getPlantCount() const;
+
+    bool empty() const;
+
+    int getCellIndex(int x_coord, int y_coord) const;
+    std::tuple<int, int> getCoords(int cell) const;
+
+    bool hasPlant(int cell) const;
+    bool isAlive(int cell) const;
+    const Species& getSpecies(int cell) const; // Only call this on cells with a plant
+
+    /*
+    - The cells themselves (getWidth() * getHeight() of them, laid out as above) and the species table their species indexes point into.
+      Nothing is copied, so they're only valid until the layer changes. With hybrid mode, tiles that are behind hold old values
+    */
+    const std::uint32_t* getCells() const;
+    const std::vector<Species>& getSpeciesTable() const;
+    int getCurrentHealth(int cell) const; // Only call this on cells with a plant
+
+    /*
+    - Memory used by the layer (in bytes). With a backing file, only resident tiles count
+    */
+    std::size_t getMemoryUsage() const;
+
+    /*
+    - Memory a layer for a map of map_dimensions would use in memory (in bytes), whatever plants are on it, since every cell takes 4 bytes
+    */
+    static std::size_t estimateMemoryUsage(const std::tuple<int, int>& map_dimensions);
+
+    TileStore::Stats getTileStats() const;
+    bool isFileBacked() const;
+    std::size_t getMemoryLimit() const; // Bytes of tiles kept resident with a backing file (0 = no limit, see useBackingFile())
+
+    /*
+    - Whether tiles with animals in or next to them have ever taken more than the memory limit on their own. Those tiles are never dropped,
+      so when this is true, more than the limit was resident
+    */
+    bool isOverMemoryLimit() const;
+
+    /*
+    - Number of dead plants, from a count kept as plants change. With hybrid mode, plants in tiles that are behind are counted as they were
+    */
+    int getDeadPlantCount() const;
+
+    // Methods:
+
+    /*
+    - Keep cells in a memory-mapped file in directory instead of in memory, with at most memory_limit bytes of them resident (see TileStore)
+    - Cells that are already in the layer are moved to the file
+    */
+    void useBackingFile(const std::filesystem::path& directory, std::size_t memory_limit);
+
+    /*
+    - Tell the layer that cell is being looked at this iteration (there's an animal in or next to it). Its tile is kept in memory (with a
+      backing file), counts as active for regrowAll(), and is caught up first if it had fallen behind
+    - Plants that revive while catching up are added to revived, for callers that keep track of which cells are occupied
+    - Call startIteration() before the first one of each iteration
+    */
+    void keepResident(int cell, std::vector<int>& revived);
+
+    void startIteration();
+
+    /*
+    - Make room for a map of size map_dimensions. Plants that are already in the layer are kept
+    */
+    void resize(const std::tuple<int, int>& map_dimensions);
+
+    /*
+    - Get the index of the species with these stats, adding it to the species table if it isn't there yet
+    - Quits (error 6) if there are too many species or regrowth_coefficient doesn't fit in a cell
+    */
+    int addSpecies(char letter_id, int energy_points, int regrowth_coefficient);
+
+    /*
+    - Put a plant of species species at coords, replacing whatever plant was there
+    - current_health and alive let plants be moved here from Plant objects without changing their state
+    */
+    void addPlant(const std::tuple<int, int>& coords, int species, int current_health, bool alive);
+
+    /*
+    - Kill the plant in cell (it was eaten). Same as Organism::die()
+    */
+    void eat(int cell);
+
+    /*
+    - Same as Plant::update() for the plant in cell: a dead plant regrows by 1, and revives once it's fully grown unless occupied is true
+    - Returns true if the plant was fully grown and had to check whether it was occupied
+    */
+    bool regrow(int cell, bool occupied);
+
+    /*
+    - Batched version of regrow() for every cell at once: every dead plant regrows by 1, using Kernels::regrowPlants()
+    - Only tiles that have dead plants are looked at (m_dead_tiles), so tiles that nothing has eaten from don't need to be in memory, and
+      their number doesn't matter
+    - Plants that are fully grown are put in ready (in cell order) instead of being revived, since only the caller knows which cells are occupied.
+      Call revive() on the ones that aren't. Doing that gives exactly the same result as calling regrow() on every cell
+    - With defer_idle_tiles, only tiles that an animal is in or next to this iteration (see keepResident()) are regrown, so the cost only
+      depends on how many tiles animals are near. The others remember the last iteration they were regrown for, so they don't cost anything
+      while they're idle. Nothing can eat or stand on plants there, so regrowth is only a countdown, and catching up k iterations later
+      (catchUp(), or keepResident() once an animal comes near) is exactly the same as regrowing every iteration. Until then, plants in those
+      tiles (and the world hash) are behind
+    */
+    void regrowAll(std::vector<int>& ready, Kernels::Implementation implementation = Kernels::getBestImplementation(), bool defer_idle_tiles = false);
+
+    /*
+    - Catch up every tile that regrowAll() left behind. Only tiles with dead plants are looked at
+    */
+    void catchUp();
+
+    /*
+    - Bring the plant in cell back to life (it's fully grown and nothing is standing on it)
+    */
+    void revive(int cell);
+
+    /*
+    - Remove every plant and species
+    */
+    void clear();
+
+    friend class OrganismPool;
+};
+
+#endif
@@ -0,0 +1,436 @@
+#include "ProcessEngine.h"
+
+#include <cstring>
+#include <csignal>
+#include <sys/prctl.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+ProcessEngine::ProcessEngine(int process_count, unsigned int seed, const std::string& transport)
+    : m_process_count(process_count), m_seed(seed), m_transport(transport) {}
+
+ProcessEngine::~ProcessEngine(){
+    if (m_worker != -1)
+        return;
+
+    Command command{QuitCommand, 0, 0, 0, 0};
+    for (int worker = 0; worker < m_workers.size(); worker++)
+        m_control_channels[worker]->send(0, &command, sizeof(command));
+    for (pid_t pid : m_workers)
+        ::waitpid(pid, nullptr, 0);
+}
+
+std::string ProcessEngine::getName() const{
+    return "processes:" + std::to_string(m_process_count) + (m_transport == "socket" ? "" : ":" + m_transport);
+}
+
+// Records:
+
+ProcessEngine::OrganismRecord ProcessEngine::makeRecord(const Organism* org){
+    OrganismRecord record{};
+    record.id = org->getID();
+    record.color = org->getColor();
+    record.x_coord = std::get<0>(org->getCoords());
+    record.y_coord = std::get<1>(org->getCoords());
+    record.max_health = org->getMaxHealth();
+    record.current_health = org->getCurrentHealth();
+    if (org->getType() == Organism::PlantEnum)
+        record.extra = dynamic_cast<const Plant*>(org)->getEnergyPoints();
+    else
+        record.extra = dynamic_cast<const Animal*>(org)->getVisionRadius();
+    record.letter_id = org->getLetterID();
+    record.type = org->getType();
+    record.alive = org->isAlive();
+    return record;
+}
+
+Organism* ProcessEngine::makeOrganism(const OrganismRecord& record){
+    Organism* org;
+    std::tuple<int, int> coords{record.x_coord, record.y_coord};
+    Organism::OrganismType type = static_cast<Organism::OrganismType>(record.type);
+    if (type == Organism::PlantEnum)
+        org = new Plant(record.letter_id, record.extra, record.max_health, coords);
+    else
+        org = new Animal(record.letter_id, type, record.max_health, coords, record.extra);
+
+    // The constructor gave it a new ID and a random color, so put back the original ones
+    org->m_id = record.id;
+    org->m_color = record.color;
+    org->m_current_health = record.current_health;
+    org->m_alive = record.alive;
+    return org;
+}
+
+void ProcessEngine::appendRecord(std::vector<char>& message, const Organism* org){
+    OrganismRecord record = makeRecord(org);
+    const char* bytes = reinterpret_cast<const char*>(&record);
+    message.insert(message.end(), bytes, bytes + sizeof(record));
+}
+
+void ProcessEngine::readRecords(const std::vector<char>& message, std::size_t offset, std::vector<OrganismRecord>& records){
+    std::size_t count = (message.size() - offset) / sizeof(OrganismRecord);
+    std::size_t first = records.size();
+    records.resize(first + count);
+    std::memcpy(records.data() + first, message.data() + offset, count * sizeof(OrganismRecord));
+}
+
+// Coordinator:
+
+void ProcessEngine::assignStrips(const std::tuple<int, int>& map_dimensions){
+    m_map_dimensions = map_dimensions;
+    m_strip_count = ParallelEngine::getStripCount(std::get<1>(map_dimensions));
+
+    // Hand out whole strips as evenly as possible. Workers with no strips would have nothing to do, so at most as many workers as strips are active
+    m_active_workers = std::min(m_process_count, m_strip_count);
+    m_first_strips.clear();
+    for (int worker = 0; worker <= m_active_workers; worker++)
+        m_first_strips.push_back((worker * m_strip_count) / m_active_workers);
+}
+
+void ProcessEngine::load(const OrganismPool& organisms, const std::tuple<int, int>& map_dimensions){
+    assignStrips(map_dimensions);
+    Command command{LoadCommand, std::get<0>(map_dimensions), std::get<1>(map_dimensions), 0, 0};
+    for (int worker = 0; worker < m_workers.size(); worker++){
+        m_message.clear();
+        if (worker < m_active_workers){
+            int first_row = getFirstRow(worker), end_row = getEndRow(worker);
+            for (const Organism* org : organisms.getOrganisms()){
+                int y_coord = std::get<1>(org->getCoords());
+                if (y_coord >= first_row && y_coord < end_row)
+                    appendRecord(m_message, org);
+            }
+        }
+        m_control_channels[worker]->send(0, &command, sizeof(command));
+        m_control_channels[worker]->sendMessage(0, m_message);
+    }
+}
+
+void ProcessEngine::start(){
+    if (m_started)
+        return;
+    m_started = true;
+
+    // Every worker can be active on some map, so each one gets its channels now
+    for (int worker = 0; worker < m_process_count; worker++){
+        m_control_channels.push_back(Channel::create(m_transport));
+        if (worker + 1 < m_process_count)
+            m_neighbor_channels.push_back(Channel::create(m_transport));
+    }
+
+    // Anything still buffered would get printed again by every worker
+    std::cout.flush();
+    std::cerr.flush();
+    std::fflush(nullptr);
+
+    for (int worker = 0; worker < m_process_count; worker++){
+        pid_t pid = ::fork();
+        if (pid < 0){
+            std::cerr << "Error: couldn't start worker process " << worker << '\n';
+            Helper::quit(11);
+        }
+        if (pid == 0){
+            // Don't outlive the coordinator if it dies without saying goodbye
+            ::prctl(PR_SET_PDEATHSIG, SIGTERM);
+            m_worker = worker;
+            m_workers.clear();
+            runWorker();
+            ::_exit(0);
+        }
+        m_workers.push_back(pid);
+    }
+}
+
+void ProcessEngine::applyRecords(OrganismPool& organisms){
+    std::sort(m_records.begin(), m_records.end(), [](const OrganismRecord& a, const OrganismRecord& b) { return a.id < b.id; });
+    std::vector<char> found(m_records.size(), false);
+
+    // Update organisms in place so the pool keeps its order. Organisms that no worker has anymore were cleaned up in an earlier iteration
+    auto find_record = [this](const Organism* org) {
+        auto record = std::lower_bound(m_records.begin(), m_records.end(), org->getID(), [](const OrganismRecord& r, int id) { return r.id < id; });
+        return (record == m_records.end() || record->id != org->getID()) ? m_records.end() : record;
+    };
+    organisms.eraseIf([&](const Organism* org) { return find_record(org) == m_records.end(); });
+    for (Organism* org : organisms.getOrganisms()){
+        auto record = find_record(org);
+        found[record - m_records.begin()] = true;
+        std::uint64_t old_hash_contribution = org->getHashContribution();
+        org->m_coords = {record->x_coord, record->y_coord};
+        org->m_current_health = record->current_health;
+        if (org->m_alive != record->alive)
+            organisms.getWorldHashState().addLiving(org->m_letter_id, org->m_type, record->alive ? 1 : -1);
+        org->m_alive = record->alive;
+        org->updateWorldHash(old_hash_contribution, organisms.getWorldHashState());
+    }
+
+    for (int i = 0; i < m_records.size(); i++){
+        if (!found[i])
+            organisms.insert(makeOrganism(m_records[i]));
+    }
+}
+
+void ProcessEngine::update(OrganismPool& organisms, const std::tuple<int, int>& map_dimensions, long long iteration){
+    run(organisms, map_dimensions, iteration, 1);
+}
+
+void ProcessEngine::run(OrganismPool& organisms, const std::tuple<int, int>& map_dimensions, long long first_iteration, long long iteration_count){
+    checkVision(organisms);
+    if (!organisms.getPlantLayer().empty()){
+        std::cerr << "Error: " << getName() << " doesn't support plants stored in a PlantLayer\n";
+        Helper::quit(11);
+    }
+    start();
+
+    // Workers keep their organisms between runs, so they only need the world again if something else changed it
+    if (&organisms != m_pool || map_dimensions != m_map_dimensions || organisms.getChangeCount() != m_pool_changes || organisms.getWorldHash() != m_world_hash)
+        load(organisms, map_dimensions);
+
+    Command command{RunCommand, 0, 0, first_iteration, iteration_count};
+    for (int worker = 0; worker < m_active_workers; worker++)
+        m_control_channels[worker]->send(0, &command, sizeof(command));
+
+    // Workers send their organisms before cleaning up the last iteration, so cleaning up here erases the same organisms in the same order
+    m_records.clear();
+    for (int worker = 0; worker < m_active_workers; worker++){
+        m_control_channels[worker]->receiveMessage(0, m_message);
+        readRecords(m_message, 0, m_records);
+    }
+    applyRecords(organisms);
+
+    Ecosystem::cleanUpEcosystem(organisms, first_iteration + iteration_count - 1);
+    m_pool = &organisms;
+    m_pool_changes = organisms.getChangeCount();
+    m_world_hash = organisms.getWorldHash();
+}
+
+// Workers:
+
+int ProcessEngine::getFirstRow(int worker) const{
+    return m_first_strips[worker] * ParallelEngine::STRIP_HEIGHT;
+}
+
+int ProcessEngine::getEndRow(int worker) const{
+    if (m_first_strips[worker + 1] == m_strip_count)
+        return std::get<1>(m_map_dimensions);
+    return m_first_strips[worker + 1] * ParallelEngine::STRIP_HEIGHT;
+}
+
+int ProcessEngine::getBoundaryStrip(Direction direction) const{
+    return direction == Above ? m_first_strips[m_worker] : m_first_strips[m_worker + 1] - 1;
+}
+
+Channel* ProcessEngine::getNeighborChannel(Direction direction, int& side) const{
+    if (direction == Above){
+        side = 1;
+        return m_worker > 0 ? m_neighbor_channels[m_worker - 1].get() : nullptr;
+    }
+    side = 0;
+    return m_worker + 1 < m_active_workers ? m_neighbor_channels[m_worker].get() : nullptr;
+}
+
+void ProcessEngine::runWorker(){
+    OrganismPool organisms; // Organisms in this worker's strips, sent by the coordinator (see load())
+    Channel& control = *m_control_channels[m_worker];
+    while (true){
+        Command command{};
+        control.receive(1, &command, sizeof(command));
+        if (command.type == LoadCommand){
+            loadWorker(organisms, {command.width, command.height});
+        }
+        else if (command.type == RunCommand){
+            for (long long i = 0; i < command.iteration_count; i++)
+                runWorkerIteration(organisms, command.first_iteration + i, i == command.iteration_count - 1);
+        }
+        else{
+            return;
+        }
+    }
+}
+
+void ProcessEngine::loadWorker(OrganismPool& organisms, const std::tuple<int, int>& map_dimensions){
+    // Strips are handed out the same way as in the coordinator, so both know which rows this worker owns
+    assignStrips(map_dimensions);
+    m_control_channels[m_worker]->receiveMessage(1, m_message);
+    m_records.clear();
+    readRecords(m_message, 0, m_records);
+    organisms.clear();
+    for (const OrganismRecord& record : m_records)
+        organisms.insert(makeOrganism(record));
+    m_free_masks.rebuild(organisms.getOrganisms(), m_map_dimensions);
+
+    int strip_count = m_worker < m_active_workers ? m_first_strips[m_worker + 1] - m_first_strips[m_worker] : 0;
+    m_owned_organisms.resize(strip_count);
+    m_nearby_organisms.resize(strip_count);
+}
+
+void ProcessEngine::runWorkerIteration(OrganismPool& organisms, long long iteration, bool send_state){
+    int first_strip = m_first_strips[m_worker], end_strip = m_first_strips[m_worker + 1];
+    auto by_id = [](const Organism* a, const Organism* b) { return a->getID() < b->getID(); };
+
+    // Same as ParallelEngine, but only for this worker's strips
+    m_sorted_organisms = organisms.getOrganisms();
+    std::sort(m_sorted_organisms.begin(), m_sorted_organisms.end(), by_id);
+    for (std::vector<Organism*>& owned : m_owned_organisms)
+        owned.clear();
+    for (Organism* org : m_sorted_organisms)
+        m_owned_organisms[ParallelEngine::getStrip(std::get<1>(org->getCoords()), m_strip_count) - first_strip].push_back(org);
+
+    for (int phase = 0; phase < 2; phase++){
+        exchangeHalos(organisms, phase);
+
+        // Halo copies go in with everything else, so nearby organisms are in ID order just like in ParallelEngine
+        m_sorted_organisms = organisms.getOrganisms();
+        for (const std::vector<Organism*>& halo : m_halo_organisms)
+            m_sorted_organisms.insert(m_sorted_organisms.end(), halo.begin(), halo.end());
+        std::sort(m_sorted_organisms.begin(), m_sorted_organisms.end(), by_id);
+
+        for (std::vector<Organism*>& nearby : m_nearby_organisms)
+            nearby.clear();
+        for (Organism* org : m_sorted_organisms){
+            int y_coord = std::get<1>(org->getCoords());
+            int strip = ParallelEngine::getStrip(y_coord, m_strip_count);
+            int nearby_strip = -1;
+            if (strip % 2 == phase)
+                nearby_strip = strip;
+            else if (y_coord % ParallelEngine::STRIP_HEIGHT == 0 && strip > 0)
+                nearby_strip = strip - 1;
+            else if (y_coord % ParallelEngine::STRIP_HEIGHT == ParallelEngine::STRIP_HEIGHT - 1 && strip + 1 < m_strip_count)
+                nearby_strip = strip + 1;
+
+            if (nearby_strip >= first_strip && nearby_strip < end_strip)
+                m_nearby_organisms[nearby_strip - first_strip].push_back(org);
+        }
+
+        for (int strip = first_strip; strip < end_strip; strip++){
+            if (strip % 2 != phase)
+                continue;
+            Helper::setRandomSeed(ParallelEngine::getStripSeed(m_seed, iteration, strip));
+            ParallelEngine::updateOrganisms(m_owned_organisms[strip - first_strip], m_nearby_organisms[strip - first_strip], m_map_dimensions, organisms.getWorldHashState(),
+                m_free_masks);
+        }
+
+        exchangeChanges(organisms, phase);
+    }
+
+    if (send_state){
+        m_message.clear();
+        for (const Organism* org : organisms.getOrganisms())
+            appendRecord(m_message, org);
+        m_control_channels[m_worker]->sendMessage(1, m_message);
+    }
+
+    Ecosystem::cleanUpEcosystem(organisms, iteration);
+}
+
+/*
+- At each boundary, exactly one of the 2 strips next to it gets updated in a phase. That side needs the other side's row next to the boundary
+- Workers deal with the boundary above before the one below. The top worker has no boundary above, so it never waits, and every other worker
+  only waits on a worker that's already past its own wait. So this can't deadlock, even if a message doesn't fit in the transport's buffer
+*/
+void ProcessEngine::exchangeHalos(OrganismPool& organisms, int phase){
+    for (Direction direction : {Above, Below}){
+        int side;
+        Channel* channel = getNeighborChannel(direction, side);
+        if (!channel)
+            continue;
+
+        if (getBoundaryStrip(direction) % 2 == phase){
+            channel->receiveMessage(side, m_message);
+            m_records.clear();
+            readRecords(m_message, 0, m_records);
+            for (const OrganismRecord& record : m_records){
+                m_halo_organisms[direction].push_back(makeOrganism(record));
+                m_halo_was_alive[direction].push_back(record.alive);
+                if (record.alive)
+                    m_free_masks.addLiving({record.x_coord, record.y_coord});
+            }
+        }
+        else{
+            int boundary_row = direction == Above ? getFirstRow(m_worker) : getEndRow(m_worker) - 1;
+            m_message.clear();
+            for (const Organism* org : organisms.getOrganisms()){
+                if (std::get<1>(org->getCoords()) == boundary_row)
+                    appendRecord(m_message, org);
+            }
+            channel->sendMessage(side, m_message);
+        }
+    }
+}
+
+/*
+- The side that got updated sends back the IDs of halo copies that got eaten, then animals that crossed the boundary
+*/
+void ProcessEngine::exchangeChanges(OrganismPool& organisms, int phase){
+    int first_row = getFirstRow(m_worker), end_row = getEndRow(m_worker);
+    for (Direction direction : {Above, Below}){
+        int side;
+        Channel* channel = getNeighborChannel(direction, side);
+        if (!channel)
+            continue;
+
+        if (getBoundaryStrip(direction) % 2 == phase){
+            std::vector<Organism*>& halo = m_halo_organisms[direction];
+            std::int32_t eaten_count = 0;
+            m_message.assign(sizeof(eaten_count), 0);
+            for (int i = 0; i < halo.size(); i++){
+                if (m_halo_was_alive[direction][i] && !halo[i]->isAlive()){
+                    std::int32_t id = halo[i]->getID();
+                    const char* bytes = reinterpret_cast<const char*>(&id);
+                    m_message.insert(m_message.end(), bytes, bytes + sizeof(id));
+                    eaten_count++;
+                }
+            }
+            std::memcpy(m_message.data(), &eaten_count, sizeof(eaten_count));
+
+            for (const Organism* org : organisms.getOrganisms()){
+                int y_coord = std::get<1>(org->getCoords());
+                if (direction == Above ? y_coord < first_row : y_coord >= end_row)
+                    appendRecord(m_message, org);
+            }
+            channel->sendMessage(side, m_message);
+        }
+        else{
+            channel->receiveMessage(side, m_message);
+            std::int32_t eaten_count = 0;
+            std::memcpy(&eaten_count, m_message.data(), sizeof(eaten_count));
+
+            // m_sorted_organisms still has every organism from before the phase, sorted by ID
+            for (int i = 0; i < eaten_count; i++){
+                std::int32_t id = 0;
+                std::memcpy(&id, m_message.data() + sizeof(eaten_count) + (i * sizeof(id)), sizeof(id));
+                auto org = std::lower_bound(m_sorted_organisms.begin(), m_sorted_organisms.end(), id, [](const Organism* o, int target) { return o->getID() < target; });
+                (*org)->die(organisms.getWorldHashState());
+                m_free_masks.removeLiving((*org)->getCoords());
+            }
+
+            m_records.clear();
+            readRecords(m_message, sizeof(eaten_count) + (eaten_count * sizeof(std::int32_t)), m_records);
+            for (const OrganismRecord& record : m_records){
+                organisms.insert(makeOrganism(record));
+                if (record.alive)
+                    m_free_masks.addLiving({record.x_coord, record.y_coord});
+            }
+        }
+    }
+
+    // Halo copies are only deleted now since m_sorted_organisms still points at them
+    for (int direction : {Above, Below}){
+        for (Organism* org : m_halo_organisms[direction]){
+            if (org->isAlive())
+                m_free_masks.removeLiving(org->getCoords());
+            delete org;
+        }
+        m_halo_organisms[direction].clear();
+        m_halo_was_alive[direction].clear();
+    }
+
+    // Animals that crossed a boundary belong to the worker on the other side now
+    for (int i = organisms.size() - 1; i >= 0; i--){
+        const Organism* org = organisms.getOrganisms()[i];
+        int y_coord = std::get<1>(org->getCoords());
+        if (y_coord < first_row || y_coord >= end_row){
+            if (org->isAlive())
+                m_free_masks.removeLiving(org->getCoords());
+            organisms.eraseAt(i);
+        }
+    }
+}
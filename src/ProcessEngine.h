@@ -0,0 +1,144 @@
+#ifndef PROCESSENGINE_H
+#define PROCESSENGINE_H
+
+#include "Engine.h"
+#include "ParallelEngine.h"
+#include "Channel.h"
+
+#include <sys/types.h>
+
+/*
+Engine that splits the map between worker processes (domain decomposition)
+- Uses ParallelEngine's strips: each worker owns a block of whole strips and the organisms in them, and runs the same 2 phases with
+  the same per-strip seeds. Results are exactly the same as "parallel:1" for any number of workers
+- Before a phase, the worker on the updated side of each boundary gets a copy of the one row across it (the halo). After the phase it sends
+  back which of those copies got eaten, and any animals that moved across the boundary (they now belong to the other worker)
+- Workers only talk to the worker above and below them, plus the process that made the engine (the coordinator)
+- Messages go through a Channel, so the transport can be swapped: Unix sockets ("socket") or shared memory ("shm")
+- Workers are forked when the engine is made (Engine::create() calls start()), so make it before starting any threads. They start out
+  empty: the first run() sends them the map size and the organisms in their strips, and so does any run() after something other than the
+  engine changed the pool or the map size. Workers past the number of strips the map has wait until a later map needs them
+- Plants in a PlantLayer aren't supported
+- update() has to gather every organism back into the coordinator's pool after each iteration. run() only does that once at the end,
+  but the pool's order may then differ from "parallel:1" (the organisms and the world hash are the same)
+- Like ParallelEngine, worlds where some animal has a vision radius are refused (see Engine::checkVision())
+*/
+class ProcessEngine : public Engine {
+    public:
+    /*
+    Everything about an organism that's needed to make a copy of it in another process
+    */
+    struct OrganismRecord {
+        std::int32_t id;
+        std::int32_t color;
+        std::int32_t x_coord;
+        std::int32_t y_coord;
+        std::int32_t max_health;
+        std::int32_t current_health;
+        std::int32_t extra; // Energy points for plants, vision radius for animals
+        char letter_id;
+        std::uint8_t type;
+        std::uint8_t alive;
+    };
+
+    private:
+    enum CommandType : std::int32_t {
+        LoadCommand, // Followed by a message with the organisms in the worker's strips
+        RunCommand,
+        QuitCommand
+    };
+
+    struct Command {
+        std::int32_t type;
+        std::int32_t width; // Map size, for LoadCommand
+        std::int32_t height;
+        std::int64_t first_iteration; // For RunCommand
+        std::int64_t iteration_count;
+    };
+
+    enum Direction {
+        Above = 0,
+        Below = 1
+    };
+
+    int m_process_count{};
+    unsigned int m_seed{};
+    std::string m_transport;
+
+    bool m_started{false}; // Whether the workers have been forked
+    std::tuple<int, int> m_map_dimensions{};
+    int m_strip_count{};
+    int m_active_workers{}; // Workers with strips of the current map (the first m_active_workers of them)
+    std::vector<int> m_first_strips; // Active worker w owns strips m_first_strips[w] to m_first_strips[w + 1] - 1
+    std::vector<pid_t> m_workers;
+
+    // Only used in the coordinator: state of the pool the workers were last known to have (see run())
+    const OrganismPool* m_pool{nullptr};
+    std::uint64_t m_pool_changes{0};
+    std::uint64_t m_world_hash{0};
+    std::vector<std::unique_ptr<Channel>> m_control_channels; // m_control_channels[w] connects the coordinator (side 0) and worker w (side 1)
+    std::vector<std::unique_ptr<Channel>> m_neighbor_channels; // m_neighbor_channels[w] connects worker w (side 0) and worker w + 1 (side 1)
+
+    // Only used in worker processes:
+    int m_worker{-1}; // Which worker this process is, or -1 in the coordinator
+    std::vector<Organism*> m_sorted_organisms; // Organisms in this worker's strips plus halo copies, sorted by ID
+    std::vector<std::vector<Organism*>> m_owned_organisms; // m_owned_organisms[s] = organisms that strip (first strip + s) updates this iteration
+    std::vector<std::vector<Organism*>> m_nearby_organisms; // Same as ParallelEngine's, for this worker's strips
+    std::vector<Organism*> m_halo_organisms[2]; // Copies of the row across the boundary above/below, for this phase
+    std::vector<char> m_halo_was_alive[2]; // Whether each halo copy was alive when it arrived
+    FreeMaskGrid m_free_masks; // Living organisms in this worker's strips and halo copies, updated as organisms come and go
+
+    // Reused buffers
+    std::vector<char> m_message;
+    std::vector<OrganismRecord> m_records;
+
+    // Private methods:
+    static OrganismRecord makeRecord(const Organism* org);
+    static Organism* makeOrganism(const OrganismRecord& record);
+    static void appendRecord(std::vector<char>& message, const Organism* org);
+    static void readRecords(const std::vector<char>& message, std::size_t offset, std::vector<OrganismRecord>& records);
+
+    void assignStrips(const std::tuple<int, int>& map_dimensions); // Hand out the map's strips to as many workers as can have some
+    void load(const OrganismPool& organisms, const std::tuple<int, int>& map_dimensions); // Send every worker the map size and its organisms
+    void applyRecords(OrganismPool& organisms);
+
+    int getFirstRow(int worker) const;
+    int getEndRow(int worker) const;
+    int getBoundaryStrip(Direction direction) const; // This worker's strip next to the boundary in direction
+    Channel* getNeighborChannel(Direction direction, int& side) const; // nullptr if there's no worker in direction
+    void runWorker();
+    void loadWorker(OrganismPool& organisms, const std::tuple<int, int>& map_dimensions);
+    void runWorkerIteration(OrganismPool& organisms, long long iteration, bool send_state);
+    void exchangeHalos(OrganismPool& organisms, int phase);
+    void exchangeChanges(OrganismPool& organisms, int phase);
+
+    public:
+    /*
+    - process_count is the number of worker processes (fewer are used if the map has fewer strips than that)
+    - seed is what every strip's random engine gets seeded from (same as ParallelEngine)
+    - transport is "socket" or "shm" (see Channel::create())
+    */
+    ProcessEngine(int process_count, unsigned int seed, const std::string& transport);
+
+    /*
+    - Tell every worker to quit and wait for them
+    */
+    ~ProcessEngine();
+
+    ProcessEngine(const ProcessEngine&) = delete;
+    ProcessEngine& operator=(const ProcessEngine&) = delete;
+
+    /*
+    - Fork the worker processes. Engine::create() calls this, so the workers are forked before the program starts any other threads
+    - Quits (error 11) if a worker can't be started
+    */
+    void start();
+
+    std::string getName() const override;
+
+    void update(OrganismPool& organisms, const std::tuple<int, int>& map_dimensions, long long iteration) override;
+
+    void run(OrganismPool& organisms, const std::tuple<int, int>& map_dimensions, long long first_iteration, long long iteration_count) override;
+};
+
+#endif
@@ -0,0 +1,66 @@
+#include "ScenarioCache.h"
+
+static void addToHash(std::uint64_t& hash, const std::string& text){
+    for (unsigned char c : text){
+        hash ^= c;
+        hash *= 0x100000001B3ull;
+    }
+}
+
+std::uint64_t ScenarioCache::getContentHash(const std::string& map_text, const std::string& species_text){
+    std::uint64_t hash = 0xCBF29CE484222325ull;
+    addToHash(hash, map_text);
+    addToHash(hash, std::to_string(map_text.size()));
+    addToHash(hash, species_text);
+    return hash;
+}
+
+bool ScenarioCache::Entry::matches(const std::string& other_map_text, const std::string& other_species_text) const{
+    return map_text == other_map_text && species_text == other_species_text;
+}
+
+std::shared_ptr<const Ecosystem::Scenario> ScenarioCache::get(const std::string& map_text, const std::string& species_text, bool& hit){
+    std::uint64_t key = getContentHash(map_text, species_text);
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto cached = m_scenarios.find(key);
+        if (cached != m_scenarios.end() && cached->second.matches(map_text, species_text)){
+            m_hits++;
+            hit = true;
+            return cached->second.scenario;
+        }
+        m_misses++;
+    }
+
+    // Parse without holding the lock, so other jobs aren't held up. If two threads miss on the same scenario, the first one to finish wins
+    hit = false;
+    auto scenario = std::make_shared<Ecosystem::Scenario>();
+    Ecosystem::parseScenario(map_text, species_text, *scenario);
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto inserted = m_scenarios.insert({key, Entry{map_text, species_text, scenario}});
+    if (!inserted.second) // Either another thread got here first, or different texts have the same hash (then the cached one stays)
+        return inserted.first->second.matches(map_text, species_text) ? inserted.first->second.scenario : scenario;
+
+    m_insertion_order.push_back(key);
+    if (m_insertion_order.size() > MAX_SCENARIOS){
+        m_scenarios.erase(m_insertion_order.front());
+        m_insertion_order.pop_front();
+    }
+    return scenario;
+}
+
+int ScenarioCache::size(){
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_scenarios.size();
+}
+
+long long ScenarioCache::getHits(){
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_hits;
+}
+
+long long ScenarioCache::getMisses(){
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_misses;
+}
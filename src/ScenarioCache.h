@@ -0,0 +1,55 @@
+#ifndef SCENARIOCACHE_H
+#define SCENARIOCACHE_H
+
+#include "Ecosystem.h"
+
+#include <memory>
+#include <mutex>
+#include <deque>
+#include <unordered_map>
+
+/*
+Parsed scenarios (Ecosystem::Scenario), looked up by a hash of the map and species list text
+- Jobs that use the same files (or files with the same contents) only get parsed once
+- The hash is only 64 bits, so the texts are kept with each scenario and compared on every hit. Texts that collide with a cached scenario
+  are just parsed again (and not cached), so a collision can never hand a job the wrong world
+- Safe to use from several threads at once. Scenarios are shared and never change once they're in the cache
+- Holds at most MAX_SCENARIOS scenarios. When it's full, the oldest one is dropped
+*/
+class ScenarioCache {
+    public:
+    static constexpr int MAX_SCENARIOS = 64;
+
+    private:
+    struct Entry {
+        std::string map_text;
+        std::string species_text;
+        std::shared_ptr<const Ecosystem::Scenario> scenario;
+
+        bool matches(const std::string& other_map_text, const std::string& other_species_text) const;
+    };
+
+    std::mutex m_mutex;
+    std::unordered_map<std::uint64_t, Entry> m_scenarios;
+    std::deque<std::uint64_t> m_insertion_order; // Oldest first
+    long long m_hits{0};
+    long long m_misses{0};
+
+    public:
+    /*
+    - 64-bit FNV-1a hash of both texts (with the length of the map text mixed in, so moving text from one file to the other changes the hash)
+    */
+    static std::uint64_t getContentHash(const std::string& map_text, const std::string& species_text);
+
+    /*
+    - Get the scenario for these texts, parsing it if it isn't cached yet. hit is set to whether it was already cached
+    - Parsing errors go through Helper::quit() like loading from files does
+    */
+    std::shared_ptr<const Ecosystem::Scenario> get(const std::string& map_text, const std::string& species_text, bool& hit);
+
+    int size();
+    long long getHits();
+    long long getMisses();
+};
+
+#endif
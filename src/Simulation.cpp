@@ -0,0 +1,184 @@
+#include "Simulation.h"
+
+/*
+Makes Helper::quit() throw on this thread until it goes out of scope
+*/
+struct QuitThrowsScope {
+    bool m_quit_throws;
+    QuitThrowsScope() : m_quit_throws(Helper::getQuitThrows()) { Helper::setQuitThrows(true); }
+    ~QuitThrowsScope() { Helper::setQuitThrows(m_quit_throws); }
+};
+
+/*
+Swaps a simulation's random engine in as this thread's engine until it goes out of scope
+*/
+struct RandomEngineScope {
+    std::mt19937& m_random_engine;
+    explicit RandomEngineScope(std::mt19937& random_engine) : m_random_engine(random_engine) { std::swap(Helper::getRandomEngine(), m_random_engine); }
+    ~RandomEngineScope() { std::swap(Helper::getRandomEngine(), m_random_engine); }
+};
+
+static Ecosystem::Scenario makeScenario(const std::vector<Simulation::Species>& species, int width, int height, const char* cells){
+    // This runs before the constructor that sets up quitting by throwing, so it does that itself
+    QuitThrowsScope quit_throws;
+    if (width <= 0 || height <= 0 || width > std::numeric_limits<int>::max() / height){
+        std::cerr << "Error: a world can't be " << width << "x" << height << " cells\n";
+        Helper::quit(8);
+    }
+    if (!cells){
+        std::cerr << "Error: no cells given for a " << width << "x" << height << " world\n";
+        Helper::quit(8);
+    }
+
+    Ecosystem::Scenario scenario;
+    scenario.map_dimensions = {width, height};
+
+    // Same strings a species list would give (see Ecosystem::getSpeciesInfo()), so organisms are made and checked the same way
+    static const char* TYPE_NAMES[] = {"plant", "herbivore", "omnivore"};
+    for (const Simulation::Species& row : species){
+        std::string type_name = (row.type >= Organism::PlantEnum && row.type <= Organism::OmnivoreEnum) ? TYPE_NAMES[row.type] : "";
+        int extra = row.type == Organism::PlantEnum ? row.energy_points : row.vision_radius;
+        scenario.species_info[std::string(1, row.letter_id)] = std::make_tuple(type_name, std::to_string(row.health), std::to_string(extra));
+    }
+
+    for (int y_coord = 0; y_coord < height; y_coord++){
+        for (int x_coord = 0; x_coord < width; x_coord++){
+            char letter_id = cells[(y_coord * width) + x_coord];
+            if (letter_id != Simulation::EMPTY_CELL && letter_id != '\0')
+                scenario.organism_coords.push_back({letter_id, {x_coord, y_coord}});
+        }
+    }
+    return scenario;
+}
+
+Simulation::Simulation(const Ecosystem::Scenario& scenario, unsigned int seed, const std::string& engine)
+    : m_map_dimensions(scenario.map_dimensions), m_random_engine(seed) {
+    QuitThrowsScope quit_throws;
+    m_engine = Engine::create(engine, seed);
+    if (!m_engine){
+        std::cerr << "Error: unknown engine " << engine << '\n';
+        Helper::quit(8);
+    }
+
+    // Organism colors are random too, so they come from this simulation's engine
+    RandomEngineScope random_engine(m_random_engine);
+    Ecosystem::createOrganisms(scenario, m_organisms);
+}
+
+Simulation::Simulation(const std::vector<Species>& species, int width, int height, const char* cells, unsigned int seed, const std::string& engine)
+    : Simulation(makeScenario(species, width, height, cells), seed, engine) {}
+
+std::unique_ptr<Simulation> Simulation::fromText(const std::string& map_text, const std::string& species_text, unsigned int seed, const std::string& engine){
+    Ecosystem::Scenario scenario;
+    {
+        QuitThrowsScope quit_throws;
+        Ecosystem::parseScenario(map_text, species_text, scenario);
+    }
+    return std::unique_ptr<Simulation>(new Simulation(scenario, seed, engine));
+}
+
+// Setters & Getters:
+
+int Simulation::getWidth() const{
+    return std::get<0>(m_map_dimensions);
+}
+
+int Simulation::getHeight() const{
+    return std::get<1>(m_map_dimensions);
+}
+
+long long Simulation::getIteration() const{
+    return m_iteration;
+}
+
+std::string Simulation::getEngineName() const{
+    return m_engine->getName();
+}
+
+std::uint64_t Simulation::getWorldHash() const{
+    return m_organisms.getWorldHash();
+}
+
+const OrganismPool& Simulation::getOrganisms() const{
+    return m_organisms;
+}
+
+const char* Simulation::getCellLetters(){
+    updateViews();
+    return m_cell_letters.data();
+}
+
+const int* Simulation::getCellHealth(){
+    updateViews();
+    return m_cell_health.data();
+}
+
+const int* Simulation::getPopulationCounts(){
+    m_population_counts.resize(128);
+    for (int letter_id = 0; letter_id < m_population_counts.size(); letter_id++)
+        m_population_counts[letter_id] = m_organisms.getLiveCount(letter_id);
+    return m_population_counts.data();
+}
+
+const std::uint32_t* Simulation::getPlantCells() const{
+    const PlantLayer& plant_layer = m_organisms.getPlantLayer();
+    return plant_layer.empty() ? nullptr : plant_layer.getCells();
+}
+
+const std::vector<PlantLayer::Species>& Simulation::getPlantSpecies() const{
+    return m_organisms.getPlantLayer().getSpeciesTable();
+}
+
+int Simulation::getPopulation(char letter_id) const{
+    return (letter_id >= 0 && letter_id < 128) ? m_organisms.getLiveCount(letter_id) : 0;
+}
+
+int Simulation::getLiveAnimals() const{
+    return m_organisms.getLiveCount(Organism::HerbivoreEnum) + m_organisms.getLiveCount(Organism::OmnivoreEnum);
+}
+
+int Simulation::getLivePlants() const{
+    return m_organisms.getLiveCount(Organism::PlantEnum);
+}
+
+// Private methods:
+
+void Simulation::updateViews(){
+    if (m_views_iteration == m_iteration)
+        return;
+    m_views_iteration = m_iteration;
+
+    int width = getWidth();
+    m_cell_letters.assign(width * getHeight(), EMPTY_CELL);
+    m_cell_health.assign(width * getHeight(), 0);
+
+    auto addLiveOrganism = [&](char letter_id, const std::tuple<int, int>& coords, int health) {
+        int cell = (std::get<1>(coords) * width) + std::get<0>(coords);
+        m_cell_letters[cell] = letter_id;
+        m_cell_health[cell] = health;
+    };
+
+    for (const Organism* org : m_organisms.getOrganisms()){
+        if (org->isAlive())
+            addLiveOrganism(org->getLetterID(), org->getCoords(), org->getCurrentHealth());
+    }
+
+    // Engines that keep plants in a layer (see LayeredEngine)
+    const PlantLayer& plant_layer = m_organisms.getPlantLayer();
+    for (int cell = 0; cell < plant_layer.getWidth() * plant_layer.getHeight(); cell++){
+        if (plant_layer.hasPlant(cell) && plant_layer.isAlive(cell))
+            addLiveOrganism(plant_layer.getSpecies(cell).letter_id, plant_layer.getCoords(cell), plant_layer.getCurrentHealth(cell));
+    }
+}
+
+// Methods:
+
+void Simulation::step(long long iterations){
+    if (iterations <= 0)
+        return;
+
+    QuitThrowsScope quit_throws;
+    RandomEngineScope random_engine(m_random_engine);
+    m_engine->run(m_organisms, m_map_dimensions, m_iteration + 1, iterations);
+    m_iteration += iterations;
+}
@@ -0,0 +1,114 @@
+#ifndef SIMULATION_H
+#define SIMULATION_H
+
+#include "Engine.h"
+
+/*
+A whole simulation in one object, for programs that embed the engine (libecosystem) instead of running ecosystem.bin
+- Worlds are made straight from memory: a species table and a row-major array of cell letters, or the text of a map and a species list.
+  Nothing is read from or written to files or the terminal
+- Every simulation has its own random engine, which is swapped in while it's being made or stepped. The same seed always gives the same
+  world, even with several simulations taking turns on one thread (results match ./bench.bin hash and the job service for the same seed)
+- Errors that would quit ecosystem.bin throw Helper::QuitError instead (the error message still goes to std::cerr)
+- Population counts and getWorldHash() are kept up to date as the world changes (see OrganismPool::getLiveCount()), so they cost nothing
+- Plants in a plant layer (the layered and hybrid engines) can be read straight from the layer with getPlantCells(), without a copy
+- getCellLetters() and getCellHealth() aren't views of the engine's own data: organisms live in a pool, not in dense per-cell arrays, so
+  the first one asked for after a step copies the whole world into arrays the simulation owns, which costs O(width * height)
+- Pointers returned by any of these stay valid until the next step() or until the simulation is destroyed
+*/
+class Simulation {
+    public:
+    static constexpr char EMPTY_CELL = ' ';
+
+    /*
+    One row of a species list
+    */
+    struct Species {
+        char letter_id;
+        Organism::OrganismType type;
+        int health;
+        int energy_points{0}; // Plants only
+        int vision_radius{0}; // Animals only
+    };
+
+    private:
+    std::tuple<int, int> m_map_dimensions;
+    OrganismPool m_organisms;
+    std::unique_ptr<Engine> m_engine;
+    std::mt19937 m_random_engine;
+    long long m_iteration{0};
+
+    // Cell views, rebuilt by updateViews() when m_views_iteration falls behind
+    long long m_views_iteration{-1};
+    std::vector<char> m_cell_letters;
+    std::vector<int> m_cell_health;
+    std::vector<int> m_population_counts; // Indexed by letter ID, copied from the pool's counts
+
+    // Private methods:
+    Simulation(const Ecosystem::Scenario& scenario, unsigned int seed, const std::string& engine);
+    void updateViews();
+
+    public:
+    /*
+    - Make a world of width x height cells from cells[(y * width) + x]: the letter ID of the organism in each cell, or EMPTY_CELL (or '\0')
+    - engine is any name Engine::create() understands
+    - Throws Helper::QuitError if a species is missing or invalid, the engine isn't known, width or height isn't positive, or cells is nullptr
+    */
+    Simulation(const std::vector<Species>& species, int width, int height, const char* cells, unsigned int seed = 1, const std::string& engine = "reference");
+
+    /*
+    - Same as above, from the text of a map file and a species list
+    */
+    static std::unique_ptr<Simulation> fromText(const std::string& map_text, const std::string& species_text, unsigned int seed = 1, const std::string& engine = "reference");
+
+    Simulation(const Simulation&) = delete;
+    Simulation& operator=(const Simulation&) = delete;
+
+    // Setters & Getters:
+
+    int getWidth() const;
+    int getHeight() const;
+    long long getIteration() const; // Iterations run so far
+    std::string getEngineName() const;
+    std::uint64_t getWorldHash() const;
+
+    /*
+    - Every organism in the world (see OrganismPool). Read it, don't change it
+    */
+    const OrganismPool& getOrganisms() const;
+
+    /*
+    - Letter ID of the living organism in each cell, or EMPTY_CELL, as getWidth() * getHeight() chars in row-major order (not null-terminated)
+    */
+    const char* getCellLetters();
+
+    /*
+    - Health of the living organism in each cell (0 if there isn't one), in the same order as getCellLetters()
+    */
+    const int* getCellHealth();
+
+    /*
+    - Living organisms of each species, indexed by letter ID (128 entries)
+    */
+    const int* getPopulationCounts();
+
+    /*
+    - Cells of the plant layer (see PlantLayer for their layout), getWidth() * getHeight() of them, or nullptr if no plants are kept in one
+    - Species indexes in the cells point into getPlantSpecies()
+    */
+    const std::uint32_t* getPlantCells() const;
+    const std::vector<PlantLayer::Species>& getPlantSpecies() const;
+
+    int getPopulation(char letter_id) const;
+    int getLiveAnimals() const;
+    int getLivePlants() const;
+
+    // Methods:
+
+    /*
+    - Run iterations iterations
+    */
+    void step(long long iterations = 1);
+};
+
+#endif
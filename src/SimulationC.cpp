@@ -0,0 +1,119 @@
+#include "SimulationC.h"
+#include "Simulation.h"
+
+#include <cstddef>
+
+struct ecosystem_simulation {
+    std::unique_ptr<Simulation> simulation;
+};
+
+// Plant cells and species are handed out as they are, so the C layout has to match PlantLayer's
+static_assert(ECOSYSTEM_PLANT_SPECIES_MASK == PlantLayer::SPECIES_MASK && ECOSYSTEM_PLANT_ALIVE_BIT == PlantLayer::ALIVE_BIT
+    && ECOSYSTEM_PLANT_COUNTDOWN_SHIFT == PlantLayer::COUNTDOWN_SHIFT, "plant cell layout doesn't match PlantLayer");
+static_assert(sizeof(ecosystem_plant_species) == sizeof(PlantLayer::Species)
+    && offsetof(ecosystem_plant_species, energy_points) == offsetof(PlantLayer::Species, energy_points)
+    && offsetof(ecosystem_plant_species, regrowth_coefficient) == offsetof(PlantLayer::Species, regrowth_coefficient), "plant species don't match PlantLayer");
+
+/*
+Run fn, turning anything it throws into an error code
+*/
+template <typename Function>
+static int catchErrors(Function fn){
+    try {
+        fn();
+        return 0;
+    } catch (const Helper::QuitError& error) {
+        return error.error_code;
+    } catch (const std::bad_alloc&) {
+        std::cerr << "Error: out of memory\n";
+    } catch (const std::exception& error) {
+        std::cerr << "Error: " << error.what() << '\n';
+    }
+    return -1;
+}
+
+extern "C" {
+
+int ecosystem_create(const ecosystem_species* species, int species_count, int width, int height, const char* cells,
+    unsigned int seed, const char* engine, ecosystem_simulation** simulation){
+    *simulation = nullptr;
+    if (species_count < 0 || (species_count > 0 && !species)){
+        std::cerr << "Error: no species given for a list of " << species_count << '\n';
+        return 8;
+    }
+    return catchErrors([&] {
+        std::vector<Simulation::Species> species_table;
+        for (int i = 0; i < species_count; i++)
+            species_table.push_back({species[i].letter_id, static_cast<Organism::OrganismType>(species[i].type), species[i].health, species[i].energy_points, species[i].vision_radius});
+        *simulation = new ecosystem_simulation{std::make_unique<Simulation>(species_table, width, height, cells, seed, engine ? engine : "reference")};
+    });
+}
+
+int ecosystem_create_from_text(const char* map_text, const char* species_text, unsigned int seed, const char* engine, ecosystem_simulation** simulation){
+    *simulation = nullptr;
+    return catchErrors([&] {
+        *simulation = new ecosystem_simulation{Simulation::fromText(map_text, species_text, seed, engine ? engine : "reference")};
+    });
+}
+
+void ecosystem_destroy(ecosystem_simulation* simulation){
+    delete simulation;
+}
+
+int ecosystem_step(ecosystem_simulation* simulation, long long iterations){
+    return catchErrors([&] { simulation->simulation->step(iterations); });
+}
+
+int ecosystem_get_width(const ecosystem_simulation* simulation){
+    return simulation->simulation->getWidth();
+}
+
+int ecosystem_get_height(const ecosystem_simulation* simulation){
+    return simulation->simulation->getHeight();
+}
+
+long long ecosystem_get_iteration(const ecosystem_simulation* simulation){
+    return simulation->simulation->getIteration();
+}
+
+uint64_t ecosystem_get_world_hash(const ecosystem_simulation* simulation){
+    return simulation->simulation->getWorldHash();
+}
+
+const char* ecosystem_get_cell_letters(ecosystem_simulation* simulation){
+    const char* cell_letters = nullptr;
+    catchErrors([&] { cell_letters = simulation->simulation->getCellLetters(); });
+    return cell_letters;
+}
+
+const int* ecosystem_get_cell_health(ecosystem_simulation* simulation){
+    const int* cell_health = nullptr;
+    catchErrors([&] { cell_health = simulation->simulation->getCellHealth(); });
+    return cell_health;
+}
+
+const int* ecosystem_get_population_counts(ecosystem_simulation* simulation){
+    const int* population_counts = nullptr;
+    catchErrors([&] { population_counts = simulation->simulation->getPopulationCounts(); });
+    return population_counts;
+}
+
+int ecosystem_get_live_animals(ecosystem_simulation* simulation){
+    return simulation->simulation->getLiveAnimals();
+}
+
+int ecosystem_get_live_plants(ecosystem_simulation* simulation){
+    return simulation->simulation->getLivePlants();
+}
+
+const uint32_t* ecosystem_get_plant_cells(const ecosystem_simulation* simulation){
+    return simulation->simulation->getPlantCells();
+}
+
+const ecosystem_plant_species* ecosystem_get_plant_species(const ecosystem_simulation* simulation, int* count){
+    const std::vector<PlantLayer::Species>& species = simulation->simulation->getPlantSpecies();
+    *count = species.size();
+    return reinterpret_cast<const ecosystem_plant_species*>(species.data());
+}
+
+}
@@ -0,0 +1,107 @@
+#ifndef SIMULATIONC_H
+#define SIMULATIONC_H
+
+#include <stdint.h>
+
+/*
+Plain C interface to Simulation, for programs that link libecosystem but aren't written in C++
+- Functions that can fail return an error code (see Helper::quit() for what they mean) instead of quitting, and 0 on success
+- Views (ecosystem_get_cell_letters() etc.) point into the simulation and stay valid until the next ecosystem_step() or ecosystem_destroy().
+  Counts and plant cells come straight from what the engine keeps up to date. Cell letters and health are copies: the first one asked for
+  after a step is rebuilt from the whole world, in O(width * height)
+- A simulation must only be used by one thread at a time
+*/
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct ecosystem_simulation ecosystem_simulation;
+
+enum {
+    ECOSYSTEM_PLANT = 0,
+    ECOSYSTEM_HERBIVORE = 1,
+    ECOSYSTEM_OMNIVORE = 2
+};
+
+/* Layout of a plant cell (see ecosystem_get_plant_cells()) */
+enum {
+    ECOSYSTEM_PLANT_SPECIES_MASK = 0xFF, /* Index into ecosystem_get_plant_species() + 1, 0 if there's no plant */
+    ECOSYSTEM_PLANT_ALIVE_BIT = 0x100,
+    ECOSYSTEM_PLANT_COUNTDOWN_SHIFT = 9 /* Iterations until a dead plant is fully grown are value >> this */
+};
+
+typedef struct ecosystem_species {
+    char letter_id;
+    int type; /* ECOSYSTEM_PLANT, ECOSYSTEM_HERBIVORE or ECOSYSTEM_OMNIVORE */
+    int health;
+    int energy_points; /* Plants only */
+    int vision_radius; /* Animals only */
+} ecosystem_species;
+
+typedef struct ecosystem_plant_species {
+    char letter_id;
+    int energy_points;
+    int regrowth_coefficient; /* Max health */
+} ecosystem_plant_species;
+
+/*
+- Make a world of width x height cells from cells[(y * width) + x]: the letter ID of the organism in each cell, or ' ' (or '\0') if it's empty
+- engine is any engine name ecosystem.bin understands ("reference" if NULL)
+- Puts the new simulation in *simulation and returns 0, or returns an error code and leaves *simulation NULL. width and height must be
+  positive, cells can't be NULL, and species can only be NULL if species_count is 0 (error 8 otherwise)
+*/
+int ecosystem_create(const ecosystem_species* species, int species_count, int width, int height, const char* cells,
+    unsigned int seed, const char* engine, ecosystem_simulation** simulation);
+
+/*
+- Same as above, from the text of a map file and a species list (null-terminated)
+*/
+int ecosystem_create_from_text(const char* map_text, const char* species_text, unsigned int seed, const char* engine, ecosystem_simulation** simulation);
+
+void ecosystem_destroy(ecosystem_simulation* simulation);
+
+/*
+- Run iterations iterations. Returns 0, or an error code
+*/
+int ecosystem_step(ecosystem_simulation* simulation, long long iterations);
+
+int ecosystem_get_width(const ecosystem_simulation* simulation);
+int ecosystem_get_height(const ecosystem_simulation* simulation);
+long long ecosystem_get_iteration(const ecosystem_simulation* simulation);
+uint64_t ecosystem_get_world_hash(const ecosystem_simulation* simulation);
+
+/*
+- Letter ID of the living organism in each cell or ' ', width * height chars in row-major order (not null-terminated)
+- This, ecosystem_get_cell_health() and ecosystem_get_population_counts() return NULL if they run out of memory
+*/
+const char* ecosystem_get_cell_letters(ecosystem_simulation* simulation);
+
+/*
+- Health of the living organism in each cell (0 if there isn't one), in the same order as the letters
+*/
+const int* ecosystem_get_cell_health(ecosystem_simulation* simulation);
+
+/*
+- Living organisms of each species, indexed by letter ID (128 entries)
+*/
+const int* ecosystem_get_population_counts(ecosystem_simulation* simulation);
+
+int ecosystem_get_live_animals(ecosystem_simulation* simulation);
+int ecosystem_get_live_plants(ecosystem_simulation* simulation);
+
+/*
+- Plant layer cells, width * height 32-bit words in row-major order (see ECOSYSTEM_PLANT_*). These are the engine's own cells, not a copy
+- NULL if no plants are kept in a layer. Only the "layered" and "hybrid" engines keep them there
+*/
+const uint32_t* ecosystem_get_plant_cells(const ecosystem_simulation* simulation);
+
+/*
+- Species table the plant cells' species indexes point into. Puts the number of entries in *count
+*/
+const ecosystem_plant_species* ecosystem_get_plant_species(const ecosystem_simulation* simulation, int* count);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,264 @@
+#include "SimulationController.h"
+
+const std::string SimulationController::COMMANDS_HELP =
+    "Commands: run | pause | step [n] | speed <ms> | ff <n> | branch <n> <perturbations>... | quit\n";
+
+SimulationController::SimulationController(OrganismPool& organisms, const std::tuple<int, int>& map_dimensions, Engine& engine, unsigned int engine_seed,
+    bool count_hardware_events)
+    : m_organisms(organisms), m_map_dimensions(map_dimensions), m_engine(engine), m_engine_seed(engine_seed), m_count_hardware_events(count_hardware_events) {
+    m_steady_state_detector.record(m_organisms, m_total_iterations);
+    m_simulation_thread = std::thread(&SimulationController::simulationLoop, this);
+}
+
+SimulationController::~SimulationController(){
+    quit();
+    join();
+}
+
+// Commands:
+
+void SimulationController::run(){
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_running = true;
+    m_steps_left = 0;
+    m_command_count++;
+    m_control_changed.notify_all();
+}
+
+void SimulationController::pause(){
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_running = false;
+    m_steps_left = 0;
+    m_fast_forward_left = 0;
+    m_command_count++;
+    m_control_changed.notify_all();
+}
+
+void SimulationController::step(long long iterations){
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_running = false;
+    m_steps_left = iterations;
+    m_command_count++;
+    m_control_changed.notify_all();
+}
+
+void SimulationController::setSpeed(int sleep_time){
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_sleep_time = sleep_time;
+    m_command_count++;
+    m_control_changed.notify_all();
+}
+
+void SimulationController::fastForward(long long iterations){
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_running = false;
+    m_steps_left = 0;
+    m_fast_forward_left = iterations;
+    m_command_count++;
+    m_control_changed.notify_all();
+}
+
+void SimulationController::quit(){
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_quitting = true;
+    m_command_count++;
+    m_control_changed.notify_all();
+}
+
+void SimulationController::branch(const std::vector<std::vector<WorldBrancher::Perturbation>>& branch_perturbations, long long iterations){
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_pending_branches.push_back({branch_perturbations, iterations});
+    m_command_count++;
+    m_control_changed.notify_all();
+}
+
+bool SimulationController::handleCommand(const std::string& command_line){
+    std::istringstream iss(command_line);
+    std::string command;
+    if (!(iss >> command))
+        return true; // Empty line, nothing to do
+
+    long long amount = 0;
+    bool has_amount = static_cast<bool>(iss >> amount);
+
+    if ((command == "run" || command == "resume") && !has_amount)
+        run();
+    else if (command == "pause" && !has_amount)
+        pause();
+    else if (command == "step" && (!has_amount || amount > 0))
+        step(has_amount ? amount : 1);
+    else if (command == "speed" && has_amount && amount >= 0)
+        setSpeed(amount);
+    else if (command == "ff" && has_amount && amount > 0)
+        fastForward(amount);
+    else if (command == "quit" && !has_amount)
+        quit();
+    else if (command == "branch" && has_amount && amount > 0){
+        // Every word after the number of iterations is one branch
+        std::vector<std::vector<WorldBrancher::Perturbation>> branch_perturbations;
+        std::string perturbations_text;
+        while (iss >> perturbations_text){
+            branch_perturbations.emplace_back();
+            if (!WorldBrancher::parsePerturbations(perturbations_text, branch_perturbations.back())){
+                std::cout << WorldBrancher::PERTURBATIONS_HELP;
+                return false;
+            }
+        }
+        if (branch_perturbations.empty())
+            return false;
+        branch(branch_perturbations, amount);
+    }
+    else
+        return false;
+
+    return true;
+}
+
+void SimulationController::join(){
+    if (m_simulation_thread.joinable())
+        m_simulation_thread.join();
+}
+
+// Simulation thread:
+
+long long SimulationController::runIteration(long long remaining_in_batch){
+    m_total_iterations++;
+    auto start = std::chrono::steady_clock::now();
+    m_engine.update(m_organisms, m_map_dimensions, m_total_iterations);
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    if (!m_reported_memory_limit && m_organisms.getPlantLayer().isOverMemoryLimit()){
+        m_reported_memory_limit = true;
+        m_status_message = "Plant tiles near animals take more than the memory limit, and they're kept in memory anyway.";
+    }
+
+    // If the ecosystem is stuck in a cycle, skip as many whole cycles of the rest of the batch as possible. The end result is the same
+    long long skipped_iterations = 0;
+    if (m_steady_state_detector.record(m_organisms, m_total_iterations) > 0){
+        m_status_message = "Ecosystem has reached a steady state.";
+        skipped_iterations = m_steady_state_detector.getSkippableIterations(remaining_in_batch);
+        if (skipped_iterations > 0){
+            m_total_iterations += skipped_iterations;
+            m_status_message += " Skipped " + std::to_string(skipped_iterations) + " iterations.";
+            m_steady_state_detector.reset(); // Iterations were skipped, so the history no longer lines up
+            m_steady_state_detector.record(m_organisms, m_total_iterations);
+        }
+    }
+
+    Metrics::recordIteration(m_organisms, m_total_iterations - skipped_iterations, seconds, skipped_iterations);
+    return skipped_iterations;
+}
+
+void SimulationController::display(const std::string& state){
+    Helper::clearScreen();
+    std::cout << "Iteration " << m_total_iterations << " (" << state << ")\n";
+    if (!m_status_message.empty())
+        std::cout << m_status_message << '\n';
+    Ecosystem::printEcosystem(m_organisms.getOrganisms(), m_map_dimensions, &m_organisms.getPlantLayer());
+    std::cout << COMMANDS_HELP << "> " << std::flush;
+}
+
+void SimulationController::startBranches(const std::vector<BranchRequest>& requests){
+    int still_running = m_brancher.reapBranches();
+    std::string reason;
+    for (const BranchRequest& request : requests){
+        if (!WorldBrancher::canBranch(m_organisms, m_engine.getName(), request.branch_perturbations, reason)){
+            m_status_message = "Can't branch: " + reason + '.';
+            return;
+        }
+    }
+
+    std::string stats_prefix = "branch-" + std::to_string(m_total_iterations);
+    if (m_branch_iteration != m_total_iterations){
+        m_branch_iteration = m_total_iterations;
+        m_branches_at_iteration = 0;
+    }
+    std::vector<std::filesystem::path> stats_files;
+    for (const BranchRequest& request : requests){
+        std::vector<std::filesystem::path> request_stats_files = m_brancher.startBranches(m_organisms, m_map_dimensions, m_engine.getName(), m_engine_seed, m_total_iterations, request.iterations,
+            request.branch_perturbations, stats_prefix, m_branches_at_iteration + 1);
+        m_branches_at_iteration += request_stats_files.size();
+        stats_files.insert(stats_files.end(), request_stats_files.begin(), request_stats_files.end());
+    }
+
+    m_status_message = "Started " + std::to_string(stats_files.size()) + " branch(es) at iteration " + std::to_string(m_total_iterations)
+        + " (stats in " + stats_files.front().string() + (stats_files.size() > 1 ? " to " + stats_files.back().string() : "") + ")";
+    if (still_running > 0)
+        m_status_message += ". " + std::to_string(still_running) + " earlier branch(es) still running";
+    m_status_message += '.';
+}
+
+void SimulationController::simulationLoop(){
+    // Counters only count the thread that starts them, so they're started here rather than in the constructor
+    if (m_count_hardware_events && !PerfCounters::start())
+        m_status_message = "Hardware counters unavailable: " + PerfCounters::getUnavailableReason();
+    display("paused");
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (true){
+        // Sleep until there's something to do
+        m_control_changed.wait(lock, [this] { return m_quitting || m_running || m_steps_left > 0 || m_fast_forward_left > 0 || !m_pending_branches.empty(); });
+        if (m_quitting){
+            int running_branches = m_brancher.reapBranches();
+            if (running_branches > 0)
+                std::cout << "Waiting for " << running_branches << " branch(es) to finish\n" << std::flush;
+            PerfCounters::stop();
+            return;
+        }
+
+        // Branch from the world as it is between iterations
+        if (!m_pending_branches.empty()){
+            std::vector<BranchRequest> requests;
+            requests.swap(m_pending_branches);
+            bool idle = !m_running && m_steps_left == 0 && m_fast_forward_left == 0;
+            lock.unlock();
+            startBranches(requests);
+            if (idle)
+                display("paused");
+            lock.lock();
+            continue;
+        }
+
+        // Fast forward: run iterations back to back and only display the last one
+        // The lock is only taken between iterations, so commands still take effect at the next iteration boundary
+        if (m_fast_forward_left > 0){
+            long long remaining = --m_fast_forward_left;
+            lock.unlock();
+            long long skipped_iterations = runIteration(remaining);
+            lock.lock();
+
+            m_fast_forward_left = std::max(0LL, m_fast_forward_left - skipped_iterations);
+            if (m_fast_forward_left == 0){
+                lock.unlock();
+                display("paused");
+                lock.lock();
+            }
+            continue;
+        }
+
+        // Step/run: display every iteration and pause between them
+        bool stepping = m_steps_left > 0;
+        long long remaining = stepping ? --m_steps_left : 0;
+        lock.unlock();
+        long long skipped_iterations = runIteration(remaining);
+        bool steady = m_steady_state_detector.getPeriod() > 0;
+        lock.lock();
+
+        if (stepping)
+            m_steps_left = std::max(0LL, m_steps_left - skipped_iterations);
+        else if (steady)
+            m_running = false; // Running forever won't change anything anymore
+
+        bool keep_going = m_running || m_steps_left > 0;
+        int sleep_time = m_sleep_time;
+        lock.unlock();
+        display(keep_going ? "running, " + std::to_string(sleep_time) + " ms between iterations" : "paused");
+        lock.lock();
+
+        // Pause between iterations, but stop pausing as soon as a command comes in
+        if (keep_going){
+            unsigned long long command_count = m_command_count;
+            m_control_changed.wait_for(lock, std::chrono::milliseconds(sleep_time), [&] { return m_command_count != command_count; });
+        }
+    }
+}
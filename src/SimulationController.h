@@ -0,0 +1,106 @@
+#ifndef SIMULATIONCONTROLLER_H
+#define SIMULATIONCONTROLLER_H
+
+#include "Ecosystem.h"
+#include "Engine.h"
+#include "WorldBrancher.h"
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+/*
+Runs the simulation on its own thread so it can be controlled while it's running
+- Commands (see handleCommand()) can be sent from any thread and take effect at the next iteration boundary
+- While there's nothing to do, the simulation thread sleeps on a condition variable, so an idle simulation doesn't use any CPU
+- Pauses between iterations are also waits on that condition variable, so commands interrupt them right away
+- "branch" forks the world into what-if branches (see WorldBrancher) at the next iteration boundary. The simulation itself carries on.
+  Branches run the same kind of engine with the same seed, so they're refused when WorldBrancher::canBranch() says they can't
+- Iterations are run by an Engine, so the simulation can use any of them. If the plant layer has a backing file and the tiles near animals
+  alone take more than its memory limit, the status line says so once
+*/
+class SimulationController {
+    public:
+    static constexpr int DEFAULT_SLEEP_TIME = 100; // Pause between displayed iterations (in milliseconds)
+
+    static const std::string COMMANDS_HELP;
+
+    private:
+    struct BranchRequest {
+        std::vector<std::vector<WorldBrancher::Perturbation>> branch_perturbations; // One entry per branch
+        long long iterations{}; // Iterations each of those branches runs
+    };
+
+    OrganismPool& m_organisms;
+    const std::tuple<int, int> m_map_dimensions;
+    Engine& m_engine;
+    unsigned int m_engine_seed; // Seed engine was made with, so branches can make the same kind of engine
+    long long m_total_iterations{0};
+    SteadyStateDetector m_steady_state_detector;
+    std::string m_status_message; // Extra line shown under the iteration counter
+    bool m_count_hardware_events{false};
+    bool m_reported_memory_limit{false}; // Whether the status line has said that the plant layer went over its memory limit
+
+    // Control state. Protected by m_mutex
+    std::mutex m_mutex;
+    std::condition_variable m_control_changed; // Signalled whenever any of the control state below changes
+    bool m_running{false}; // Keep running iterations until paused
+    long long m_steps_left{0}; // Iterations left to run (and display) before pausing
+    long long m_fast_forward_left{0}; // Iterations left to run without displaying them or pausing between them
+    int m_sleep_time{DEFAULT_SLEEP_TIME};
+    bool m_quitting{false};
+    unsigned long long m_command_count{0}; // Bumped by every command, so pauses between iterations can tell when to stop waiting
+    std::vector<BranchRequest> m_pending_branches; // Every branch() since the last iteration boundary, started at the next one
+
+    long long m_branch_iteration{-1}; // Iteration the last branches were started at
+    int m_branches_at_iteration{0}; // Branches started at m_branch_iteration, so later ones there get stats files of their own
+    WorldBrancher m_brancher; // Only used by the simulation thread. Made before it, so branches are waited for after it ends
+    std::thread m_simulation_thread;
+
+    // Private methods:
+    void simulationLoop();
+    long long runIteration(long long remaining_in_batch); // Run 1 iteration, then skip ahead if a steady state has been reached. Returns number of iterations skipped
+    void display(const std::string& state);
+    void startBranches(const std::vector<BranchRequest>& requests);
+
+    public:
+    /*
+    - Iterations are run with engine, which has to outlive the controller. engine_seed is the seed it was made with
+    - With count_hardware_events, the simulation thread runs PerfCounters from when it starts until it ends (see PerfCounters::getReport())
+    */
+    SimulationController(OrganismPool& organisms, const std::tuple<int, int>& map_dimensions, Engine& engine, unsigned int engine_seed,
+        bool count_hardware_events = false);
+    ~SimulationController();
+
+    SimulationController(const SimulationController&) = delete;
+    SimulationController& operator=(const SimulationController&) = delete;
+
+    // Commands:
+
+    void run(); // Run iterations until paused
+    void pause(); // Stop after the current iteration
+    void step(long long iterations); // Run iterations iterations (displaying each one), then pause
+    void setSpeed(int sleep_time); // Set pause between displayed iterations (in milliseconds)
+    void fastForward(long long iterations); // Run iterations iterations as fast as possible, display the result, then pause
+    void quit(); // Stop after the current iteration and end the simulation thread
+
+    /*
+    - At the next iteration boundary, start one branch per entry of branch_perturbations, each running iterations iterations
+    - Branches write their stats to branch-<iteration>-<k>.csv in the current directory. If branch() is called more than once before that
+      boundary (or at the same iteration), every call keeps its own iterations, and k keeps counting up across them
+    */
+    void branch(const std::vector<std::vector<WorldBrancher::Perturbation>>& branch_perturbations, long long iterations);
+
+    /*
+    - Parse a command typed by the user and run it (see COMMANDS_HELP)
+    - Returns false if the command wasn't recognized
+    */
+    bool handleCommand(const std::string& command_line);
+
+    /*
+    - Wait until the simulation thread has ended (after quit())
+    */
+    void join();
+};
+
+#endif
@@ -0,0 +1,66 @@
+#include "SpatialIndex.h"
+
+int SpatialIndex::getDistance(const std::tuple<int, int>& a, const std::tuple<int, int>& b){
+    return std::abs(std::get<0>(a) - std::get<0>(b)) + std::abs(std::get<1>(a) - std::get<1>(b));
+}
+
+int SpatialIndex::getBucket(int x_coord, int y_coord) const{
+    int bucket_x = std::clamp(x_coord / BUCKET_SIZE, 0, m_buckets_x - 1);
+    int bucket_y = std::clamp(y_coord / BUCKET_SIZE, 0, m_buckets_y - 1);
+    return (bucket_y * m_buckets_x) + bucket_x;
+}
+
+void SpatialIndex::build(const std::vector<Organism*>& organisms, const std::tuple<int, int>& map_dimensions){
+    m_width = std::get<0>(map_dimensions);
+    m_height = std::get<1>(map_dimensions);
+    m_buckets_x = std::max(1, (m_width + BUCKET_SIZE - 1) / BUCKET_SIZE);
+    m_buckets_y = std::max(1, (m_height + BUCKET_SIZE - 1) / BUCKET_SIZE);
+
+    // Count organisms in each bucket, turn the counts into start positions, then drop each organism into place
+    m_bucket_starts.assign((m_buckets_x * m_buckets_y) + 1, 0);
+    m_entry_buckets.resize(organisms.size());
+    for (int i = 0; i < organisms.size(); i++){
+        std::tuple<int, int> coords = organisms[i]->getCoords();
+        m_entry_buckets[i] = getBucket(std::get<0>(coords), std::get<1>(coords));
+        m_bucket_starts[m_entry_buckets[i] + 1]++;
+    }
+    for (int bucket = 0; bucket < m_buckets_x * m_buckets_y; bucket++)
+        m_bucket_starts[bucket + 1] += m_bucket_starts[bucket];
+
+    // Organisms keep their pool order within a bucket
+    m_entries.resize(organisms.size());
+    for (int i = 0; i < organisms.size(); i++)
+        m_entries[m_bucket_starts[m_entry_buckets[i]]++] = organisms[i];
+
+    // The loop above moved every bucket's start up to where the next bucket starts, so move them back
+    for (int bucket = m_buckets_x * m_buckets_y; bucket > 0; bucket--)
+        m_bucket_starts[bucket] = m_bucket_starts[bucket - 1];
+    m_bucket_starts[0] = 0;
+}
+
+bool SpatialIndex::empty() const{
+    return m_entries.empty();
+}
+
+void SpatialIndex::findWithin(const std::tuple<int, int>& center, int radius, std::vector<Organism*>& found) const{
+    forEachWithin(center, radius, [&](Organism* org) { found.push_back(org); });
+}
+
+Organism* SpatialIndex::findNearestOfType(const std::tuple<int, int>& center, int radius, Organism::OrganismType type) const{
+    return findNearest(center, radius, [type](const Organism* org) { return org->getType() == type; });
+}
+
+Organism* SpatialIndex::findNearestPrey(const Organism* hunter, int radius) const{
+    return findNearest(hunter->getCoords(), radius, [hunter](const Organism* org) { return org != hunter && hunter->isPredatorTo(org); });
+}
+
+Organism* SpatialIndex::findNearestPredator(const Organism* prey, int radius) const{
+    return findNearest(prey->getCoords(), radius, [prey](const Organism* org) { return org != prey && org->isPredatorTo(prey); });
+}
+
+void SpatialIndex::findPredatorsWithin(const Organism* prey, int radius, std::vector<Organism*>& found) const{
+    forEachWithin(prey->getCoords(), radius, [&](Organism* org) {
+        if (org != prey && org->isPredatorTo(prey))
+            found.push_back(org);
+    });
+}
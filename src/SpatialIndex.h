@@ -0,0 +1,146 @@
+#ifndef SPATIALINDEX_H
+#define SPATIALINDEX_H
+
+#include "Organism.h"
+
+#include <vector>
+#include <tuple>
+#include <cstdlib>
+
+/*
+Bucketed grid of organisms for answering "what's near this cell?" without looking through every organism
+- The map is cut into BUCKET_SIZE x BUCKET_SIZE buckets, and build() sorts organisms into them (a counting sort, so it's O(n) and
+  doesn't allocate once its buffers are big enough)
+- A query only looks at the buckets that overlap its radius, so its cost depends on how crowded that area is, not on the size of the map
+- Distances are Manhattan distances (|dx| + |dy|), so a radius of 1 is the same as Organism::isNextTo()
+- Queries use organisms' current coordinates and only return living organisms. Organisms move at most 1 cell per iteration, so queries
+  search 1 cell past their radius and an index can keep being used for the rest of the iteration it was built in, even as organisms move
+*/
+class SpatialIndex {
+    public:
+    static constexpr int BUCKET_SIZE = 8;
+
+    private:
+    int m_width{0};
+    int m_height{0};
+    int m_buckets_x{0};
+    int m_buckets_y{0};
+    std::vector<int> m_bucket_starts; // Organisms in bucket b are m_entries[m_bucket_starts[b]] to m_entries[m_bucket_starts[b + 1] - 1]
+    std::vector<Organism*> m_entries;
+    std::vector<int> m_entry_buckets; // Scratch space for build(): bucket of each organism
+
+    // Private methods:
+    int getBucket(int x_coord, int y_coord) const;
+
+    public:
+    static int getDistance(const std::tuple<int, int>& a, const std::tuple<int, int>& b);
+
+    /*
+    - Sort organisms into buckets. Call this again whenever the index might be more than 1 iteration out of date
+    */
+    void build(const std::vector<Organism*>& organisms, const std::tuple<int, int>& map_dimensions);
+
+    bool empty() const;
+
+    /*
+    - Call visit(org) for every living organism within radius of center, in no particular order
+    */
+    template <typename Visitor>
+    void forEachWithin(const std::tuple<int, int>& center, int radius, Visitor&& visit) const {
+        if (m_entries.empty() || radius < 0)
+            return;
+
+        // Organisms may have moved 1 cell since they were sorted into buckets
+        int x_coord = std::get<0>(center), y_coord = std::get<1>(center);
+        int min_bucket_x = std::max(0, (x_coord - radius - 1) / BUCKET_SIZE), max_bucket_x = std::min(m_buckets_x - 1, (x_coord + radius + 1) / BUCKET_SIZE);
+        int min_bucket_y = std::max(0, (y_coord - radius - 1) / BUCKET_SIZE), max_bucket_y = std::min(m_buckets_y - 1, (y_coord + radius + 1) / BUCKET_SIZE);
+        for (int bucket_y = min_bucket_y; bucket_y <= max_bucket_y; bucket_y++){
+            for (int bucket_x = min_bucket_x; bucket_x <= max_bucket_x; bucket_x++){
+                int bucket = (bucket_y * m_buckets_x) + bucket_x;
+                for (int i = m_bucket_starts[bucket]; i < m_bucket_starts[bucket + 1]; i++){
+                    Organism* org = m_entries[i];
+                    if (org->isAlive() && getDistance(org->getCoords(), center) <= radius)
+                        visit(org);
+                }
+            }
+        }
+    }
+
+    /*
+    - Living organism within radius of center that matches is_match and is closest to center (ties go to the lowest ID), or nullptr if there is none
+    - Buckets are searched in rings going outwards, so the search stops as soon as nothing further out could be closer
+    */
+    template <typename Predicate>
+    Organism* findNearest(const std::tuple<int, int>& center, int radius, Predicate&& is_match) const {
+        if (m_entries.empty() || radius < 0)
+            return nullptr;
+
+        int x_coord = std::get<0>(center), y_coord = std::get<1>(center);
+        int center_bucket_x = std::clamp(x_coord / BUCKET_SIZE, 0, m_buckets_x - 1), center_bucket_y = std::clamp(y_coord / BUCKET_SIZE, 0, m_buckets_y - 1);
+        int max_ring = ((radius + 1) / BUCKET_SIZE) + 1;
+
+        Organism* nearest = nullptr;
+        int nearest_distance = radius + 1;
+        for (int ring = 0; ring <= max_ring; ring++){
+            // Everything in this ring is at least this far away (allowing for organisms that moved 1 cell)
+            if (ring > 0 && (ring - 1) * BUCKET_SIZE > nearest_distance)
+                break;
+
+            for (int bucket_y = center_bucket_y - ring; bucket_y <= center_bucket_y + ring; bucket_y++){
+                if (bucket_y < 0 || bucket_y >= m_buckets_y)
+                    continue;
+
+                // Only the edge of the ring is new
+                bool edge_row = std::abs(bucket_y - center_bucket_y) == ring;
+                int step = edge_row ? 1 : 2 * ring;
+                for (int bucket_x = center_bucket_x - ring; bucket_x <= center_bucket_x + ring; bucket_x += std::max(step, 1)){
+                    if (bucket_x < 0 || bucket_x >= m_buckets_x)
+                        continue;
+
+                    int bucket = (bucket_y * m_buckets_x) + bucket_x;
+                    for (int i = m_bucket_starts[bucket]; i < m_bucket_starts[bucket + 1]; i++){
+                        Organism* org = m_entries[i];
+                        if (!org->isAlive())
+                            continue;
+
+                        int distance = getDistance(org->getCoords(), center);
+                        if (distance > radius || distance > nearest_distance || !is_match(org))
+                            continue;
+                        if (distance < nearest_distance || !nearest || org->getID() < nearest->getID()){
+                            nearest = org;
+                            nearest_distance = distance;
+                        }
+                    }
+                }
+            }
+        }
+        return nearest;
+    }
+
+    /*
+    - Append every living organism within radius of center to found
+    */
+    void findWithin(const std::tuple<int, int>& center, int radius, std::vector<Organism*>& found) const;
+
+    /*
+    - Nearest living organism of type type within radius of center, or nullptr if there is none
+    */
+    Organism* findNearestOfType(const std::tuple<int, int>& center, int radius, Organism::OrganismType type) const;
+
+    /*
+    - Nearest living organism within radius that hunter can eat, or nullptr if there is none
+    */
+    Organism* findNearestPrey(const Organism* hunter, int radius) const;
+
+    /*
+    - Nearest living organism within radius that can eat prey, or nullptr if there is none
+    */
+    Organism* findNearestPredator(const Organism* prey, int radius) const;
+
+    /*
+    - Append every living organism within radius that can eat prey to found
+    */
+    void findPredatorsWithin(const Organism* prey, int radius, std::vector<Organism*>& found) const;
+};
+
+#endif
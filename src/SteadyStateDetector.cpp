@@ -0,0 +1,51 @@
+#include "SteadyStateDetector.h"
+
+bool SteadyStateDetector::hasAnimals(const OrganismPool& organisms){
+    for (const Organism* org : organisms.getOrganisms()){
+        if (org->getType() != Organism::PlantEnum)
+            return true;
+    }
+    return false;
+}
+
+int SteadyStateDetector::record(const OrganismPool& organisms, long long iteration){
+    if (iteration != m_last_iteration + 1)
+        reset();
+
+    std::uint64_t hash = organisms.getWorldHash();
+    m_period = 0;
+
+    // Look for the most recent iteration with the same hash. That distance is the period of the cycle
+    for (int period = 1; period <= m_recorded && period <= HISTORY_SIZE; period++){
+        if (m_hashes[(iteration - period) % HISTORY_SIZE] == hash){
+            // Animals make the world random, so only trust repeats in worlds without any. This check is O(n), but only happens on a repeat
+            if (!hasAnimals(organisms))
+                m_period = period;
+            break;
+        }
+    }
+
+    m_hashes[iteration % HISTORY_SIZE] = hash;
+    m_last_iteration = iteration;
+    if (m_recorded < HISTORY_SIZE)
+        m_recorded++;
+
+    return m_period;
+}
+
+int SteadyStateDetector::getPeriod() const{
+    return m_period;
+}
+
+long long SteadyStateDetector::getSkippableIterations(long long remaining_iterations) const{
+    if (m_period == 0 || remaining_iterations <= 0)
+        return 0;
+
+    return remaining_iterations - (remaining_iterations % m_period);
+}
+
+void SteadyStateDetector::reset(){
+    m_last_iteration = -1;
+    m_recorded = 0;
+    m_period = 0;
+}
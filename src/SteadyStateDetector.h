@@ -0,0 +1,52 @@
+#ifndef STEADYSTATEDETECTOR_H
+#define STEADYSTATEDETECTOR_H
+
+#include "OrganismPool.h"
+
+#include <cstdint>
+
+/*
+Detects when the simulation stops changing (a fixed point) or starts repeating itself (a short cycle)
+- Keeps the world hash (see OrganismPool::getWorldHash()) of the last HISTORY_SIZE iterations and looks for repeats
+- Only worlds without animals are treated as steady, since animals move randomly and a repeated hash doesn't mean they'll keep repeating.
+  Plants on their own are deterministic, so once such a world repeats itself it will keep doing so forever
+*/
+class SteadyStateDetector {
+    public:
+    static constexpr int HISTORY_SIZE = 64; // Longest cycle that can be detected
+
+    private:
+    std::uint64_t m_hashes[HISTORY_SIZE]{}; // Ring buffer of world hashes. m_hashes[i % HISTORY_SIZE] is the hash after iteration i
+    long long m_last_iteration{-1}; // Last iteration recorded
+    int m_recorded{0}; // Number of consecutive iterations in m_hashes
+    int m_period{0}; // Period of the cycle the world is currently in (1 = fixed point), or 0 if it isn't in one
+
+    // Private methods:
+    static bool hasAnimals(const OrganismPool& organisms);
+
+    public:
+    /*
+    - Record the state of organisms after iteration, and return the period of the cycle the world is in (0 if it's not in one)
+    - A period of 1 means the world will never change again
+    - Iterations should be recorded in order. Skipping an iteration starts the history over
+    */
+    int record(const OrganismPool& organisms, long long iteration);
+
+    /*
+    - Period returned by the last call to record()
+    */
+    int getPeriod() const;
+
+    /*
+    - Given that the world is in a cycle, return how many of remaining_iterations can be skipped without changing the end result
+    - This is a multiple of the period, so running the rest (remaining_iterations - skipped) lands on the same state as running all of them
+    */
+    long long getSkippableIterations(long long remaining_iterations) const;
+
+    /*
+    - Forget everything recorded so far
+    */
+    void reset();
+};
+
+#endif
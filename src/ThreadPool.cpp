@@ -0,0 +1,74 @@
+#include "ThreadPool.h"
+
+ThreadPool::ThreadPool(int thread_count){
+    for (int i = 1; i < thread_count; i++)
+        m_workers.emplace_back(&ThreadPool::workerLoop, this);
+}
+
+ThreadPool::~ThreadPool(){
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+    m_work_ready.notify_all();
+
+    for (std::thread& worker : m_workers)
+        worker.join();
+}
+
+int ThreadPool::getThreadCount() const{
+    return m_workers.size() + 1;
+}
+
+void ThreadPool::run(int task_count, const std::function<void(int)>& task){
+    // Without workers, just run everything on this thread
+    if (m_workers.empty()){
+        for (int i = 0; i < task_count; i++)
+            task(i);
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_task = &task;
+        m_task_count = task_count;
+        m_next_task.store(0);
+        m_busy_workers = m_workers.size();
+        m_generation++;
+    }
+    m_work_ready.notify_all();
+
+    // Help out with tasks, then wait for the workers to finish theirs
+    runTasks();
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_work_done.wait(lock, [this] { return m_busy_workers == 0; });
+    m_task = nullptr;
+}
+
+void ThreadPool::runTasks(){
+    int task_index;
+    while ((task_index = m_next_task.fetch_add(1)) < m_task_count)
+        (*m_task)(task_index);
+}
+
+void ThreadPool::workerLoop(){
+    unsigned long long seen_generation = 0;
+    while (true){
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_work_ready.wait(lock, [&] { return m_stopping || m_generation != seen_generation; });
+            if (m_stopping)
+                return;
+            seen_generation = m_generation;
+        }
+
+        runTasks();
+
+        // Let run() know once every worker is done
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_busy_workers--;
+        if (m_busy_workers == 0)
+            m_work_done.notify_one();
+    }
+}
@@ -0,0 +1,53 @@
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <atomic>
+#include <vector>
+
+/*
+Fixed-size pool of worker threads that run parallel for-loops
+- The thread that calls run() also works on tasks, so a pool of N threads only starts N - 1 workers
+- Workers sleep on a condition variable between calls to run(), so an idle pool doesn't use any CPU
+*/
+class ThreadPool {
+    std::vector<std::thread> m_workers;
+    std::mutex m_mutex;
+    std::condition_variable m_work_ready; // Signalled when a new call to run() starts (or when the pool is shutting down)
+    std::condition_variable m_work_done; // Signalled when the last worker finishes its part of a call to run()
+
+    // State of the current call to run(). Protected by m_mutex except for m_next_task
+    const std::function<void(int)>* m_task{nullptr};
+    int m_task_count{0};
+    std::atomic<int> m_next_task{0};
+    int m_busy_workers{0};
+    unsigned long long m_generation{0}; // Bumped every time run() is called so workers can tell there's new work
+    bool m_stopping{false};
+
+    // Private methods:
+    void workerLoop();
+    void runTasks(); // Keep taking task indices until there are none left
+
+    public:
+    /*
+    - Make a pool where run() uses thread_count threads (including the calling thread)
+    */
+    explicit ThreadPool(int thread_count);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    int getThreadCount() const;
+
+    /*
+    - Call task(i) for every i in [0, task_count) and wait until all calls are done
+    - Tasks are handed out to threads dynamically, so the order they run in is not fixed
+    */
+    void run(int task_count, const std::function<void(int)>& task);
+};
+
+#endif
@@ -0,0 +1,236 @@
+#include "TileStore.h"
+#include "Helper.h"
+
+#include <algorithm>
+#include <cstring>
+#include <cerrno>
+#include <cstdlib>
+#include <sys/mman.h>
+#include <unistd.h>
+
+TileStore::~TileStore(){
+    if (m_writer.joinable()){
+        {
+            std::lock_guard<std::mutex> lock(m_writer_mutex);
+            m_writer_stopping = true;
+        }
+        m_writer_wakeup.notify_one();
+        m_writer.join();
+    }
+    unmap();
+    if (m_file != -1)
+        ::close(m_file);
+}
+
+// Setters & Getters:
+
+std::uint32_t* TileStore::data(){
+    return m_cells;
+}
+
+const std::uint32_t* TileStore::data() const{
+    return m_cells;
+}
+
+std::size_t TileStore::size() const{
+    return m_size;
+}
+
+bool TileStore::isFileBacked() const{
+    return m_file != -1;
+}
+
+std::size_t TileStore::getMemoryLimit() const{
+    return m_memory_limit;
+}
+
+std::size_t TileStore::getMemoryUsage() const{
+    if (isFileBacked())
+        return m_stats.resident_tiles * TILE_BYTES;
+    return m_memory_cells.capacity() * sizeof(std::uint32_t);
+}
+
+TileStore::Stats TileStore::getStats() const{
+    return m_stats;
+}
+
+// Private methods:
+
+void TileStore::map(std::size_t size){
+    waitForWriter();
+    unmap();
+
+    // The file is always a whole number of tiles, so the last tile can be written back and dropped like any other
+    std::size_t tile_count = (size + TILE_CELLS - 1) / TILE_CELLS;
+    std::size_t bytes = tile_count * TILE_BYTES;
+    if (::ftruncate(m_file, bytes) != 0){
+        std::cerr << "Error: couldn't resize a tile store's backing file to " << bytes << " bytes: " << std::strerror(errno) << '\n';
+        Helper::quit(13);
+    }
+    if (bytes > 0){
+        void* memory = ::mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, m_file, 0);
+        if (memory == MAP_FAILED){
+            std::cerr << "Error: couldn't map a tile store's backing file: " << std::strerror(errno) << '\n';
+            Helper::quit(13);
+        }
+        m_cells = static_cast<std::uint32_t*>(memory);
+
+        // Tiles are used in no particular order. Without this, the kernel reads ahead and maps pages in big chunks (up to 2 MiB),
+        // so a single cell read could bring in far more than its tile, and dropping a tile wouldn't free anything
+        ::madvise(memory, bytes, MADV_RANDOM);
+        ::madvise(memory, bytes, MADV_NOHUGEPAGE);
+    }
+    m_mapped_bytes = bytes;
+    m_size = size;
+
+    // Tiles that were cut off aren't resident anymore
+    for (std::size_t tile = tile_count; tile < m_tiles.size(); tile++)
+        m_stats.resident_tiles -= m_tiles[tile].resident;
+    m_tiles.resize(tile_count);
+}
+
+void TileStore::unmap(){
+    if (m_mapped_bytes > 0)
+        ::munmap(m_cells, m_mapped_bytes);
+    m_cells = nullptr;
+    m_mapped_bytes = 0;
+}
+
+void TileStore::trim(){
+    std::size_t limit_tiles = std::max<std::size_t>(1, m_memory_limit / TILE_BYTES);
+    if (m_memory_limit == 0 || m_stats.resident_tiles <= limit_tiles)
+        return;
+
+    // Go a bit under the limit, so the next few tiles that are paged in don't each have to trim again
+    std::size_t target_tiles = limit_tiles - (limit_tiles / 8);
+    m_eviction_candidates.clear();
+    for (int tile = 0; tile < m_tiles.size(); tile++){
+        if (m_tiles[tile].resident && m_tiles[tile].hot_until < m_clock)
+            m_eviction_candidates.push_back(tile);
+    }
+
+    // Hot tiles are never dropped, even if that means going over the limit
+    std::size_t eviction_count = std::min(m_eviction_candidates.size(), m_stats.resident_tiles - target_tiles);
+    auto least_recently_used = [this](int a, int b) { return m_tiles[a].last_used < m_tiles[b].last_used; };
+    std::nth_element(m_eviction_candidates.begin(), m_eviction_candidates.begin() + eviction_count, m_eviction_candidates.end(), least_recently_used);
+
+    {
+        std::lock_guard<std::mutex> lock(m_writer_mutex);
+        for (std::size_t i = 0; i < eviction_count; i++){
+            Tile& tile = m_tiles[m_eviction_candidates[i]];
+            m_write_queue.push_back({m_eviction_candidates[i], tile.dirty});
+            m_stats.write_backs += tile.dirty;
+            tile.resident = false;
+            tile.dirty = false;
+        }
+    }
+    m_stats.resident_tiles -= eviction_count;
+    m_stats.evictions += eviction_count;
+    m_writer_wakeup.notify_one();
+}
+
+void TileStore::writerLoop(){
+    std::vector<WriteBack> write_backs;
+    std::unique_lock<std::mutex> lock(m_writer_mutex);
+    while (true){
+        m_writer_wakeup.wait(lock, [this] { return m_writer_stopping || !m_write_queue.empty(); });
+        if (m_write_queue.empty()) // Stopping, and there's nothing left to write back
+            return;
+
+        write_backs.swap(m_write_queue);
+        m_writer_busy = true;
+        lock.unlock();
+
+        // Writing dirty pages first means dropping them never has to wait for the kernel to flush them under memory pressure.
+        // If the simulation uses a tile again before it's dropped, it just gets paged back in from the file
+        for (const WriteBack& write_back : write_backs){
+            std::uint32_t* tile_cells = m_cells + (static_cast<std::size_t>(write_back.tile) * TILE_CELLS);
+            if (write_back.dirty)
+                ::msync(tile_cells, TILE_BYTES, MS_SYNC);
+            ::madvise(tile_cells, TILE_BYTES, MADV_DONTNEED);
+        }
+        write_backs.clear();
+
+        lock.lock();
+        m_writer_busy = false;
+        m_writer_idle.notify_all();
+    }
+}
+
+void TileStore::waitForWriter(){
+    std::unique_lock<std::mutex> lock(m_writer_mutex);
+    m_writer_idle.wait(lock, [this] { return m_write_queue.empty() && !m_writer_busy; });
+}
+
+// Methods:
+
+void TileStore::useBackingFile(const std::filesystem::path& directory, std::size_t memory_limit){
+    if (isFileBacked()){
+        m_memory_limit = memory_limit;
+        trim();
+        return;
+    }
+
+    std::string file_template = (directory / "ecosystem-tiles-XXXXXX").string();
+    m_file = ::mkstemp(file_template.data());
+    if (m_file == -1){
+        std::cerr << "Error: couldn't make a tile store's backing file in " << directory << ": " << std::strerror(errno) << '\n';
+        Helper::quit(13);
+    }
+    ::unlink(file_template.c_str());
+    m_memory_limit = memory_limit;
+
+    // Move whatever is in memory into the file
+    map(m_memory_cells.size());
+    if (!m_memory_cells.empty())
+        std::memcpy(m_cells, m_memory_cells.data(), m_memory_cells.size() * sizeof(std::uint32_t));
+    std::vector<std::uint32_t>().swap(m_memory_cells);
+
+    m_writer = std::thread(&TileStore::writerLoop, this);
+    for (std::size_t cell = 0; cell < m_size; cell += TILE_CELLS)
+        touch(cell, true);
+}
+
+void TileStore::resize(std::size_t size){
+    if (isFileBacked()){
+        map(size);
+        return;
+    }
+    m_memory_cells.resize(size, 0);
+    m_cells = m_memory_cells.data();
+    m_size = size;
+}
+
+void TileStore::touch(std::size_t cell, bool dirty){
+    if (!isFileBacked())
+        return;
+
+    Tile& tile = m_tiles[cell / TILE_CELLS];
+    tile.last_used = m_clock;
+    tile.dirty |= dirty;
+    if (!tile.resident){
+        tile.resident = true;
+        m_stats.resident_tiles++;
+        m_stats.peak_resident_tiles = std::max(m_stats.peak_resident_tiles, m_stats.resident_tiles);
+        trim();
+    }
+}
+
+void TileStore::keepResident(std::size_t cell){
+    if (!isFileBacked())
+        return;
+
+    // Marked hot first, so paging it in can't drop it right away
+    Tile& tile = m_tiles[cell / TILE_CELLS];
+    if (tile.hot_until != m_clock){
+        tile.hot_until = m_clock;
+        m_stats.hot_tiles++;
+        m_stats.peak_hot_tiles = std::max(m_stats.peak_hot_tiles, m_stats.hot_tiles);
+    }
+    touch(cell, false);
+}
+
+void TileStore::advanceClock(){
+    m_clock++;
+    m_stats.hot_tiles = 0;
+}
@@ -0,0 +1,133 @@
+#ifndef TILESTORE_H
+#define TILESTORE_H
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <filesystem>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+/*
+Array of 32-bit cells split into fixed-size tiles, kept either in memory or in a memory-mapped file on disk
+- By default the cells are just a vector in memory
+- With a backing file (useBackingFile()), the cells live in a file that's mapped into memory, so tiles are only paged in when they're used and
+  the world can be bigger than RAM. Tiles that are used are counted as resident, and once resident tiles take up more than the memory limit,
+  the least recently used ones are dropped from memory. Dirty tiles are written back to the file first, on a background thread, so the
+  simulation never waits for the disk. Hot tiles (see keepResident()) are never dropped
+- A tile is TILE_CELLS consecutive cells (a whole number of pages), so with cells in row-major order a tile is a band of rows
+*/
+class TileStore {
+    public:
+    static constexpr int TILE_CELLS = 16384; // 64 KiB
+    static constexpr std::size_t TILE_BYTES = TILE_CELLS * sizeof(std::uint32_t);
+
+    struct Stats {
+        int resident_tiles{};
+        int peak_resident_tiles{};
+        long long evictions{}; // Tiles dropped from memory
+        long long write_backs{}; // Dirty tiles written back to the file before being dropped
+        int hot_tiles{}; // Tiles kept resident since the clock was last advanced (see keepResident())
+        int peak_hot_tiles{}; // Most hot tiles at once. Hot tiles are never dropped, so if these take more than the limit, so does the store
+    };
+
+    private:
+    struct Tile {
+        unsigned int last_used{0}; // Clock when the tile was last used
+        unsigned int hot_until{0}; // Clock until which the tile can't be dropped
+        bool resident{false};
+        bool dirty{false};
+    };
+
+    struct WriteBack {
+        int tile;
+        bool dirty;
+    };
+
+    std::uint32_t* m_cells{nullptr};
+    std::size_t m_size{0};
+    std::vector<std::uint32_t> m_memory_cells; // Cells when there's no backing file
+
+    // Backing file:
+    int m_file{-1};
+    std::size_t m_mapped_bytes{0};
+    std::size_t m_memory_limit{0};
+    std::vector<Tile> m_tiles;
+    unsigned int m_clock{1};
+    std::vector<int> m_eviction_candidates; // Scratch space for trim()
+    Stats m_stats{};
+
+    // Background write-back:
+    std::thread m_writer;
+    std::mutex m_writer_mutex;
+    std::condition_variable m_writer_wakeup; // Signalled when there are tiles to write back (or the store is being destroyed)
+    std::condition_variable m_writer_idle; // Signalled when the writer has written back everything it was given
+    std::vector<WriteBack> m_write_queue;
+    bool m_writer_busy{false};
+    bool m_writer_stopping{false};
+
+    // Private methods:
+    void map(std::size_t size); // (Re)map the backing file so it holds size cells
+    void unmap();
+    void trim(); // Drop least recently used tiles until resident tiles fit in the memory limit
+    void writerLoop();
+    void waitForWriter(); // Wait until every queued tile has been written back, so the mapping can change
+
+    public:
+    TileStore() = default;
+    ~TileStore();
+
+    TileStore(const TileStore&) = delete;
+    TileStore& operator=(const TileStore&) = delete;
+
+    // Setters & Getters:
+
+    std::uint32_t& operator[](std::size_t cell) { return m_cells[cell]; }
+    const std::uint32_t& operator[](std::size_t cell) const { return m_cells[cell]; }
+
+    std::uint32_t* data();
+    const std::uint32_t* data() const;
+    std::size_t size() const;
+
+    bool isFileBacked() const;
+    std::size_t getMemoryLimit() const;
+
+    /*
+    - Bytes of cells in memory: the whole array without a backing file, or the resident tiles with one
+    */
+    std::size_t getMemoryUsage() const;
+
+    Stats getStats() const;
+
+    // Methods:
+
+    /*
+    - Move the cells into a new file in directory. The file is deleted as soon as it's made, so it goes away with the store (or the program)
+    - memory_limit is how many bytes of tiles to keep resident (0 = no limit)
+    - Quits (error 13) if the file can't be made or mapped
+    */
+    void useBackingFile(const std::filesystem::path& directory, std::size_t memory_limit);
+
+    /*
+    - Change the number of cells. Cells that are still in range keep their value, and new cells are 0
+    */
+    void resize(std::size_t size);
+
+    /*
+    - Note that the tile holding cell was used (and written to, if dirty is true). Only needed with a backing file
+    */
+    void touch(std::size_t cell, bool dirty);
+
+    /*
+    - Don't drop the tile holding cell until the clock is advanced again (used for tiles that have animals in them this iteration)
+    */
+    void keepResident(std::size_t cell);
+
+    /*
+    - Advance the clock that least recently used is measured in (once per iteration)
+    */
+    void advanceClock();
+};
+
+#endif
@@ -0,0 +1,199 @@
+#include "WorldBrancher.h"
+
+#include <csignal>
+#include <iomanip>
+#include <sys/prctl.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+const std::string WorldBrancher::PERTURBATIONS_HELP =
+    "Perturbations: none | remove:<letter> | health:<letter>:<amount> | seed:<n> (combine with commas)\n";
+
+WorldBrancher::~WorldBrancher(){
+    waitForBranches();
+}
+
+// Private methods:
+
+void WorldBrancher::applyPerturbations(const std::vector<Perturbation>& perturbations, OrganismPool& organisms){
+    for (const Perturbation& perturbation : perturbations){
+        switch (perturbation.kind){
+            case Perturbation::RemovePerturbation:
+                organisms.eraseIf([&perturbation](const Organism* org) { return org->getLetterID() == perturbation.letter_id; });
+                break;
+            case Perturbation::HealthPerturbation:
+                for (Organism* org : organisms.getOrganisms()){
+                    if (org->getLetterID() == perturbation.letter_id && org->isAlive())
+                        org->addHealth(perturbation.amount, organisms.getWorldHashState());
+                }
+                break;
+            case Perturbation::SeedPerturbation:
+                Helper::setRandomSeed(perturbation.seed);
+                break;
+            case Perturbation::NoPerturbation:
+                break;
+        }
+    }
+}
+
+void WorldBrancher::runBranch(OrganismPool& organisms, const std::tuple<int, int>& map_dimensions, const std::string& engine_name, unsigned int engine_seed,
+    long long iteration, long long iterations, const std::vector<Perturbation>& perturbations, const std::filesystem::path& stats_file){
+    std::ofstream stats(stats_file, std::ios::trunc);
+    if (!stats.is_open())
+        return;
+
+    // Species are the ones in the world when it branched (sorted, so every branch has the same columns, even if it removed a species)
+    std::string letters;
+    auto add_letter = [&letters](char letter_id) {
+        if (letters.find(letter_id) == std::string::npos)
+            letters += letter_id;
+    };
+    for (const Organism* org : organisms.getOrganisms())
+        add_letter(org->getLetterID());
+    for (const PlantLayer::Species& species : organisms.getPlantLayer().getSpeciesTable())
+        add_letter(species.letter_id);
+    std::sort(letters.begin(), letters.end());
+
+    applyPerturbations(perturbations, organisms);
+    for (const Perturbation& perturbation : perturbations){
+        if (perturbation.kind == Perturbation::SeedPerturbation)
+            engine_seed = perturbation.seed;
+    }
+    std::unique_ptr<Engine> engine = Engine::create(engine_name, engine_seed);
+    if (!engine)
+        return;
+
+    stats << "iteration,world_hash,live_animals,live_plants";
+    for (char letter : letters)
+        stats << ',' << letter;
+    stats << '\n';
+
+    auto writeStats = [&](long long iteration) {
+        int live_animals = organisms.getLiveCount(Organism::HerbivoreEnum) + organisms.getLiveCount(Organism::OmnivoreEnum);
+        stats << iteration << ',' << std::hex << std::setw(16) << std::setfill('0') << organisms.getWorldHash() << std::dec << std::setfill(' ')
+            << ',' << live_animals << ',' << organisms.getLiveCount(Organism::PlantEnum);
+        for (char letter : letters)
+            stats << ',' << organisms.getLiveCount(letter);
+        stats << '\n' << std::flush; // Flushed every line, so the stats can be watched while the branch runs
+    };
+
+    writeStats(iteration);
+    for (long long i = 1; i <= iterations; i++){
+        engine->update(organisms, map_dimensions, iteration + i);
+        writeStats(iteration + i);
+    }
+}
+
+// Methods:
+
+bool WorldBrancher::parsePerturbations(const std::string& text, std::vector<Perturbation>& perturbations){
+    perturbations.clear();
+    std::istringstream list(text);
+    std::string item;
+    while (std::getline(list, item, ',')){
+        std::vector<std::string> fields;
+        std::istringstream item_stream(item);
+        std::string field;
+        while (std::getline(item_stream, field, ':'))
+            fields.push_back(field);
+        if (fields.empty())
+            return false;
+
+        Perturbation perturbation;
+        try {
+            std::size_t used = 0;
+            if (fields[0] == "none" && fields.size() == 1)
+                perturbation.kind = Perturbation::NoPerturbation;
+            else if (fields[0] == "remove" && fields.size() == 2 && fields[1].size() == 1){
+                perturbation.kind = Perturbation::RemovePerturbation;
+                perturbation.letter_id = fields[1][0];
+            }
+            else if (fields[0] == "health" && fields.size() == 3 && fields[1].size() == 1){
+                perturbation.kind = Perturbation::HealthPerturbation;
+                perturbation.letter_id = fields[1][0];
+                perturbation.amount = std::stoi(fields[2], &used);
+            }
+            else if (fields[0] == "seed" && fields.size() == 2){
+                perturbation.kind = Perturbation::SeedPerturbation;
+                perturbation.seed = std::stoul(fields[1], &used);
+            }
+            else
+                return false;
+
+            if (used != 0 && used != fields.back().size()) // Trailing junk after a number
+                return false;
+        } catch (const std::logic_error&) {
+            return false;
+        }
+        perturbations.push_back(perturbation);
+    }
+    return !perturbations.empty();
+}
+
+bool WorldBrancher::canBranch(const OrganismPool& organisms, const std::string& engine_name, const std::vector<std::vector<Perturbation>>& branch_perturbations,
+    std::string& reason){
+    if (engine_name.compare(0, 10, "processes:") == 0){
+        reason = "the " + engine_name + " engine's workers belong to the live simulation, so a branch can't run it";
+        return false;
+    }
+
+    const PlantLayer& plant_layer = organisms.getPlantLayer();
+    if (plant_layer.isFileBacked()){
+        reason = "the plant layer is in a shared file, so a branch would change the live simulation's plants";
+        return false;
+    }
+    for (const std::vector<Perturbation>& perturbations : branch_perturbations){
+        for (const Perturbation& perturbation : perturbations){
+            if (perturbation.kind != Perturbation::RemovePerturbation && perturbation.kind != Perturbation::HealthPerturbation)
+                continue;
+            for (const PlantLayer::Species& species : plant_layer.getSpeciesTable()){
+                if (species.letter_id == perturbation.letter_id){
+                    reason = std::string("perturbations can't change ") + perturbation.letter_id + ", since its plants are in a plant layer";
+                    return false;
+                }
+            }
+        }
+    }
+    return true;
+}
+
+std::vector<std::filesystem::path> WorldBrancher::startBranches(OrganismPool& organisms, const std::tuple<int, int>& map_dimensions, const std::string& engine_name,
+    unsigned int engine_seed, long long iteration, long long iterations, const std::vector<std::vector<Perturbation>>& branch_perturbations,
+    const std::string& stats_prefix, int first_number){
+    // Anything still buffered would get written again by every branch
+    std::cout.flush();
+    std::cerr.flush();
+    std::fflush(nullptr);
+
+    std::vector<std::filesystem::path> stats_files;
+    for (int branch = 0; branch < branch_perturbations.size(); branch++){
+        std::filesystem::path stats_file = stats_prefix + "-" + std::to_string(first_number + branch) + ".csv";
+        pid_t pid = ::fork();
+        if (pid < 0){
+            std::cerr << "Error: couldn't start branch " << first_number + branch << '\n';
+            Helper::quit(11);
+        }
+        if (pid == 0){
+            // Don't keep running if the simulation is killed
+            ::prctl(PR_SET_PDEATHSIG, SIGTERM);
+            runBranch(organisms, map_dimensions, engine_name, engine_seed, iteration, iterations, branch_perturbations[branch], stats_file);
+
+            // Skip destructors and atexit handlers: they belong to the parent (its threads, its terminal, its pool)
+            ::_exit(0);
+        }
+        m_branches.push_back({pid, stats_file});
+        stats_files.push_back(stats_file);
+    }
+    return stats_files;
+}
+
+int WorldBrancher::reapBranches(){
+    m_branches.erase(std::remove_if(m_branches.begin(), m_branches.end(), [](const Branch& branch) { return ::waitpid(branch.pid, nullptr, WNOHANG) != 0; }), m_branches.end());
+    return m_branches.size();
+}
+
+void WorldBrancher::waitForBranches(){
+    for (const Branch& branch : m_branches)
+        ::waitpid(branch.pid, nullptr, 0);
+    m_branches.clear();
+}
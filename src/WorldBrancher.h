@@ -0,0 +1,94 @@
+#ifndef WORLDBRANCHER_H
+#define WORLDBRANCHER_H
+
+#include "Engine.h"
+
+#include <sys/types.h>
+
+/*
+Runs "what if" branches of a live simulation: copies of the world as it is right now, each with its own change, running on their own
+- Every branch is a child process made with fork(), so it starts with a copy-on-write copy of the whole world. Starting branches only
+  copies page tables, no matter how big the world is, and a page is only really copied once the parent or the branch changes it
+- A branch applies its perturbations (see parsePerturbations()), runs a number of iterations with a new engine of the same kind (and seed)
+  as the live simulation's, and writes a line of stats to its own CSV file after every iteration. The parent keeps going as if nothing happened
+- Branches share nothing with the parent after they start. Engines that keep state of their own (grids, orders) build it again from the
+  world in the branch. processes engines can't be branched, since their workers belong to the parent (see canBranch())
+*/
+class WorldBrancher {
+    public:
+    static const std::string PERTURBATIONS_HELP;
+
+    /*
+    A change applied to a branch right after it starts
+    */
+    struct Perturbation {
+        enum Kind {
+            NoPerturbation, // "none": keep the world as it is
+            RemovePerturbation, // "remove:<letter>": erase every organism of a species
+            HealthPerturbation, // "health:<letter>:<amount>": add amount (can be negative) to the health of every organism of a species
+            SeedPerturbation // "seed:<n>": re-seed the random engine (and the engine's own seed), so branches with the same world can still end up different
+        };
+        Kind kind{NoPerturbation};
+        char letter_id{};
+        int amount{};
+        unsigned int seed{};
+    };
+
+    private:
+    struct Branch {
+        pid_t pid;
+        std::filesystem::path stats_file;
+    };
+
+    std::vector<Branch> m_branches; // Branches that haven't been reaped yet
+
+    // Private methods:
+    static void applyPerturbations(const std::vector<Perturbation>& perturbations, OrganismPool& organisms);
+    static void runBranch(OrganismPool& organisms, const std::tuple<int, int>& map_dimensions, const std::string& engine_name, unsigned int engine_seed,
+        long long iteration, long long iterations, const std::vector<Perturbation>& perturbations, const std::filesystem::path& stats_file); // Everything a branch does, in the child process
+
+    public:
+    WorldBrancher() = default;
+    ~WorldBrancher();
+
+    WorldBrancher(const WorldBrancher&) = delete;
+    WorldBrancher& operator=(const WorldBrancher&) = delete;
+
+    /*
+    - Parse perturbations separated by commas (e.g. "remove:C,seed:7") into perturbations
+    - Returns false if any of them isn't valid
+    */
+    static bool parsePerturbations(const std::string& text, std::vector<Perturbation>& perturbations);
+
+    /*
+    - Whether branches with branch_perturbations can be started from organisms running on engine_name. If not, puts why in reason
+    - processes engines and plant layers with a backing file can't be branched, and perturbations that remove or change plants can't
+      reach plants in a plant layer
+    */
+    static bool canBranch(const OrganismPool& organisms, const std::string& engine_name, const std::vector<std::vector<Perturbation>>& branch_perturbations,
+        std::string& reason);
+
+    /*
+    - Start one branch per entry of branch_perturbations, from organisms as they are now (after iteration iteration)
+    - Each branch makes its own engine with Engine::create(engine_name, engine_seed). Check canBranch() first
+    - Branch k (starting at first_number) writes its stats to <stats_prefix>-<k>.csv: iteration, world hash, live animals, live plants, and live
+      organisms of every species that was in the world when it branched. The first line is the world right after the perturbations
+    - Call this between iterations, from the thread that runs them. Other threads don't exist in the branches
+    - Returns the stats files, or quits (error 11) if a branch can't be started
+    */
+    std::vector<std::filesystem::path> startBranches(OrganismPool& organisms, const std::tuple<int, int>& map_dimensions, const std::string& engine_name,
+        unsigned int engine_seed, long long iteration, long long iterations, const std::vector<std::vector<Perturbation>>& branch_perturbations,
+        const std::string& stats_prefix, int first_number = 1);
+
+    /*
+    - Reap branches that have finished. Returns how many are still running
+    */
+    int reapBranches();
+
+    /*
+    - Wait for every branch to finish
+    */
+    void waitForBranches();
+};
+
+#endif
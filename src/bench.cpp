@@ -0,0 +1,975 @@
+#include "Ecosystem.h"
+#include "ParallelEngine.h"
+#include "Kernels.h"
+#include "LayeredEngine.h"
+
+#include <array>
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#include <fstream>
+#include <iomanip>
+#include <malloc.h>
+#include <sys/resource.h>
+#include <unordered_set>
+
+/*
+Benchmark/check driver for the simulation engine. This is built as bench.bin, separately from ecosystem.bin.
+Usage: ./bench.bin <mode> [mode arguments...] (run without arguments to see every mode)
+*/
+
+// A L L O C A T I O N   C O U N T I N G
+// Every global operator new in bench.bin goes through here, so we can tell if an iteration allocated any memory
+static std::atomic<long long> allocation_count{0};
+static std::atomic<long long> allocated_bytes{0}; // Heap memory currently allocated through operator new (including malloc's rounding up)
+
+void* operator new(std::size_t size){
+    allocation_count.fetch_add(1, std::memory_order_relaxed);
+    if (void* ptr = std::malloc(size == 0 ? 1 : size)){
+        allocated_bytes.fetch_add(malloc_usable_size(ptr), std::memory_order_relaxed);
+        return ptr;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* ptr) noexcept{
+    allocated_bytes.fetch_sub(malloc_usable_size(ptr), std::memory_order_relaxed);
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, std::size_t) noexcept{
+    allocated_bytes.fetch_sub(malloc_usable_size(ptr), std::memory_order_relaxed);
+    std::free(ptr);
+}
+
+/*
+Stream buffer that throws away everything written to it. Used so we can include printing in benchmarks without flooding the terminal
+*/
+class NullBuffer : public std::streambuf {
+    protected:
+    int overflow(int c) override { return c; }
+    std::streamsize xsputn(const char*, std::streamsize count) override { return count; }
+};
+
+/*
+- Run warmup_iterations iterations, then check that each of the next check_iterations iterations (update + print) allocates nothing
+- Returns 0 if no iteration allocated, 1 otherwise
+*/
+static int runAllocationCheck(const std::filesystem::path& map_file, const std::filesystem::path& species_file, int warmup_iterations, int check_iterations){
+    std::tuple<int, int> map_dimensions = Ecosystem::getMapDimensions(map_file);
+    OrganismPool organisms;
+    Ecosystem::loadOrganisms(map_file, species_file, organisms);
+
+    // Printing goes nowhere, but still goes through all of the printing code
+    NullBuffer null_buffer;
+    std::streambuf* cout_buffer = std::cout.rdbuf(&null_buffer);
+
+    int iteration = 0;
+    for (int i = 0; i < warmup_iterations; i++){
+        iteration++;
+        Ecosystem::updateEcosystem(organisms, map_dimensions, iteration);
+        Ecosystem::printEcosystem(organisms.getOrganisms(), map_dimensions);
+    }
+
+    int allocating_iterations = 0;
+    long long total_allocations = 0;
+    int first_allocating_iteration = -1;
+    for (int i = 0; i < check_iterations; i++){
+        iteration++;
+        long long allocations_before = allocation_count.load(std::memory_order_relaxed);
+        Ecosystem::updateEcosystem(organisms, map_dimensions, iteration);
+        Ecosystem::printEcosystem(organisms.getOrganisms(), map_dimensions);
+        long long allocations = allocation_count.load(std::memory_order_relaxed) - allocations_before;
+
+        if (allocations > 0){
+            if (first_allocating_iteration == -1)
+                first_allocating_iteration = iteration;
+            allocating_iterations++;
+            total_allocations += allocations;
+        }
+    }
+
+    std::cout.rdbuf(cout_buffer);
+    organisms.clear();
+
+    if (allocating_iterations > 0){
+        std::cout << "FAIL: " << allocating_iterations << " of " << check_iterations << " iterations allocated (" << total_allocations << " allocations total, first at iteration " << first_allocating_iteration << ")\n";
+        return 1;
+    }
+
+    std::cout << "PASS: " << check_iterations << " iterations after " << warmup_iterations << " warmup iterations made 0 allocations\n";
+    return 0;
+}
+
+/*
+- Seed the random engine, run iterations iterations of Ecosystem::updateEcosystem() and print the world hash
+- Also checks the incrementally updated hash and live counts against ones computed from scratch every iteration, and reports when a
+  steady state is reached
+- Running this with the same seed on two builds of the engine is a quick determinism check: the printed hash should match
+*/
+static int runHashCheck(const std::filesystem::path& map_file, const std::filesystem::path& species_file, int iterations, unsigned int seed){
+    Helper::setRandomSeed(seed);
+    std::tuple<int, int> map_dimensions = Ecosystem::getMapDimensions(map_file);
+    OrganismPool organisms;
+    Ecosystem::loadOrganisms(map_file, species_file, organisms);
+
+    SteadyStateDetector steady_state_detector;
+    steady_state_detector.record(organisms, 0);
+    int steady_state_iteration = -1;
+    for (int iteration = 1; iteration <= iterations; iteration++){
+        Ecosystem::updateEcosystem(organisms, map_dimensions, iteration);
+
+        std::uint64_t recomputed_hash = 0;
+        std::array<int, 256> live_counts{};
+        for (const Organism* org : organisms.getOrganisms()){
+            recomputed_hash ^= org->getHashContribution();
+            if (org->isAlive())
+                live_counts[static_cast<unsigned char>(org->getLetterID())]++;
+        }
+        if (recomputed_hash != organisms.getWorldHash()){
+            std::cout << "FAIL: incremental world hash doesn't match recomputed hash at iteration " << iteration << '\n';
+            return 1;
+        }
+        for (int letter_id = 0; letter_id < live_counts.size(); letter_id++){
+            if (live_counts[letter_id] != organisms.getLiveCount(static_cast<char>(letter_id))){
+                std::cout << "FAIL: incremental live count of " << static_cast<char>(letter_id) << " doesn't match recount at iteration " << iteration << '\n';
+                return 1;
+            }
+        }
+
+        if (steady_state_detector.record(organisms, iteration) > 0 && steady_state_iteration == -1){
+            steady_state_iteration = iteration;
+            std::cout << "Steady state (period " << steady_state_detector.getPeriod() << ") reached at iteration " << iteration << '\n';
+        }
+    }
+
+    std::cout << "World hash after " << iterations << " iterations (seed " << seed << "): " << std::hex << std::setw(16) << std::setfill('0') << organisms.getWorldHash() << std::dec << '\n';
+    return 0;
+}
+
+/*
+- Run a map with the given engine while counting hardware events (see PerfCounters), and print cycles, instructions, cache and branch misses,
+  IPC and misses per organism for each phase, along with the time per iteration
+- If counters aren't allowed, the run still happens and only the time is reported (and the reason is printed), so this never fails because of it
+*/
+static int runPerfCounters(const std::filesystem::path& map_file, const std::filesystem::path& species_file, int iterations, const std::string& engine_name){
+    Helper::setRandomSeed(1);
+    std::tuple<int, int> map_dimensions = Ecosystem::getMapDimensions(map_file);
+    OrganismPool organisms;
+    Ecosystem::loadOrganisms(map_file, species_file, organisms);
+    std::unique_ptr<Engine> engine = Engine::create(engine_name, 1);
+    if (!engine){
+        std::cerr << "Error: Unknown engine " << engine_name << '\n';
+        return 8;
+    }
+
+    bool counting = PerfCounters::start();
+    auto start = std::chrono::steady_clock::now();
+    for (int iteration = 1; iteration <= iterations; iteration++)
+        engine->update(organisms, map_dimensions, iteration);
+    double run_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    PerfCounters::stop();
+
+    std::cout << engine->getName() << " engine, " << iterations << " iterations: " << std::fixed << std::setprecision(3) << (run_ms / std::max(1, iterations))
+        << " ms/iteration" << (counting ? " (including reading the counters)" : "") << ", " << organisms.size() << " organisms left\n";
+    std::cout << PerfCounters::getReport();
+    return 0;
+}
+
+/*
+- Run a map twice, once with the reference engine, which keeps the map's row-major order, and once with "reference:morton", which re-sorts
+  organisms by Morton order (see Ecosystem::reorderOrganisms()), counting hardware events for both (see PerfCounters), and print the time
+  and cache misses per organism side by side
+- Linux's generic events don't include L2, so L1D misses (everything that had to go to L2 or further) and LLC misses are what's shown
+- The two runs don't end in the same world, since update order changes results, so they're only comparable over enough iterations
+*/
+static int runLayoutComparison(const std::filesystem::path& map_file, const std::filesystem::path& species_file, int iterations){
+    std::tuple<int, int> map_dimensions = Ecosystem::getMapDimensions(map_file);
+    bool counting = false;
+    for (const std::string engine_name : {"reference", "reference:morton"}){
+        Helper::setRandomSeed(1);
+        OrganismPool organisms;
+        Ecosystem::loadOrganisms(map_file, species_file, organisms);
+        std::unique_ptr<Engine> engine = Engine::create(engine_name, 1);
+
+        counting = PerfCounters::start();
+        auto start = std::chrono::steady_clock::now();
+        for (int iteration = 1; iteration <= iterations; iteration++)
+            engine->update(organisms, map_dimensions, iteration);
+        double run_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        PerfCounters::stop();
+
+        std::cout << (engine_name == "reference" ? "Map order" : "Morton order") << ", " << iterations << " iterations: " << std::fixed << std::setprecision(3)
+            << (run_ms / std::max(1, iterations)) << " ms/iteration, " << organisms.size() << " organisms left\n";
+        if (counting){
+            // Plant and animal updates are one loop, which is the loop the order is for
+            PerfCounters::PhaseTotals updates = PerfCounters::getTotals(PerfCounters::OrganismUpdate);
+            for (PerfCounters::Event event : {PerfCounters::L1DMisses, PerfCounters::LLCMisses}){
+                if (PerfCounters::isAvailable(event))
+                    std::cout << "  " << PerfCounters::getEventName(event) << " per organism update: " << std::setprecision(2)
+                        << (static_cast<double>(updates.events[event]) / std::max<std::uint64_t>(1, updates.organisms)) << '\n';
+            }
+        }
+    }
+
+    if (!counting)
+        std::cout << PerfCounters::getReport(); // Says why there are no cache misses to show
+    return 0;
+}
+
+/*
+- Load a map twice, once with plants as Plant objects and once with plants in the plant layer, and compare how much heap memory each world uses
+- Returns 1 if the two worlds don't have the same world hash (they should be the same world), 0 otherwise
+*/
+static int runMemoryComparison(const std::filesystem::path& map_file, const std::filesystem::path& species_file){
+    // Only memory allocated while loading counts, so the temporary buffers that are freed again by the end don't show up
+    long long object_bytes, layer_bytes;
+    std::uint64_t object_hash, layer_hash;
+    int organisms, plants, layer_organisms;
+    std::size_t plant_layer_bytes;
+    {
+        long long bytes_before = allocated_bytes.load();
+        OrganismPool pool;
+        Ecosystem::loadOrganisms(map_file, species_file, pool);
+        object_bytes = allocated_bytes.load() - bytes_before;
+        object_hash = pool.getWorldHash();
+        organisms = pool.size();
+        plants = std::count_if(pool.getOrganisms().begin(), pool.getOrganisms().end(), [](const Organism* org) { return org->getType() == Organism::PlantEnum; });
+    }
+    {
+        long long bytes_before = allocated_bytes.load();
+        OrganismPool pool;
+        Ecosystem::loadOrganisms(map_file, species_file, pool, true);
+        layer_bytes = allocated_bytes.load() - bytes_before;
+        layer_hash = pool.getWorldHash();
+        layer_organisms = pool.size();
+        plant_layer_bytes = pool.getPlantLayer().getMemoryUsage();
+    }
+
+    std::cout << "Map: " << map_file.string() << " (" << organisms << " organisms, " << plants << " of them plants)\n";
+    std::cout << "Plants as objects: " << object_bytes << " bytes\n";
+    std::cout << "Plants in layer:   " << layer_bytes << " bytes (" << layer_organisms << " animal objects, plant layer is " << plant_layer_bytes << " bytes)\n";
+    std::cout << "Layered world uses " << std::fixed << std::setprecision(1) << (100.0 * layer_bytes / std::max(1LL, object_bytes)) << "% of the memory\n";
+
+    if (object_hash != layer_hash){
+        std::cout << "FAIL: the two worlds have different world hashes\n";
+        return 1;
+    }
+    return 0;
+}
+
+/*
+- Generate a width x height map, then run queries queries of radius radius through a SpatialIndex and check every answer against a
+  search through every organism. Prints how long both take per query
+- Returns 1 if any answer was different, 0 otherwise
+*/
+static int runSpatialCheck(const std::filesystem::path& species_file, int width, int height, double density, int radius, int queries){
+    std::tuple<int, int> map_dimensions {width, height};
+    OrganismPool organisms;
+    Ecosystem::generateOrganisms(map_dimensions, density, species_file, 1, organisms);
+    const std::vector<Organism*>& orgs = organisms.getOrganisms();
+    if (orgs.empty()){
+        std::cout << "FAIL: map is empty\n";
+        return 1;
+    }
+
+    SpatialIndex spatial_index;
+    auto build_start = std::chrono::steady_clock::now();
+    spatial_index.build(orgs, map_dimensions);
+    double build_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - build_start).count();
+
+    // Query from the cell of a random organism, so every query has something to look for
+    std::mt19937 rng(2);
+    std::uniform_int_distribution<int> org_roll(0, orgs.size() - 1);
+    std::vector<Organism*> found, expected;
+    double index_ms = 0, brute_force_ms = 0;
+    long long results = 0;
+    for (int i = 0; i < queries; i++){
+        const Organism* center = orgs[org_roll(rng)];
+
+        auto index_start = std::chrono::steady_clock::now();
+        found.clear();
+        spatial_index.findWithin(center->getCoords(), radius, found);
+        Organism* nearest_prey = spatial_index.findNearestPrey(center, radius);
+        Organism* nearest_predator = spatial_index.findNearestPredator(center, radius);
+        auto index_end = std::chrono::steady_clock::now();
+
+        expected.clear();
+        Organism* expected_prey = nullptr;
+        Organism* expected_predator = nullptr;
+        auto closer = [&](Organism* org, Organism* best) {
+            if (!best)
+                return true;
+            int distance = SpatialIndex::getDistance(org->getCoords(), center->getCoords()), best_distance = SpatialIndex::getDistance(best->getCoords(), center->getCoords());
+            return distance < best_distance || (distance == best_distance && org->getID() < best->getID());
+        };
+        for (Organism* org : orgs){
+            if (!org->isAlive() || SpatialIndex::getDistance(org->getCoords(), center->getCoords()) > radius)
+                continue;
+            expected.push_back(org);
+            if (org != center && center->isPredatorTo(org) && closer(org, expected_prey))
+                expected_prey = org;
+            if (org != center && org->isPredatorTo(center) && closer(org, expected_predator))
+                expected_predator = org;
+        }
+        auto brute_force_end = std::chrono::steady_clock::now();
+
+        index_ms += std::chrono::duration<double, std::milli>(index_end - index_start).count();
+        brute_force_ms += std::chrono::duration<double, std::milli>(brute_force_end - index_end).count();
+        results += found.size();
+
+        std::sort(found.begin(), found.end());
+        std::sort(expected.begin(), expected.end());
+        if (found != expected || nearest_prey != expected_prey || nearest_predator != expected_predator){
+            std::cout << "FAIL: query " << i << " around (" << std::get<0>(center->getCoords()) << ", " << std::get<1>(center->getCoords()) << ") gave a different answer than a full search\n";
+            return 1;
+        }
+    }
+
+    std::cout << orgs.size() << " organisms on a " << width << "x" << height << " map, radius " << radius << '\n';
+    std::cout << "Index built in " << std::fixed << std::setprecision(3) << build_ms << " ms, " << (double(results) / queries) << " organisms found per query\n";
+    std::cout << "Index: " << std::setprecision(4) << (index_ms * 1000 / queries) << " us/query, full search: " << (brute_force_ms * 1000 / queries) << " us/query\n";
+    std::cout << "PASS: " << queries << " queries matched a full search\n";
+    return 0;
+}
+
+/*
+- Churn a pool the way a world where organisms are born and die would: every tick, insert spawns_per_tick organisms, then erase about half
+  as many in one eraseIf() pass and about half as many more one at a time with erase(), for ticks ticks
+- Checks that every live handle still gets its own organism, that every handle of an erased organism is rejected, and that eraseIf() keeps
+  the rest in order. Then checks that a pool with a tiny max generation retires its slots instead of wrapping around to handles it gave out
+- Returns 1 if any check failed, 0 otherwise
+*/
+static int runHandleCheck(int ticks, int spawns_per_tick){
+    std::mt19937 rng(3);
+    OrganismPool organisms;
+    std::vector<std::pair<OrganismHandle, Organism*>> live; // Every organism in the pool, with its handle
+    std::vector<OrganismHandle> stale; // Handles of every organism that was erased
+    std::vector<Organism*> expected_order;
+    double spawn_ms = 0, despawn_ms = 0;
+    std::chrono::steady_clock::time_point start;
+
+    auto fail = [](const std::string& message, int tick){
+        std::cout << "FAIL: " << message << " (tick " << tick << ")\n";
+        return 1;
+    };
+
+    for (int tick = 0; tick < ticks; tick++){
+        start = std::chrono::steady_clock::now();
+        for (int i = 0; i < spawns_per_tick; i++){
+            Organism* org = new Plant('p', 1, 1, {i % 1000, i / 1000});
+            live.push_back({organisms.insert(org), org});
+        }
+        spawn_ms += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+        // Erase a random half of spawns_per_tick in one pass. Everything else should stay in the order it was in
+        std::bernoulli_distribution erase_roll(0.5 * spawns_per_tick / std::max<std::size_t>(1, live.size()));
+        std::vector<char> erasing(live.size());
+        std::unordered_set<const Organism*> erased;
+        for (std::size_t i = 0; i < live.size(); i++){
+            erasing[i] = erase_roll(rng);
+            if (erasing[i])
+                erased.insert(live[i].second);
+        }
+        expected_order.clear();
+        for (Organism* org : organisms.getOrganisms()){
+            if (!erased.count(org))
+                expected_order.push_back(org);
+        }
+
+        start = std::chrono::steady_clock::now();
+        int erased_count = organisms.eraseIf([&erased](const Organism* org) { return erased.count(org) > 0; });
+        despawn_ms += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        if (erased_count != static_cast<int>(erased.size()) || organisms.getOrganisms() != expected_order)
+            return fail("eraseIf() didn't erase exactly the organisms asked for, in order", tick);
+
+        std::size_t kept = 0, new_stale = stale.size();
+        for (std::size_t i = 0; i < live.size(); i++){
+            if (erasing[i])
+                stale.push_back(live[i].first);
+            else
+                live[kept++] = live[i];
+        }
+        live.resize(kept);
+
+        // Erase another half of spawns_per_tick one at a time. Erasing a handle that was already erased does nothing
+        start = std::chrono::steady_clock::now();
+        for (int i = 0; i < spawns_per_tick / 2 && !live.empty(); i++){
+            std::size_t index = std::uniform_int_distribution<std::size_t>(0, live.size() - 1)(rng);
+            if (!organisms.erase(live[index].first))
+                return fail("erase() refused a live handle", tick);
+            stale.push_back(live[index].first);
+            live[index] = live.back();
+            live.pop_back();
+        }
+        despawn_ms += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+        for (std::size_t i = new_stale; i < stale.size(); i++){
+            if (organisms.contains(stale[i]) || organisms.get(stale[i]) || organisms.erase(stale[i]))
+                return fail("a handle to an erased organism was accepted", tick);
+        }
+        if (organisms.size() != static_cast<int>(live.size()))
+            return fail("the pool has " + std::to_string(organisms.size()) + " organisms instead of " + std::to_string(live.size()), tick);
+    }
+
+    // Every handle ever given out, one last time
+    for (const std::pair<OrganismHandle, Organism*>& handle : live){
+        if (organisms.get(handle.first) != handle.second)
+            return fail("a live handle got the wrong organism", ticks);
+    }
+    for (const OrganismHandle& handle : stale){
+        if (organisms.contains(handle))
+            return fail("a handle to an erased organism was accepted", ticks);
+    }
+
+    // A slot is reused until its generation reaches the max, then retired. Handles from any generation of it must stay stale
+    const std::uint32_t MAX_GENERATION = 3;
+    OrganismPool small_pool(MAX_GENERATION);
+    std::vector<OrganismHandle> small_handles;
+    for (std::uint32_t i = 0; i < 4 * MAX_GENERATION; i++){
+        OrganismHandle handle = small_pool.insert(new Plant('p', 1, 1, {0, 0}));
+        if (std::find(small_handles.begin(), small_handles.end(), handle) != small_handles.end() || handle.generation >= MAX_GENERATION)
+            return fail("a handle was given out twice (generation " + std::to_string(handle.generation) + ")", ticks);
+        small_handles.push_back(handle);
+        small_pool.erase(handle);
+    }
+    for (const OrganismHandle& handle : small_handles){
+        if (small_pool.contains(handle))
+            return fail("a handle to a retired slot was accepted", ticks);
+    }
+    small_pool.insert(new Plant('p', 1, 1, {0, 0}));
+    small_pool.clear();
+    for (const OrganismHandle& handle : small_handles){
+        if (small_pool.contains(handle))
+            return fail("a handle was accepted after clear()", ticks);
+    }
+
+    long long despawns = stale.size();
+    std::cout << ticks << " ticks of " << spawns_per_tick << " spawns, " << despawns << " despawns, " << live.size() << " organisms left\n";
+    std::cout << "Spawn: " << std::fixed << std::setprecision(1) << (1e6 * spawn_ms / std::max(1LL, static_cast<long long>(ticks) * spawns_per_tick))
+        << " ns, despawn: " << (1e6 * despawn_ms / std::max(1LL, despawns)) << " ns (both including the organism's allocation)\n";
+    std::cout << "PASS: live handles got their organisms, " << (stale.size() + small_handles.size()) << " stale handles were rejected, and retired slots weren't reused\n";
+    return 0;
+}
+
+/*
+Result of timing one configuration of the scaling benchmark
+*/
+struct ScalingResult {
+    std::string scaling; // "strong" or "weak"
+    int threads{};
+    std::tuple<int, int> map_dimensions;
+    int organisms{}; // Organisms at the start of the run
+    int final_organisms{}; // Organisms at the end of the run. Should be the same for every thread count in strong scaling
+    std::uint64_t final_hash{}; // World hash at the end of the run. Should also be the same for every thread count in strong scaling
+    double mean_ms{}, p50_ms{}, p90_ms{}, p99_ms{}, max_ms{};
+    double speedup{}, efficiency{};
+};
+
+/*
+- Generate a map of size map_dimensions and time iterations iterations of ParallelEngine with thread_count threads on it
+*/
+static ScalingResult timeParallelEngine(const std::filesystem::path& species_file, const std::tuple<int, int>& map_dimensions, double density, int thread_count, int iterations, unsigned int seed){
+    OrganismPool organisms;
+    Ecosystem::generateOrganisms(map_dimensions, density, species_file, seed, organisms);
+    ParallelEngine engine(thread_count, seed);
+
+    ScalingResult result;
+    result.threads = thread_count;
+    result.map_dimensions = map_dimensions;
+    result.organisms = organisms.size();
+
+    std::vector<double> iteration_ms;
+    for (int iteration = 1; iteration <= iterations; iteration++){
+        auto start = std::chrono::steady_clock::now();
+        engine.update(organisms, map_dimensions, iteration);
+        auto end = std::chrono::steady_clock::now();
+        iteration_ms.push_back(std::chrono::duration<double, std::milli>(end - start).count());
+    }
+    result.final_organisms = organisms.size();
+    result.final_hash = organisms.getWorldHash();
+
+    // Latency percentiles (nearest rank)
+    std::sort(iteration_ms.begin(), iteration_ms.end());
+    auto percentile = [&](double p) { return iteration_ms[std::min<int>(iteration_ms.size() - 1, p * iteration_ms.size())]; };
+    double total_ms = 0;
+    for (double ms : iteration_ms)
+        total_ms += ms;
+    result.mean_ms = total_ms / iteration_ms.size();
+    result.p50_ms = percentile(0.50);
+    result.p90_ms = percentile(0.90);
+    result.p99_ms = percentile(0.99);
+    result.max_ms = iteration_ms.back();
+    return result;
+}
+
+/*
+- Strong scaling: the same map (STRONG_DIMENSIONS) is run with 1 to max_threads threads
+- Weak scaling: every thread gets its own WEAK_ROWS_PER_THREAD rows of map, so the map grows with the number of threads
+- Writes <output_prefix>.json (everything) and <output_prefix>.csv (one row per run, for plotting)
+*/
+static int runScalingBenchmark(const std::filesystem::path& species_file, int max_threads, int iterations, const std::string& output_prefix){
+    const std::tuple<int, int> STRONG_DIMENSIONS = {1024, 1024};
+    const int WEAK_WIDTH = 1024;
+    const int WEAK_ROWS_PER_THREAD = 256;
+    const double DENSITY = 0.05;
+    const unsigned int SEED = 1;
+
+    std::vector<ScalingResult> results;
+    for (const std::string scaling : {"strong", "weak"}){
+        double single_thread_mean_ms = 0;
+        for (int threads = 1; threads <= max_threads; threads++){
+            std::tuple<int, int> map_dimensions = STRONG_DIMENSIONS;
+            if (scaling == "weak")
+                map_dimensions = {WEAK_WIDTH, WEAK_ROWS_PER_THREAD * threads};
+
+            ScalingResult result = timeParallelEngine(species_file, map_dimensions, DENSITY, threads, iterations, SEED);
+            result.scaling = scaling;
+            if (threads == 1)
+                single_thread_mean_ms = result.mean_ms;
+
+            // Strong scaling: speedup = T(1) / T(n). Weak scaling: work grows with n, so speedup = n * T(1) / T(n)
+            double work_ratio = (scaling == "weak") ? threads : 1;
+            result.speedup = work_ratio * single_thread_mean_ms / result.mean_ms;
+            result.efficiency = result.speedup / threads;
+            results.push_back(result);
+
+            std::cerr << scaling << " scaling, " << threads << " thread(s), " << std::get<0>(map_dimensions) << "x" << std::get<1>(map_dimensions)
+                << ": mean " << result.mean_ms << " ms, speedup " << result.speedup << ", efficiency " << result.efficiency << '\n';
+        }
+    }
+
+    std::ofstream json_file(output_prefix + ".json");
+    json_file << std::fixed << std::setprecision(4);
+    json_file << "{\n  \"hardware_threads\": " << std::thread::hardware_concurrency() << ",\n  \"iterations\": " << iterations << ",\n  \"density\": " << DENSITY << ",\n  \"seed\": " << SEED << ",\n  \"runs\": [\n";
+    for (int i = 0; i < results.size(); i++){
+        const ScalingResult& r = results[i];
+        json_file << "    {\"scaling\": \"" << r.scaling << "\", \"threads\": " << r.threads
+            << ", \"width\": " << std::get<0>(r.map_dimensions) << ", \"height\": " << std::get<1>(r.map_dimensions)
+            << ", \"organisms\": " << r.organisms << ", \"final_organisms\": " << r.final_organisms << ", \"final_hash\": \"" << std::hex << r.final_hash << std::dec << "\""
+            << ", \"speedup\": " << r.speedup << ", \"efficiency\": " << r.efficiency
+            << ", \"iteration_ms\": {\"mean\": " << r.mean_ms << ", \"p50\": " << r.p50_ms << ", \"p90\": " << r.p90_ms << ", \"p99\": " << r.p99_ms << ", \"max\": " << r.max_ms << "}}"
+            << (i + 1 < results.size() ? ",\n" : "\n");
+    }
+    json_file << "  ]\n}\n";
+
+    std::ofstream csv_file(output_prefix + ".csv");
+    csv_file << std::fixed << std::setprecision(4);
+    csv_file << "scaling,threads,width,height,organisms,mean_ms,p50_ms,p90_ms,p99_ms,speedup,efficiency\n";
+    for (const ScalingResult& r : results){
+        csv_file << r.scaling << ',' << r.threads << ',' << std::get<0>(r.map_dimensions) << ',' << std::get<1>(r.map_dimensions) << ',' << r.organisms << ','
+            << r.mean_ms << ',' << r.p50_ms << ',' << r.p90_ms << ',' << r.p99_ms << ',' << r.speedup << ',' << r.efficiency << '\n';
+    }
+
+    std::cout << "Wrote " << output_prefix << ".json and " << output_prefix << ".csv\n";
+    return 0;
+}
+
+/*
+- Check the batched kernels (Kernels.h) against the code they replace, and time both
+- Regrowth: PlantLayer::regrowAll() vs PlantLayer::regrow() on every cell of a width x width layer, for iterations iterations
+- Every implementation this CPU supports is checked. Returns 1 if any of them gave different plants or revives, 0 otherwise
+*/
+static int runKernelBenchmark(int width, int iterations){
+    std::vector<Kernels::Implementation> implementations {Kernels::ScalarImplementation};
+    if (Kernels::getBestImplementation() == Kernels::AVX2Implementation)
+        implementations.push_back(Kernels::AVX2Implementation);
+    bool failed = false;
+    std::chrono::steady_clock::time_point start;
+
+    // Regrowth: a few species (including one with a negative regrowth coefficient), plants on about 1 in 3 cells, some already dead
+    auto fill = [&](PlantLayer& layer){
+        std::mt19937 fill_rng(2);
+        layer.resize({width, width});
+        int species[] = {layer.addSpecies('a', 1, 5), layer.addSpecies('b', 3, 10), layer.addSpecies('c', 0, 0), layer.addSpecies('d', 0, -2), layer.addSpecies('e', 2, 40)};
+        for (int cell = 0; cell < width * width; cell++){
+            if (std::uniform_int_distribution<int>(0, 2)(fill_rng) != 0)
+                continue;
+            int s = species[std::uniform_int_distribution<int>(0, 4)(fill_rng)];
+            bool alive = std::uniform_int_distribution<int>(0, 1)(fill_rng);
+            layer.addPlant(layer.getCoords(cell), s, std::uniform_int_distribution<int>(0, 40)(fill_rng), alive);
+        }
+    };
+    // Same animals standing on the same cells and eating the same plants for every layer
+    auto is_occupied = [](int cell, int iteration) { return ((static_cast<unsigned int>(cell) * 2654435761u) ^ (iteration * 40503u)) % 7 == 0; };
+    auto eat_some = [&](PlantLayer& layer, int iteration){
+        for (int cell = iteration % 13; cell < width * width; cell += 13){
+            if (layer.hasPlant(cell) && layer.isAlive(cell))
+                layer.eat(cell);
+        }
+    };
+
+    OrganismPool expected_pool;
+    PlantLayer& expected = expected_pool.getPlantLayer();
+    fill(expected);
+    int expected_revives = 0;
+    double per_cell_ms = 0;
+    for (int iteration = 1; iteration <= iterations; iteration++){
+        eat_some(expected, iteration);
+        start = std::chrono::steady_clock::now();
+        for (int cell = 0; cell < width * width; cell++){
+            bool was_alive = expected.hasPlant(cell) && expected.isAlive(cell);
+            expected.regrow(cell, is_occupied(cell, iteration));
+            expected_revives += !was_alive && expected.hasPlant(cell) && expected.isAlive(cell);
+        }
+        per_cell_ms += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+    std::cout << "Regrowth, " << width << "x" << width << " layer with " << expected.getPlantCount() << " plants x " << iterations << " iterations (" << expected_revives << " revives):\n";
+    std::cout << "  " << std::setw(8) << "per cell" << ": " << std::fixed << std::setprecision(3) << (1e6 * per_cell_ms / (double(width) * width * iterations)) << " ns/cell\n";
+
+    for (Kernels::Implementation implementation : implementations){
+        OrganismPool pool;
+        PlantLayer& layer = pool.getPlantLayer();
+        fill(layer);
+        std::vector<int> ready;
+        int revives = 0;
+        double kernel_ms = 0;
+        for (int iteration = 1; iteration <= iterations; iteration++){
+            eat_some(layer, iteration);
+            start = std::chrono::steady_clock::now();
+            layer.regrowAll(ready, implementation);
+            for (int cell : ready){
+                if (!is_occupied(cell, iteration)){
+                    layer.revive(cell);
+                    revives++;
+                }
+            }
+            kernel_ms += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        }
+
+        bool same = revives == expected_revives && pool.getWorldHash() == expected_pool.getWorldHash();
+        for (int cell = 0; cell < width * width && same; cell++){
+            same = layer.hasPlant(cell) == expected.hasPlant(cell);
+            if (same && layer.hasPlant(cell))
+                same = layer.isAlive(cell) == expected.isAlive(cell) && layer.getCurrentHealth(cell) == expected.getCurrentHealth(cell);
+        }
+        failed |= !same;
+        std::cout << "  " << std::setw(8) << Kernels::getName(implementation) << ": " << (1e6 * kernel_ms / (double(width) * width * iterations)) << " ns/cell, "
+            << std::setprecision(1) << (per_cell_ms / kernel_ms) << "x, " << (same ? "same" : "DIFFERENT") << " plants and revives\n" << std::setprecision(3);
+    }
+
+    std::cout << (failed ? "FAIL" : "PASS") << ": kernels " << (failed ? "don't match" : "match") << " the code they replace\n";
+    return failed ? 1 : 0;
+}
+
+/*
+- Options for runTiledBenchmark()
+*/
+struct TiledOptions {
+    std::size_t memory_limit{0}; // Bytes of plant tiles to keep resident. 0 = keep the plant layer in memory
+    std::filesystem::path store_directory{std::filesystem::temp_directory_path()};
+    bool check{false}; // Also run the same world fully in memory and compare
+};
+
+/*
+- Make a width x height world for the layered engine: plants on about plant_density of all cells (straight into the plant layer, so there's
+  never a Plant object per cell) and animal_count animals on random cells. The same seed always makes the same world
+- About grazed_fraction of the plants start out eaten, partway through regrowing, all over the map. That's a world animals have grazed
+  sparsely, where dead plants are everywhere and not just near the animals there are now
+*/
+static void makeTiledWorld(const std::filesystem::path& species_file, int width, int height, double plant_density, int animal_count, unsigned int seed, OrganismPool& organisms,
+    double grazed_fraction = 0.0){
+    std::unordered_map<std::string, std::tuple<std::string, std::string, std::string>> species_info;
+    Ecosystem::getSpeciesInfo(species_file, species_info);
+
+    // Sort letter IDs so the world only depends on the seed, not on the order of the unordered map
+    PlantLayer& plant_layer = organisms.getPlantLayer();
+    plant_layer.resize({width, height});
+    std::vector<char> animal_letter_IDs;
+    std::vector<std::tuple<int, int>> plant_species; // Plant layer species index and regrowth coefficient
+    std::vector<char> letter_IDs;
+    for (const auto& species : species_info)
+        letter_IDs.push_back(species.first[0]);
+    std::sort(letter_IDs.begin(), letter_IDs.end());
+    for (char letter_ID : letter_IDs){
+        Organism* org_ptr = Ecosystem::createOrganism(letter_ID, {0, 0}, species_info);
+        if (Plant* plant = dynamic_cast<Plant*>(org_ptr))
+            plant_species.push_back({plant_layer.addSpecies(letter_ID, plant->getEnergyPoints(), plant->getRegrowthCoefficient()), plant->getRegrowthCoefficient()});
+        else if (org_ptr)
+            animal_letter_IDs.push_back(letter_ID);
+        delete org_ptr;
+    }
+    if (plant_species.empty() || animal_letter_IDs.empty()){
+        std::cerr << "Error: " << species_file << " needs at least one plant and one animal species\n";
+        Helper::quit(6);
+    }
+
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<double> cell_roll(0.0, 1.0);
+    std::uniform_int_distribution<int> plant_roll(0, plant_species.size() - 1);
+    for (int y = 0; y < height; y++){
+        for (int x = 0; x < width; x++){
+            if (cell_roll(rng) < plant_density){
+                const std::tuple<int, int>& species = plant_species[plant_roll(rng)];
+                if (grazed_fraction > 0.0 && cell_roll(rng) < grazed_fraction){
+                    std::uniform_int_distribution<int> health_roll(0, std::max(std::get<1>(species) - 1, 0));
+                    plant_layer.addPlant({x, y}, std::get<0>(species), health_roll(rng), false);
+                }
+                else{
+                    plant_layer.addPlant({x, y}, std::get<0>(species), std::get<1>(species), true);
+                }
+            }
+        }
+    }
+
+    std::uniform_int_distribution<int> x_roll(0, width - 1), y_roll(0, height - 1), animal_roll(0, animal_letter_IDs.size() - 1);
+    for (int i = 0; i < animal_count; i++){
+        std::tuple<int, int> coords {x_roll(rng), y_roll(rng)};
+        organisms.insert(Ecosystem::createOrganism(animal_letter_IDs[animal_roll(rng)], coords, species_info));
+    }
+    Ecosystem::reorderOrganisms(organisms, 0.0);
+}
+
+/*
+- Run the layered engine on a generated world (see makeTiledWorld()) whose plant layer is kept in a file with at most options.memory_limit
+  bytes of it in memory (see TileStore), and print time per iteration, memory use and paging
+- With options.check, the same world is also run fully in memory. Returns 1 if the two don't end with the same world hash, 0 otherwise
+*/
+static int runTiledBenchmark(const std::filesystem::path& species_file, int width, int height, double plant_density, int animal_count, int iterations, const TiledOptions& options){
+    auto run = [&](bool file_backed, std::uint64_t& world_hash){
+        Helper::setRandomSeed(1); // Organism colors are random too, so seed before making organisms
+        OrganismPool organisms;
+        if (file_backed)
+            organisms.getPlantLayer().useBackingFile(options.store_directory, options.memory_limit);
+
+        auto start = std::chrono::steady_clock::now();
+        makeTiledWorld(species_file, width, height, plant_density, animal_count, 1, organisms);
+        double load_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+        const char* name = file_backed ? "tiled" : "in memory";
+        const PlantLayer& plant_layer = organisms.getPlantLayer();
+        std::cout << "  " << std::setw(9) << name << ": made " << plant_layer.getPlantCount() << " plants and " << organisms.size() << " animals in " << std::fixed << std::setprecision(1) << load_ms << " ms\n";
+
+        LayeredEngine engine;
+        std::tuple<int, int> map_dimensions {width, height};
+        std::vector<double> iteration_ms;
+        rusage usage_before{};
+        getrusage(RUSAGE_SELF, &usage_before);
+        for (int iteration = 1; iteration <= iterations; iteration++){
+            start = std::chrono::steady_clock::now();
+            engine.update(organisms, map_dimensions, iteration);
+            iteration_ms.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+        }
+        rusage usage{};
+        getrusage(RUSAGE_SELF, &usage);
+        world_hash = organisms.getWorldHash();
+
+        std::sort(iteration_ms.begin(), iteration_ms.end());
+        double total_ms = 0;
+        for (double ms : iteration_ms)
+            total_ms += ms;
+        TileStore::Stats stats = plant_layer.getTileStats();
+        std::cout << "  " << std::setw(9) << name << ": " << std::setprecision(3) << (total_ms / std::max(1, iterations)) << " ms/iteration (p50 "
+            << iteration_ms[iteration_ms.size() / 2] << ", max " << iteration_ms.back() << "), " << organisms.size() << " animals left, world hash "
+            << std::hex << std::setw(16) << std::setfill('0') << world_hash << std::dec << std::setfill(' ') << '\n';
+        std::cout << "  " << std::setw(9) << "" << "  plant layer uses " << std::setprecision(1) << (plant_layer.getMemoryUsage() / 1048576.0) << " MiB";
+        if (file_backed)
+            std::cout << " (peak " << (stats.peak_resident_tiles * TileStore::TILE_BYTES / 1048576.0) << " MiB), " << stats.evictions << " tiles dropped, " << stats.write_backs << " written back";
+        std::cout << ", " << (usage.ru_majflt - usage_before.ru_majflt) << " major page faults while running, max RSS " << (usage.ru_maxrss / 1024.0) << " MiB\n";
+        if (file_backed){
+            std::cout << "  " << std::setw(9) << "" << "  tiles near animals peaked at " << (stats.peak_hot_tiles * TileStore::TILE_BYTES / 1048576.0) << " MiB";
+            if (plant_layer.isOverMemoryLimit())
+                std::cout << ", MORE than the memory limit (they're never dropped, so the limit couldn't be kept)";
+            std::cout << ". The engine's animal keys and grid take another " << (engine.getMemoryUsage() / 1048576.0) << " MiB in memory\n";
+        }
+    };
+
+    std::size_t file_bytes = static_cast<std::size_t>(width) * height * sizeof(std::uint32_t);
+    std::cout << "Layered engine on a " << width << "x" << height << " world (" << std::fixed << std::setprecision(1) << (file_bytes / 1048576.0) << " MiB of plant cells), "
+        << animal_count << " animals, " << iterations << " iterations, memory limit " << (options.memory_limit / 1048576.0) << " MiB:\n";
+    std::uint64_t tiled_hash = 0, memory_hash = 0;
+    run(true, tiled_hash);
+    if (!options.check)
+        return 0;
+
+    run(false, memory_hash);
+    bool same = tiled_hash == memory_hash;
+    std::cout << (same ? "PASS" : "FAIL") << ": tiled world " << (same ? "matches" : "doesn't match") << " the in-memory world\n";
+    return same ? 0 : 1;
+}
+
+/*
+- Run the layered engine and the hybrid engine (see LayeredEngine) on the same generated world (see makeTiledWorld()) with run(), and print
+  how long each took and how far apart their worlds ended up: plants of each species alive and dead, cells that differ, and animals left
+- With grazed_fraction, dead plants start out all over the map. The layered engine regrows every tile with dead plants each iteration, while
+  the hybrid engine only regrows tiles near animals, so that's where hybrid mode pays off most
+- Returns 1 if the hybrid world isn't the same as the layered one, 0 otherwise
+*/
+static int runHybridBenchmark(const std::filesystem::path& species_file, int width, int height, double plant_density, int animal_count, int iterations, double grazed_fraction){
+    std::tuple<int, int> map_dimensions {width, height};
+    auto run = [&](bool hybrid, OrganismPool& organisms){
+        Helper::setRandomSeed(1); // Organism colors are random too, so seed before making organisms
+        makeTiledWorld(species_file, width, height, plant_density, animal_count, 1, organisms, grazed_fraction);
+
+        LayeredEngine engine(hybrid);
+        auto start = std::chrono::steady_clock::now();
+        engine.run(organisms, map_dimensions, 1, iterations);
+        double run_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        std::cout << "  " << std::setw(7) << engine.getName() << ": " << std::fixed << std::setprecision(3) << (run_ms / std::max(1, iterations))
+            << " ms/iteration, " << organisms.size() << " animals left, world hash " << std::hex << std::setw(16) << std::setfill('0')
+            << organisms.getWorldHash() << std::dec << std::setfill(' ') << '\n';
+        return run_ms;
+    };
+
+    std::cout << "Layered vs hybrid engine on a " << width << "x" << height << " world, " << animal_count << " animals, " << iterations << " iterations";
+    if (grazed_fraction > 0.0)
+        std::cout << ", " << (grazed_fraction * 100) << "% of plants grazed";
+    std::cout << ":\n";
+    OrganismPool exact, hybrid;
+    double exact_ms = run(false, exact);
+    double hybrid_ms = run(true, hybrid);
+    std::cout << "  Speedup: " << std::setprecision(2) << (exact_ms / std::max(hybrid_ms, 1e-9)) << "x\n";
+
+    // Plants alive and dead of each species (indexed by plant layer species), and cells that aren't the same
+    const PlantLayer& exact_layer = exact.getPlantLayer();
+    const PlantLayer& hybrid_layer = hybrid.getPlantLayer();
+    std::vector<std::array<long long, 4>> counts(PlantLayer::MAX_SPECIES + 1); // Exact alive, exact dead, hybrid alive, hybrid dead
+    std::vector<char> letter_IDs(PlantLayer::MAX_SPECIES + 1, 0);
+    long long different_cells = 0;
+    for (int cell = 0; cell < width * height; cell++){
+        bool same = exact_layer.hasPlant(cell) == hybrid_layer.hasPlant(cell);
+        if (same && exact_layer.hasPlant(cell))
+            same = exact_layer.isAlive(cell) == hybrid_layer.isAlive(cell) && exact_layer.getCurrentHealth(cell) == hybrid_layer.getCurrentHealth(cell);
+        different_cells += !same;
+
+        for (int layer = 0; layer < 2; layer++){
+            const PlantLayer& plant_layer = layer == 0 ? exact_layer : hybrid_layer;
+            if (!plant_layer.hasPlant(cell))
+                continue;
+            char letter_ID = plant_layer.getSpecies(cell).letter_id;
+            letter_IDs[static_cast<unsigned char>(letter_ID)] = letter_ID;
+            counts[static_cast<unsigned char>(letter_ID)][(2 * layer) + !plant_layer.isAlive(cell)]++;
+        }
+    }
+
+    long long count_error = 0;
+    for (int i = 0; i < letter_IDs.size(); i++){
+        if (!letter_IDs[i])
+            continue;
+        const std::array<long long, 4>& count = counts[i];
+        std::cout << "  Plant " << letter_IDs[i] << ": " << count[0] << " alive, " << count[1] << " dead (layered) vs " << count[2] << " alive, "
+            << count[3] << " dead (hybrid), off by " << (count[2] - count[0]) << " alive\n";
+        count_error += std::llabs(count[2] - count[0]) + std::llabs(count[3] - count[1]);
+    }
+    long long animal_error = static_cast<long long>(hybrid.size()) - static_cast<long long>(exact.size());
+    bool same_hash = exact.getWorldHash() == hybrid.getWorldHash();
+    std::cout << "  " << different_cells << " plant cells differ, animals off by " << animal_error << ", world hashes " << (same_hash ? "match" : "don't match") << '\n';
+
+    bool same = same_hash && different_cells == 0 && count_error == 0 && animal_error == 0;
+    std::cout << (same ? "PASS" : "FAIL") << ": hybrid world " << (same ? "matches" : "doesn't match") << " the layered world\n";
+    return same ? 0 : 1;
+}
+
+/*
+- Print every benchmark mode and its arguments
+*/
+static void printUsage(const char* program){
+    std::cerr << "Usage:\n"
+        << "  " << program << " alloc <map file> <species file> [warmup iterations] [checked iterations]\n"
+        << "  " << program << " scaling <species file> [max threads] [iterations] [output prefix]\n"
+        << "  " << program << " hash <map file> <species file> [iterations] [seed]\n"
+        << "  " << program << " perf <map file> <species file> [iterations] [engine]\n"
+        << "  " << program << " layout <map file> <species file> [iterations]\n"
+        << "  " << program << " memory <map file> <species file>\n"
+        << "  " << program << " spatial <species file> [width] [height] [density] [radius] [queries]\n"
+        << "  " << program << " handles [ticks] [spawns per tick]\n"
+        << "  " << program << " kernels [layer width] [iterations]\n"
+        << "  " << program << " tiled <species file> [width] [height] [plant density] [animals] [iterations] [--memory-limit <MiB>] [--store <directory>] [--check]\n"
+        << "  " << program << " hybrid <species file> [width] [height] [plant density] [animals] [iterations] [grazed fraction]\n";
+}
+
+int main(int argc, char* argv[]){
+    if (argc < 2){
+        printUsage(argv[0]);
+        return 8;
+    }
+
+    std::string mode = argv[1];
+    if (mode == "alloc" && argc >= 4){
+        int warmup_iterations = argc > 4 ? std::atoi(argv[4]) : 100;
+        int check_iterations = argc > 5 ? std::atoi(argv[5]) : 1000;
+        return runAllocationCheck(argv[2], argv[3], warmup_iterations, check_iterations);
+    }
+    if (mode == "scaling" && argc >= 3){
+        int max_threads = argc > 3 ? std::atoi(argv[3]) : std::max(1u, std::thread::hardware_concurrency());
+        int iterations = argc > 4 ? std::atoi(argv[4]) : 50;
+        std::string output_prefix = argc > 5 ? argv[5] : "scaling";
+        return runScalingBenchmark(argv[2], max_threads, iterations, output_prefix);
+    }
+
+    if (mode == "hash" && argc >= 4){
+        int iterations = argc > 4 ? std::atoi(argv[4]) : 1000;
+        unsigned int seed = argc > 5 ? std::strtoul(argv[5], nullptr, 10) : 1;
+        return runHashCheck(argv[2], argv[3], iterations, seed);
+    }
+
+    if (mode == "perf" && argc >= 4){
+        int iterations = argc > 4 ? std::atoi(argv[4]) : 1000;
+        std::string engine_name = argc > 5 ? argv[5] : "reference";
+        return runPerfCounters(argv[2], argv[3], iterations, engine_name);
+    }
+
+    if (mode == "layout" && argc >= 4){
+        int iterations = argc > 4 ? std::atoi(argv[4]) : 1000;
+        return runLayoutComparison(argv[2], argv[3], iterations);
+    }
+
+    if (mode == "memory" && argc >= 4)
+        return runMemoryComparison(argv[2], argv[3]);
+
+    if (mode == "spatial" && argc >= 3){
+        int width = argc > 3 ? std::atoi(argv[3]) : 1000;
+        int height = argc > 4 ? std::atoi(argv[4]) : 1000;
+        double density = argc > 5 ? std::atof(argv[5]) : 0.3;
+        int radius = argc > 6 ? std::atoi(argv[6]) : 10;
+        int queries = argc > 7 ? std::atoi(argv[7]) : 1000;
+        return runSpatialCheck(argv[2], width, height, density, radius, queries);
+    }
+
+    if (mode == "handles"){
+        int ticks = argc > 2 ? std::atoi(argv[2]) : 200;
+        int spawns_per_tick = argc > 3 ? std::atoi(argv[3]) : 5000;
+        return runHandleCheck(ticks, spawns_per_tick);
+    }
+
+    if (mode == "kernels"){
+        int width = argc > 2 ? std::atoi(argv[2]) : 1000;
+        int iterations = argc > 3 ? std::atoi(argv[3]) : 100;
+        return runKernelBenchmark(width, iterations);
+    }
+
+    if (mode == "tiled" && argc >= 3){
+        std::vector<std::string> numbers;
+        TiledOptions options;
+        for (int i = 3; i < argc; i++){
+            std::string argument = argv[i];
+            if (argument == "--memory-limit" && i + 1 < argc)
+                options.memory_limit = static_cast<std::size_t>(std::atof(argv[++i]) * 1048576);
+            else if (argument == "--store" && i + 1 < argc)
+                options.store_directory = argv[++i];
+            else if (argument == "--check")
+                options.check = true;
+            else
+                numbers.push_back(argument);
+        }
+        int width = numbers.size() > 0 ? std::atoi(numbers[0].c_str()) : 4000;
+        int height = numbers.size() > 1 ? std::atoi(numbers[1].c_str()) : 4000;
+        double plant_density = numbers.size() > 2 ? std::atof(numbers[2].c_str()) : 0.3;
+        int animal_count = numbers.size() > 3 ? std::atoi(numbers[3].c_str()) : 1000;
+        int iterations = numbers.size() > 4 ? std::atoi(numbers[4].c_str()) : 100;
+        return runTiledBenchmark(argv[2], width, height, plant_density, animal_count, iterations, options);
+    }
+
+    if (mode == "hybrid" && argc >= 3){
+        int width = argc > 3 ? std::atoi(argv[3]) : 4000;
+        int height = argc > 4 ? std::atoi(argv[4]) : 4000;
+        double plant_density = argc > 5 ? std::atof(argv[5]) : 0.3;
+        int animal_count = argc > 6 ? std::atoi(argv[6]) : 1000;
+        int iterations = argc > 7 ? std::atoi(argv[7]) : 100;
+        double grazed_fraction = argc > 8 ? std::atof(argv[8]) : 0.0;
+        return runHybridBenchmark(argv[2], width, height, plant_density, animal_count, iterations, grazed_fraction);
+    }
+
+    printUsage(argv[0]);
+    return 8;
+}
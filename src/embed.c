@@ -0,0 +1,85 @@
+/*
+Example of embedding the engine through libecosystem's C interface (SimulationC.h)
+- ./embed.bin <map file> <species file> [iterations] [seed]: runs the map in-process and prints the world hash, same as ./bench.bin hash
+- ./embed.bin: builds a small world from arrays instead and prints its populations as it runs
+*/
+#include "SimulationC.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+static char* readFile(const char* path){
+    FILE* file = fopen(path, "rb");
+    if (!file){
+        fprintf(stderr, "Error: Couldn't open %s for reading\n", path);
+        exit(1);
+    }
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    char* text = malloc(size + 1);
+    text[fread(text, 1, size, file)] = '\0';
+    fclose(file);
+    return text;
+}
+
+static int runFiles(const char* map_file, const char* species_file, int iterations, unsigned int seed){
+    char* map_text = readFile(map_file);
+    char* species_text = readFile(species_file);
+
+    ecosystem_simulation* simulation;
+    int error = ecosystem_create_from_text(map_text, species_text, seed, "reference", &simulation);
+    free(map_text);
+    free(species_text);
+    if (error)
+        return error;
+
+    error = ecosystem_step(simulation, iterations);
+    if (!error)
+        printf("World hash after %d iterations (seed %u): %016llx\n", iterations, seed, (unsigned long long)ecosystem_get_world_hash(simulation));
+    ecosystem_destroy(simulation);
+    return error;
+}
+
+static int runArrays(void){
+    const ecosystem_species species[] = {
+        {'g', ECOSYSTEM_PLANT, 3, 4, 0},
+        {'R', ECOSYSTEM_HERBIVORE, 12, 0, 0},
+        {'W', ECOSYSTEM_OMNIVORE, 30, 0, 2}
+    };
+    const char cells[] =
+        "g g g g g "
+        " R    R  g"
+        "g   W    g"
+        " g g  R g "
+        "g   g   g ";
+
+    ecosystem_simulation* simulation;
+    int error = ecosystem_create(species, 3, 10, 5, cells, 1, "grid", &simulation);
+    if (error)
+        return error;
+
+    for (int round = 0; round <= 5 && !error; round++){
+        const int* counts = ecosystem_get_population_counts(simulation);
+        printf("Iteration %lld: %d g, %d R, %d W\n", ecosystem_get_iteration(simulation), counts['g'], counts['R'], counts['W']);
+
+        const char* letters = ecosystem_get_cell_letters(simulation);
+        for (int y = 0; y < ecosystem_get_height(simulation); y++)
+            printf("  |%.*s|\n", ecosystem_get_width(simulation), letters + (y * ecosystem_get_width(simulation)));
+        error = ecosystem_step(simulation, 4);
+    }
+    ecosystem_destroy(simulation);
+    return error;
+}
+
+int main(int argc, char* argv[]){
+    int error;
+    if (argc >= 3)
+        error = runFiles(argv[1], argv[2], argc > 3 ? atoi(argv[3]) : 100, argc > 4 ? (unsigned int)strtoul(argv[4], NULL, 10) : 1);
+    else
+        error = runArrays();
+
+    if (error)
+        fprintf(stderr, "Failed with error code %d\n", error);
+    return error;
+}
@@ -0,0 +1,322 @@
+#include "Engine.h"
+
+#include <iomanip>
+
+/*
+Differential test harness. Runs an engine side by side with the engine it's supposed to match (see Engine::getBaselineName()),
+from the same seed and the same scenario, and compares the whole world after every iteration.
+This is built as harness.bin, separately from ecosystem.bin.
+Usage: ./harness.bin <mode> [mode arguments...] (run without arguments to see every mode)
+*/
+
+/*
+Everything about one organism that affects the simulation
+*/
+struct OrganismState {
+    char letter_id{};
+    Organism::OrganismType type{};
+    std::tuple<int, int> coords;
+    int current_health{};
+    int max_health{};
+    bool alive{};
+
+    bool operator==(const OrganismState& other) const {
+        return letter_id == other.letter_id && type == other.type && coords == other.coords
+            && current_health == other.current_health && max_health == other.max_health && alive == other.alive;
+    }
+    bool operator!=(const OrganismState& other) const { return !(*this == other); }
+};
+
+static std::ostream& operator<<(std::ostream& out, const OrganismState& state){
+    return out << state.letter_id << " at (" << std::get<0>(state.coords) << ", " << std::get<1>(state.coords) << "), health "
+        << state.current_health << "/" << state.max_health << (state.alive ? ", alive" : ", dead");
+}
+
+/*
+Where a scenario comes from: either a map file, or a map generated with Ecosystem::generateOrganisms()
+*/
+struct Scenario {
+    std::filesystem::path map_file; // Empty if the map is generated
+    std::filesystem::path species_file;
+    std::tuple<int, int> generated_dimensions{0, 0};
+    double generated_density{};
+    unsigned int seed{1};
+
+    /*
+    - Command that re-runs this scenario with the harness
+    */
+    std::string getCommand(const std::string& engine_name, int iterations) const {
+        std::ostringstream command;
+        if (map_file.empty())
+            command << "./harness.bin diffgen " << engine_name << ' ' << species_file.string() << ' ' << std::get<0>(generated_dimensions) << ' '
+                << std::get<1>(generated_dimensions) << ' ' << generated_density << ' ' << iterations << ' ' << seed;
+        else
+            command << "./harness.bin diff " << engine_name << ' ' << map_file.string() << ' ' << species_file.string() << ' ' << iterations << ' ' << seed;
+        return command.str();
+    }
+};
+
+/*
+One world being simulated by one engine. Each world has its own random engine so running two worlds side by side doesn't mix up their random numbers
+*/
+struct World {
+    std::unique_ptr<Engine> engine;
+    OrganismPool organisms;
+    std::tuple<int, int> map_dimensions;
+    std::mt19937 rng;
+
+    World(const std::string& engine_name, const Scenario& scenario) {
+        engine = Engine::create(engine_name, scenario.seed);
+        if (!engine){
+            std::cerr << "Error: unknown engine " << engine_name << '\n';
+            Helper::quit(8);
+        }
+
+        // Organism colors are random too, so seed before making organisms
+        Helper::setRandomSeed(scenario.seed);
+        if (scenario.map_file.empty()){
+            map_dimensions = scenario.generated_dimensions;
+            Ecosystem::generateOrganisms(map_dimensions, scenario.generated_density, scenario.species_file, scenario.seed, organisms);
+        }
+        else{
+            map_dimensions = Ecosystem::getMapDimensions(scenario.map_file);
+            Ecosystem::loadOrganisms(scenario.map_file, scenario.species_file, organisms);
+        }
+        rng = Helper::getRandomEngine();
+    }
+
+    void update(int iteration) {
+        Helper::getRandomEngine() = rng;
+        engine->update(organisms, map_dimensions, iteration);
+        rng = Helper::getRandomEngine();
+    }
+
+    void run(int first_iteration, int iteration_count) {
+        Helper::getRandomEngine() = rng;
+        engine->run(organisms, map_dimensions, first_iteration, iteration_count);
+        rng = Helper::getRandomEngine();
+    }
+
+    /*
+    - State of every organism, plants in the plant layer included, sorted by position
+    - Engines keep organisms in different places (and orders), so only what's in the world is compared, not where it's stored
+    */
+    void getState(std::vector<OrganismState>& state) const {
+        state.clear();
+        for (const Organism* org : organisms.getOrganisms())
+            state.push_back({org->getLetterID(), org->getType(), org->getCoords(), org->getCurrentHealth(), org->getMaxHealth(), org->isAlive()});
+
+        const PlantLayer& plant_layer = organisms.getPlantLayer();
+        for (int cell = 0; cell < plant_layer.getWidth() * plant_layer.getHeight(); cell++){
+            if (!plant_layer.hasPlant(cell))
+                continue;
+            const PlantLayer::Species& species = plant_layer.getSpecies(cell);
+            state.push_back({species.letter_id, Organism::PlantEnum, plant_layer.getCoords(cell), plant_layer.getCurrentHealth(cell), species.regrowth_coefficient, plant_layer.isAlive(cell)});
+        }
+
+        std::sort(state.begin(), state.end(), [](const OrganismState& a, const OrganismState& b) {
+            return std::tie(a.coords, a.type, a.letter_id, a.alive, a.current_health, a.max_health) < std::tie(b.coords, b.type, b.letter_id, b.alive, b.current_health, b.max_health);
+        });
+    }
+};
+
+/*
+- Print the area of the map around center (in state) as letters. Dead organisms are shown as '.'
+*/
+static void printArea(const std::vector<OrganismState>& state, const std::tuple<int, int>& center, int radius){
+    int center_x = std::get<0>(center), center_y = std::get<1>(center);
+    for (int y = center_y - radius; y <= center_y + radius; y++){
+        std::cout << "    ";
+        for (int x = center_x - radius; x <= center_x + radius; x++){
+            char c = ' ';
+            for (const OrganismState& org : state){
+                if (org.coords == std::tuple<int, int>{x, y})
+                    c = (org.alive ? org.letter_id : (c == ' ' ? '.' : c));
+            }
+            std::cout << c;
+        }
+        std::cout << "|\n";
+    }
+}
+
+/*
+- What an OK line says about how engine_name relates to the reference engine: nothing if it matches the reference engine, otherwise a note that
+  matching its baseline doesn't make it equivalent to "reference"
+*/
+static std::string getEquivalenceNote(const std::string& engine_name){
+    if (Engine::isEquivalentToReference(engine_name))
+        return "";
+    return ", NOT equivalent to reference (updates organisms in a different order by design)";
+}
+
+/*
+- Run engine_name and its baseline side by side for iterations iterations, comparing every organism after every iteration
+- On the first divergence, print a minimal reproducer: the command to re-run it, the first organism that differs, and the area around it
+  right before the iteration where things went wrong
+- Returns true if the worlds never diverged
+*/
+static bool runDifferential(const std::string& engine_name, const Scenario& scenario, int iterations, bool verbose){
+    std::string baseline_name = Engine::getBaselineName(engine_name);
+    World baseline(baseline_name, scenario);
+    World candidate(engine_name, scenario);
+
+    std::vector<OrganismState> previous_state, baseline_state, candidate_state;
+    baseline.getState(previous_state);
+    for (int iteration = 1; iteration <= iterations; iteration++){
+        baseline.update(iteration);
+        candidate.update(iteration);
+
+        // Comparing hashes is cheap, but the full state is compared too in case of a hash collision
+        baseline.getState(baseline_state);
+        candidate.getState(candidate_state);
+        if (baseline.organisms.getWorldHash() == candidate.organisms.getWorldHash() && baseline_state == candidate_state){
+            previous_state.swap(baseline_state);
+            continue;
+        }
+
+        std::cout << "DIVERGED: " << engine_name << " vs " << baseline_name << " at iteration " << iteration << '\n';
+        std::cout << "  Reproduce with: " << scenario.getCommand(engine_name, iteration) << '\n';
+        if (baseline_state.size() != candidate_state.size())
+            std::cout << "  Organism count: " << baseline_name << " has " << baseline_state.size() << ", " << engine_name << " has " << candidate_state.size() << '\n';
+
+        for (int i = 0; i < std::min(baseline_state.size(), candidate_state.size()); i++){
+            if (baseline_state[i] == candidate_state[i])
+                continue;
+
+            std::cout << "  First difference at organism #" << i << ":\n";
+            std::cout << "    " << baseline_name << ": " << baseline_state[i] << '\n';
+            std::cout << "    " << engine_name << ": " << candidate_state[i] << '\n';
+            if (i < previous_state.size()){
+                std::cout << "    before iteration " << iteration << ": " << previous_state[i] << '\n';
+                std::cout << "  Area around it before iteration " << iteration << ":\n";
+                printArea(previous_state, previous_state[i].coords, 3);
+            }
+            break;
+        }
+        return false;
+    }
+
+    if (verbose)
+        std::cout << "OK: " << engine_name << " matched " << baseline_name << " for " << iterations << " iterations (" << scenario.getCommand(engine_name, iterations) << ")"
+            << getEquivalenceNote(engine_name) << '\n';
+    return true;
+}
+
+/*
+- Run runDifferential() on cases randomly generated scenarios (random map size, density and seed)
+- Returns true if none of them diverged
+*/
+static bool runFuzz(const std::string& engine_name, const std::filesystem::path& species_file, int cases, int iterations, unsigned int fuzz_seed){
+    std::mt19937 rng(fuzz_seed);
+    std::uniform_int_distribution<int> size_roll(1, 48);
+    std::uniform_real_distribution<double> density_roll(0.02, 0.9);
+    std::uniform_int_distribution<unsigned int> seed_roll;
+
+    for (int i = 0; i < cases; i++){
+        Scenario scenario;
+        scenario.species_file = species_file;
+        scenario.generated_dimensions = {size_roll(rng), size_roll(rng)};
+        scenario.generated_density = std::round(density_roll(rng) * 100) / 100; // Rounded so the reproducer command gives the exact same density
+        scenario.seed = seed_roll(rng);
+        if (!runDifferential(engine_name, scenario, iterations, false))
+            return false;
+    }
+
+    std::cout << "OK: " << engine_name << " matched " << Engine::getBaselineName(engine_name) << " on " << cases << " random scenarios (" << iterations << " iterations each)"
+        << getEquivalenceNote(engine_name) << '\n';
+    return true;
+}
+
+/*
+- Time engine_name and its baseline separately on the same scenario, and check that they end up in the same state
+*/
+static bool runThroughput(const std::string& engine_name, const Scenario& scenario, int iterations){
+    std::string baseline_name = Engine::getBaselineName(engine_name);
+    double milliseconds[2];
+    std::uint64_t final_hashes[2];
+    int final_organisms[2];
+
+    const std::string names[2] = {baseline_name, engine_name};
+    for (int i = 0; i < 2; i++){
+        World world(names[i], scenario);
+        auto start = std::chrono::steady_clock::now();
+        world.run(1, iterations);
+        auto end = std::chrono::steady_clock::now();
+
+        milliseconds[i] = std::chrono::duration<double, std::milli>(end - start).count();
+        final_hashes[i] = world.organisms.getWorldHash();
+        final_organisms[i] = world.organisms.size() + world.organisms.getPlantLayer().getPlantCount();
+        std::cout << std::setw(12) << names[i] << ": " << std::fixed << std::setprecision(3) << (milliseconds[i] / iterations) << " ms/iteration, "
+            << final_organisms[i] << " organisms left, world hash " << std::hex << final_hashes[i] << std::dec << '\n';
+    }
+
+    std::cout << "Speedup: " << std::fixed << std::setprecision(2) << (milliseconds[0] / milliseconds[1]) << "x\n";
+    if (final_hashes[0] != final_hashes[1] || final_organisms[0] != final_organisms[1]){
+        std::cout << "DIVERGED: final states don't match. Run diff mode to find where\n";
+        return false;
+    }
+    std::cout << "Final states match" << getEquivalenceNote(engine_name) << '\n';
+    return true;
+}
+
+/*
+- Print every harness mode and its arguments
+*/
+static void printUsage(const char* program){
+    std::cerr << "Usage:\n"
+        << "  " << program << " diff <engine> <map file> <species file> [iterations] [seed]\n"
+        << "  " << program << " diffgen <engine> <species file> <width> <height> <density> [iterations] [seed]\n"
+        << "  " << program << " fuzz <engine> <species file> [cases] [iterations] [fuzz seed]\n"
+        << "  " << program << " throughput <engine> <map file> <species file> [iterations] [seed]\n"
+        << "Engines: grid, grid:morton, parallel:N (N > 1), layered, hybrid, processes:N[:shm] (see Engine::create()). reference, reference:morton and parallel:1 are baselines, so they can't be checked\n";
+}
+
+int main(int argc, char* argv[]){
+    if (argc < 4){
+        printUsage(argv[0]);
+        return 8;
+    }
+
+    std::string mode = argv[1];
+    std::string engine_name = argv[2];
+    Scenario scenario;
+
+    // An engine compared with itself always matches, which would look like it had been checked
+    std::unique_ptr<Engine> engine = Engine::create(engine_name, 1);
+    if (!engine){
+        std::cerr << "Error: unknown engine " << engine_name << '\n';
+        return 8;
+    }
+    if (engine->getName() == Engine::getBaselineName(engine->getName())){
+        std::cerr << "Error: " << engine_name << " is the baseline other engines are checked against, so there's nothing to compare it with\n";
+        return 8;
+    }
+    engine.reset();
+
+    if ((mode == "diff" || mode == "throughput") && argc >= 5){
+        scenario.map_file = argv[3];
+        scenario.species_file = argv[4];
+        int iterations = argc > 5 ? std::atoi(argv[5]) : 1000;
+        scenario.seed = argc > 6 ? std::strtoul(argv[6], nullptr, 10) : 1;
+        if (mode == "diff")
+            return runDifferential(engine_name, scenario, iterations, true) ? 0 : 1;
+        return runThroughput(engine_name, scenario, iterations) ? 0 : 1;
+    }
+    if (mode == "diffgen" && argc >= 7){
+        scenario.species_file = argv[3];
+        scenario.generated_dimensions = {std::atoi(argv[4]), std::atoi(argv[5])};
+        scenario.generated_density = std::atof(argv[6]);
+        int iterations = argc > 7 ? std::atoi(argv[7]) : 1000;
+        scenario.seed = argc > 8 ? std::strtoul(argv[8], nullptr, 10) : 1;
+        return runDifferential(engine_name, scenario, iterations, true) ? 0 : 1;
+    }
+    if (mode == "fuzz"){
+        int cases = argc > 4 ? std::atoi(argv[4]) : 100;
+        int iterations = argc > 5 ? std::atoi(argv[5]) : 200;
+        unsigned int fuzz_seed = argc > 6 ? std::strtoul(argv[6], nullptr, 10) : 1;
+        return runFuzz(engine_name, argv[3], cases, iterations, fuzz_seed) ? 0 : 1;
+    }
+
+    printUsage(argv[0]);
+    return 8;
+}
@@ -1,7 +1,79 @@
-#include "Ecosystem.h"
+#include "SimulationController.h"
+#include "MetricsExporter.h"
+#include "JobService.h"
+#include "LayeredEngine.h"
+
+#include <csignal>
+
+/*
+- Run as a batch job service: ecosystem.bin --serve <spool directory> [--threads N] [--once] (see JobService)
+*/
+static void serve(int argc, char* argv[]){
+    if (argc < 3){
+        std::cerr << "Error: --serve needs a spool directory. Usage: --serve <spool directory> [--threads N] [--once]\n";
+        Helper::quit(8);
+    }
+
+    std::filesystem::path spool_directory = argv[2];
+    int thread_count = std::max(1u, std::thread::hardware_concurrency());
+    bool exit_when_idle = false;
+    for (int i = 3; i < argc; i++){
+        std::string option = argv[i];
+        if (option == "--threads" && i + 1 < argc && std::atoi(argv[i + 1]) > 0)
+            thread_count = std::atoi(argv[++i]);
+        else if (option == "--once")
+            exit_when_idle = true;
+        else {
+            std::cerr << "Error: Unknown command line argument " << option << ". Options: --threads <N> --once\n";
+            Helper::quit(8);
+        }
+    }
+
+    // Ctrl+C lets the jobs that are running finish instead of leaving them half done
+    std::signal(SIGINT, [](int) { JobService::requestStop(); });
+    std::signal(SIGTERM, [](int) { JobService::requestStop(); });
+
+    JobService service(spool_directory, thread_count, exit_when_idle);
+    service.run();
+    Helper::quit(service.getJobsFailed() == 0 ? 0 : 12);
+}
+
+/*
+- Convert a map between the text and binary formats: ecosystem.bin --convert-map <input map> <output map> (see MapFile)
+*/
+static void convertMap(int argc, char* argv[]){
+    if (argc != 4){
+        std::cerr << "Error: Usage: --convert-map <input map> <output map>\n";
+        Helper::quit(8);
+    }
+    MapFile::convert(argv[2], argv[3]);
+    Helper::quit(0);
+}
+
+/*
+- Print how much memory the plant layer ended up taking against its memory limit (--memory-limit), and what the engine keeps in memory besides
+*/
+static void printMemorySummary(const OrganismPool& organisms, const Engine& engine){
+    const PlantLayer& plant_layer = organisms.getPlantLayer();
+    if (!plant_layer.isFileBacked())
+        return;
+
+    TileStore::Stats stats = plant_layer.getTileStats();
+    std::cout << std::fixed << std::setprecision(1) << "Plant layer: memory limit " << (plant_layer.getMemoryLimit() / 1048576.0) << " MiB, peak resident "
+        << (stats.peak_resident_tiles * TileStore::TILE_BYTES / 1048576.0) << " MiB, " << stats.evictions << " tiles dropped, " << stats.write_backs << " written back\n";
+    std::cout << "Tiles near animals peaked at " << (stats.peak_hot_tiles * TileStore::TILE_BYTES / 1048576.0) << " MiB";
+    if (plant_layer.isOverMemoryLimit())
+        std::cout << ", MORE than the memory limit (they're never dropped, so the limit couldn't be kept)";
+    std::cout << '\n';
+    if (const LayeredEngine* layered_engine = dynamic_cast<const LayeredEngine*>(&engine))
+        std::cout << "The engine's animal keys and grid take another " << (layered_engine->getMemoryUsage() / 1048576.0) << " MiB, which the limit doesn't cover\n";
+}
 
 int main(int argc, char* argv[]){
-    Helper::clearScreen();
+    if (argc >= 2 && std::string(argv[1]) == "--serve")
+        serve(argc, argv);
+    if (argc >= 2 && std::string(argv[1]) == "--convert-map")
+        convertMap(argc, argv);
 
     // Extract map file and species file paths from command line arguments
     std::filesystem::path map_file;
@@ -16,164 +88,102 @@ int main(int argc, char* argv[]){
         Helper::quit(8);
     }
 
+    // Optional arguments
+    std::filesystem::path metrics_file; // Prometheus textfile to keep up to date with engine metrics
+    std::filesystem::path metrics_socket; // Unix socket to serve engine metrics on
+    bool perf_counters = false; // Count hardware events for each phase and print them when the simulation ends
+    bool memory_report = false; // Print how much memory the loaded world takes, then quit (without clearing the screen, so it can be piped)
+    std::string engine_name = "reference"; // Engine that runs the iterations (see Engine::create())
+    double memory_limit_mib = 0; // With a layered engine, keep the plant layer in a file with at most this much of it in memory (0 = all in memory)
+    std::filesystem::path store_directory; // Directory for that file
+    for (int i = 3; i < argc; i++){
+        std::string option = argv[i];
+        if (option == "--metrics-file" && i + 1 < argc)
+            metrics_file = argv[++i];
+        else if (option == "--metrics-socket" && i + 1 < argc)
+            metrics_socket = argv[++i];
+        else if (option == "--perf-counters")
+            perf_counters = true;
+        else if (option == "--memory-report")
+            memory_report = true;
+        else if (option == "--engine" && i + 1 < argc)
+            engine_name = argv[++i];
+        else if (option == "--memory-limit" && i + 1 < argc && std::atof(argv[i + 1]) > 0)
+            memory_limit_mib = std::atof(argv[++i]);
+        else if (option == "--store" && i + 1 < argc)
+            store_directory = argv[++i];
+        else {
+            std::cerr << "Error: Unknown command line argument " << option << ". Options: --metrics-file <path> --metrics-socket <path> --perf-counters --memory-report"
+                " --engine <name> --memory-limit <MiB> --store <directory>\n";
+            Helper::quit(8);
+        }
+    }
+
+    // Made before any other thread is started, since some engines start their own threads and processes:N forks its workers here
+    unsigned int engine_seed = std::random_device{}();
+    std::unique_ptr<Engine> engine = Engine::create(engine_name, engine_seed);
+    if (!engine){
+        std::cerr << "Error: Unknown engine " << engine_name << ". Engines: reference, grid, reference:morton, grid:morton, parallel:N, layered, hybrid, processes:N[:shm]\n";
+        Helper::quit(8);
+    }
+    bool layered_engine = dynamic_cast<LayeredEngine*>(engine.get()) != nullptr;
+    if ((memory_limit_mib > 0 || !store_directory.empty()) && !layered_engine){
+        std::cerr << "Error: --memory-limit and --store only work with the layered and hybrid engines, which keep plants in a plant layer\n";
+        Helper::quit(8);
+    }
+    if (!store_directory.empty() && memory_limit_mib == 0){
+        std::cerr << "Error: --store needs --memory-limit\n";
+        Helper::quit(8);
+    }
+
+    if (!memory_report)
+        Helper::clearScreen();
+
     // G E T   M A P   I N F O
     // Get map dimensions
     std::tuple<int, int> map_dimensions = Ecosystem::getMapDimensions(map_file);
 
-    // Get coordinate info for all organisms in the map
-    std::vector<std::tuple<char, std::tuple<int, int>>> organism_coords_vect;
-    Ecosystem::getOrgCoords(map_file, organism_coords_vect);
-
-    // G E T   S P E C I E S   I N F O
-    std::unordered_map<std::string, std::tuple<std::string, std::string, std::string>> species_info;
-    Ecosystem::getSpeciesInfo(species_file, species_info);
-
     // M A K E   O R G A N I S M   O B J E C T S
-    std::vector<Organism*> organisms;
-    for (const auto& org : organism_coords_vect) {
-        char org_char_ID = std::get<0>(org);
-        auto coords = std::get<1>(org);
-        int x_coord = std::get<0>(coords);
-        int y_coord = std::get<1>(coords);
-
-        // Get organism info from species info map
-        if (species_info.find(std::string(1, org_char_ID)) != species_info.end()) {
-            std::tuple<std::string, std::string, std::string> info = species_info[std::string(1, org_char_ID)];
-            std::string species = std::get<0>(info);
-            int health;
-            try {
-                health = std::stoi(std::get<1>(info));
-            } catch (const std::invalid_argument&) {
-                std::cerr << "Error: Please give an integer value for " << species << " health\n";
-                Helper::quit(7);
-            }
-
-            // Create actual plant/animal objects
-            Organism* org_ptr = nullptr;
-            std::string lowercase_species;
-            std::transform(species.begin(), species.end(), std::back_inserter(lowercase_species), [](unsigned char c) { return std::tolower(c); });
-            try {
-                if (lowercase_species == "plant") {
-                    int energy_points = std::stoi(std::get<2>(info));
-                    org_ptr = new Plant(org_char_ID, energy_points, health, coords);
-                } 
-                else if (lowercase_species == "herbivore") {
-                    org_ptr = new Animal(org_char_ID, Organism::HerbivoreEnum, health, coords);
-                } 
-                else if (lowercase_species == "omnivore") {
-                    org_ptr = new Animal(org_char_ID, Organism::OmnivoreEnum, health, coords);
-                } 
-                else {
-                    std::cerr << "Error: Check if you misspelled a species name\n";
-                    Helper::quit(6);
-                }
-            } 
-            catch (const std::invalid_argument& e) {
-                std::cerr << "Error: Invalid arguments given for " << lowercase_species << std::endl;
-                Helper::quit(6);
-            }
-
-            if (org_ptr) {
-                organisms.push_back(org_ptr);
-            }
-        } else {
-            std::cerr << "Error: species info not found for organism " << org_char_ID << ". Please include this species in your species list"<< "\n";
-            Helper::quit(5);
-        }
+    OrganismPool organisms;
+    if (memory_limit_mib > 0) // Before loading, so plants go straight into the file
+        organisms.getPlantLayer().useBackingFile(store_directory.empty() ? std::filesystem::temp_directory_path() : store_directory, static_cast<std::size_t>(memory_limit_mib * 1048576));
+    Ecosystem::loadOrganisms(map_file, species_file, organisms, layered_engine); // Layered engines keep plants in the plant layer from the start
+    if (memory_report){
+        // Only the report goes to stdout, so it can be saved or compared as is
+        std::cout << Ecosystem::getMemoryReport(organisms, map_dimensions);
+        organisms.clear();
+        return 0;
     }
 
     // M A I N   S I M U L A T I O N   C O D E
 
-    // simulation constants (used for printing, getting user input, etc)
-    const std::string OPTIONS_MENU =
-    "Options menu:\n"
-    "1. Run 1 iteration\n"
-    "2. Run a batch of iterations\n"
-    "3. Exit the program\n"
-    "Please enter your choice from the menu above: ";
-
-    const int MIN_OPTION_CHOICE = 1;
-    const int MAX_OPTION_CHOICE = 3;
-    const std::string BATCH_PROMPT = "Enter desired batch size: ";
-    const int DEFAULT_SLEEP_TIME = 100;
-    const std::string SLEEP_TIME_PROMPT = "Enter desired pause time between iterations (in milliseconds): ";
-
-    // simulation variables
-    int total_iterations = 0;
-    int todo_iterations;
-    int sleep_time;
-    int user_choice;
-
-    // Actual simulation code
-    do{
-        // Display completed iterations
-        Helper::clearScreen();
-        std::cout << "Iterations completed: " << total_iterations << '\n';
-        Ecosystem::printEcosystem(organisms, map_dimensions);
-
-        // Get user choice from menu
-        std::cout << OPTIONS_MENU;
-        user_choice = Helper::getUserChoice(MIN_OPTION_CHOICE, MAX_OPTION_CHOICE);
-        switch(user_choice){
-            case 1:
-                todo_iterations = 1;
-                sleep_time = DEFAULT_SLEEP_TIME;
-                break;
+    // The simulation runs on its own thread. This thread just reads commands and passes them along, so the simulation can be
+    // paused, sped up, stepped or stopped at any time (even in the middle of a huge batch)
+    {
+        MetricsExporter metrics_exporter(metrics_file, metrics_socket); // Made before the controller so it's stopped after it, and exports the final state
+        SimulationController controller(organisms, map_dimensions, *engine, engine_seed, perf_counters);
 
-            case 2:
-                todo_iterations = Helper::getPositiveInteger(BATCH_PROMPT);
-                sleep_time = Helper::getPositiveInteger(SLEEP_TIME_PROMPT);
-                break;
-            
-            case 3:
-                continue;
-            
-            default:
-                std::cout << "This isn't supposed to happen >:(\n";
-        }
+        std::string command_line;
+        while (std::getline(std::cin, command_line)){
+            if (!controller.handleCommand(command_line))
+                std::cout << "Invalid command. " << SimulationController::COMMANDS_HELP << "> " << std::flush;
 
-        // Update ecosystem
-        for (int i = 0; i < todo_iterations; i++){
-            // Update iteration counter
-            total_iterations++;
-
-            // Update organisms
-            for (Organism* org : organisms){
-                if (org->getType() == Organism::PlantEnum){
-                    Plant* plant {dynamic_cast<Plant*>(org)};
-                    plant->update(organisms, map_dimensions);
-                }
-                else{
-                    Animal* animal {dynamic_cast<Animal*>(org)};
-                    animal->update(organisms, map_dimensions);
-                }
-            }
-
-            // Clean up any eaten animals
-            auto it = organisms.begin();
-            while (it != organisms.end()) {
-                Organism* org = *it;
-                if (!org->isAlive() && (org->getType() != Organism::PlantEnum)) {
-                    delete org; // Free memory allocated for the organism
-                    it = organisms.erase(it); // Remove the organism from the vector and advance the iterator
-                } else {
-                    it++; // Move to the next organism
-                }
-            }
-
-            // Display updated ecosystem
-            Helper::clearScreen();
-            std::cout << "Iteration " << total_iterations << ":\n";
-            Ecosystem::printEcosystem(organisms, map_dimensions);
-            Helper::sleep(sleep_time);
+            std::istringstream iss(command_line);
+            std::string command;
+            if (iss >> command && command == "quit")
+                break;
         }
 
-    } while (user_choice != MAX_OPTION_CHOICE);
+        // Also stop if there's no more input (e.g. stdin was closed)
+        controller.quit();
+        controller.join();
+    }
+    if (perf_counters)
+        std::cout << '\n' << PerfCounters::getReport();
+    printMemorySummary(organisms, *engine);
 
     // Clean up allocated memory
-    for (Organism* org : organisms) {
-        delete org;
-    }
+    organisms.clear();
 
     // Quit program successfully
     Helper::quit(0);